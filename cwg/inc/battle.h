@@ -10,11 +10,13 @@
 
 /* types defined inthis header */
 typedef struct battle Battle;
+typedef struct battle_methods BattleMethods;
 
 #ifndef __BATTLE_H__
 #define __BATTLE_H__
 
 /* includes for required external type defs */
+#include "stream.h"
 #include "utype.h"
 #include "terrain.h"
 #include "map.h"
@@ -49,6 +51,174 @@ typedef enum {
     CWG_MOVE_SMART /* movement with full pathfinding */
 } CwgMovementAlgorithm;
 
+/**
+ * @struct CwgPathCache
+ * A path cost grid kept for reuse by later moves.
+ */
+typedef struct {
+    int utype; /* unit type the grid was computed for */
+    int dest; /* destination square */
+    int adjacent; /* 1 if only the destination square was costed */
+    unsigned long generation; /* unit grid generation when computed */
+    int *costs; /* the cost grid, or NULL if the entry is unused */
+} CwgPathCache;
+
+/**
+ * @struct CwgDistances
+ * Travel costs through the terrain from origin squares, ignoring units.
+ * Each row holds 1 + the cost from its origin to each square, or 0 if
+ * the square cannot be reached, in an unsigned short so that the
+ * longest journeys on the largest maps still fit. Rows are built
+ * when first needed and the least recently built is replaced when all
+ * are in use. Large maps get fewer rows, so that the rows together
+ * take no more than CWG_DISTANCEBYTES.
+ */
+typedef struct {
+    signed char *index; /* row for each unit type and origin, or -1 */
+    int count; /* number of rows the map's size allows */
+    int owners[CWG_DISTANCES]; /* index entry using each row, or -1 */
+    unsigned short *rows[CWG_DISTANCES]; /* the rows of travel costs */
+    int next; /* the next row to replace */
+} CwgDistances;
+
+/**
+ * @struct CwgBoard
+ * A bitboard, holding one bit for each square of the map. Square s is
+ * bit (s % 32) of word (s / 32).
+ */
+typedef struct {
+    unsigned long bits[CWG_BOARDWORDS]; /* the bits, 32 to a word */
+} CwgBoard;
+
+/**
+ * @struct CwgBoards
+ * Bitboards describing the map. The terrain boards never change, and
+ * the side boards are kept in step with the map's units.
+ */
+typedef struct {
+    CwgBoard sides[2]; /* squares holding each side's units */
+    CwgBoard points; /* victory point squares */
+    CwgBoard terrain[CWG_TERRAIN]; /* squares of each terrain type */
+    CwgBoard passable[CWG_UTYPES]; /* squares each unit type can enter */
+    unsigned long generation; /* unit grid generation of side boards */
+} CwgBoards;
+
+/**
+ * @struct CwgPlanes
+ * The terrain's movement costs and defence bonuses laid out square by
+ * square for each unit type, so that they can be read without looking
+ * up the terrain. Entry utype * size + square is for a unit of type
+ * utype on the given square. Clones of a battle share its planes.
+ */
+typedef struct {
+    int users; /* number of battles sharing the planes */
+    int size; /* number of squares in each unit type's plane */
+    unsigned char *moves; /* movement cost into each square */
+    unsigned char *defence; /* defence bonus on each square */
+} CwgPlanes;
+
+/**
+ * @struct CwgRings
+ * Lists of the squares around a square, nearest first, held as
+ * offsets so that they take the same space on any size of map. Each
+ * list starts with the square itself, followed by the squares one
+ * step away, then two steps away, and so on out to the radius. The
+ * squares one step away come in the order that a unit prefers to
+ * move, which depends on the quarter of the map that it is in, so
+ * there is one list per quarter: list q is for squares with
+ * x >= width / 2 if (q & 1), and with y >= height / 2 if (q & 2).
+ * An entry lies on the map only if the square's x coordinate plus
+ * its x offset, and the square's position plus its offset, are both
+ * within the map, which is always so for the squares one step away
+ * from a square not on the edge. Clones of a battle share its rings.
+ */
+typedef struct {
+    int users; /* number of battles sharing the rings */
+    int radius; /* the furthest ring listed */
+    int stride; /* length of each list */
+    int *offsets; /* position offset of each entry, per quarter */
+    int *xoffsets; /* x offset of each entry, per quarter */
+    int *ends; /* list length out to each ring */
+    unsigned char *edges; /* 1 for each square on the map's edge */
+} CwgRings;
+
+/**
+ * @struct CwgRoster
+ * The units' sides, types, positions, hits and moves, held in an
+ * array for each field rather than a structure for each unit, so that
+ * a scan over a whole army reads a few small arrays instead of
+ * following a pointer to every unit. Entry c is for unit ID c, and
+ * means nothing if that slot is empty. Bit (c % 32) of word (c / 32)
+ * of alive is set if the slot holds a unit with hits left, so dead
+ * units awaiting removal at the end of the turn are left out. All the
+ * fields are bytes, as they are in the battle's files.
+ */
+typedef struct {
+    unsigned long alive[CWG_SLOTWORDS]; /* slots holding live units */
+    unsigned char side[CWG_MAXUNITS]; /* side of each unit */
+    unsigned char utype[CWG_MAXUNITS]; /* unit type of each unit */
+    unsigned char x[CWG_MAXUNITS]; /* x coordinate of each unit */
+    unsigned char y[CWG_MAXUNITS]; /* y coordinate of each unit */
+    unsigned char hits[CWG_MAXUNITS]; /* hits left to each unit */
+    unsigned char moves[CWG_MAXUNITS]; /* moves left to each unit */
+} CwgRoster;
+
+/**
+ * @enum CwgActionType
+ * Types of action that can be applied to a battle and undone.
+ */
+typedef enum {
+    CWG_ACT_MOVE, /* move a unit towards a square */
+    CWG_ACT_ATTACK, /* attack one unit with another */
+    CWG_ACT_CREATE, /* build a unit on a square */
+    CWG_ACT_RESTORE /* repair one unit with another */
+} CwgActionType;
+
+/**
+ * @struct CwgAction
+ * An action to apply to a battle.
+ */
+typedef struct {
+    int type; /* the type of action */
+    int unit; /* ID of the unit acting */
+    int target; /* ID of the unit attacked or repaired */
+    int utype; /* unit type to build */
+    int x; /* x coordinate to move to or build on */
+    int y; /* y coordinate to move to or build on */
+} CwgAction;
+
+/**
+ * @struct CwgUndo
+ * The state changed by an applied action, kept so it can be undone.
+ * Up to two units are affected by an action, plus any unit created.
+ */
+typedef struct {
+    int units[2]; /* IDs of the units affected, or CWG_NO_UNIT */
+    int x[2]; /* x coordinates of the units affected */
+    int y[2]; /* y coordinates of the units affected */
+    int hits[2]; /* hits of the units affected */
+    int moves[2]; /* movement points of the units affected */
+    int created; /* ID of a unit created, or CWG_NO_UNIT */
+    int resources[2]; /* resources for production */
+    unsigned long rng; /* state of the random number generator */
+    unsigned long hash[2]; /* hash of the battle state */
+    int unitcount[2]; /* live units on the map per side */
+    int pointcount[2]; /* victory points held per side */
+} CwgUndo;
+
+/**
+ * @struct CwgJournal
+ * The actions applied to a battle that can still be undone.
+ * Units removed by undoing their creation are kept as spares, so that
+ * applying the creation again needs no more memory.
+ */
+typedef struct {
+    CwgUndo entries[CWG_JOURNAL]; /* changes made by each action */
+    int count; /* number of actions that can be undone */
+    Unit *spares[CWG_MAXUNITS]; /* units kept for reuse */
+    int sparecount; /* number of spare units */
+} CwgJournal;
+
 /* display hooks */
 typedef void (*MoveHook) (Unit *, int, int);
 typedef void (*AttackHook) (Unit *, Unit *, CwgAttackResult);
@@ -82,44 +252,132 @@ struct battle {
     /** @var terrain is the terrain type list. */
     Terrain **terrain;
 
-    /** @var units is the unit list. */
-    Unit *units[CWG_UNITS];
+    /**
+     * @var units is the unit list, a table of unitcap pointers that
+     * is reallocated as it grows. A clone keeps its table in the
+     * same block as the battle.
+     */
+    Unit **units;
+
+    /**
+     * @var unitcap is the number of slots in the unit list. Every
+     * unit ID is below it, and it doubles when the slots are full.
+     */
+    int unitcap;
+
+    /** @var freeslots has a bit set for each empty slot in the list. */
+    unsigned long freeslots[CWG_SLOTWORDS];
 
     /** @var map is the map used for the battle. */
     Map *map;
 
+    /** @var levels is the difficulty level for each side. */
+    int levels[2];
+
+    /** @var movement is the algorithm used for unit movement. */
+    int movement;
+
+    /** @var rng is the state of the random number generator. */
+    unsigned long rng;
+
     /**
-     * Methods.
+     * @var generation counts changes to the map's unit grid.
+     * Cached path costs are discarded when it changes, so code that
+     * alters map->units directly should increment it.
      */
+    unsigned long generation;
+
+    /** @var pathcache holds recently computed path cost grids. */
+    CwgPathCache pathcache[CWG_PATHCACHE];
+
+    /** @var pathhits counts path cost grids found in the cache. */
+    long pathhits;
+
+    /** @var pathmisses counts path cost grids that were computed. */
+    long pathmisses;
+
+    /** @var distances holds travel costs ignoring units, or NULL. */
+    CwgDistances *distances;
+
+    /** @var journal holds actions that can be undone, or NULL. */
+    CwgJournal *journal;
+
+    /** @var boards holds bitboards of the map, or NULL. */
+    CwgBoards *boards;
+
+    /** @var planes holds flat terrain costs and defences, or NULL. */
+    CwgPlanes *planes;
+
+    /** @var rings holds the squares around each square, or NULL. */
+    CwgRings *rings;
+
+    /** @var roster holds the units' fields in arrays, or NULL. */
+    CwgRoster *roster;
+
+    /**
+     * @var hash is a 64-bit Zobrist hash of the battle state, as two
+     * 32-bit halves. It covers the units' positions, sides, types,
+     * hits and moves, the side to move and the resources, and is kept
+     * up to date as the battle changes. Code that alters these
+     * directly should call rehash () afterwards.
+     */
+    unsigned long hash[2];
+
+    /** @var unitcount is the number of live units on the map per side. */
+    int unitcount[2];
+
+    /**
+     * @var pointcount is the number of victory points held by each
+     * side, followed by the number of victory points on the map.
+     */
+    int pointcount[3];
+
+    /** @var methods points to the methods shared by all battles. */
+    const BattleMethods *methods;
+
+};
+
+/**
+ * @struct battle_methods holds the methods shared by all battles, so
+ * that each one needs only a single pointer to them.
+ */
+struct battle_methods {
 
     /**
-     * Destroy a battle when the game is over.
+     * Destroy a battle when the game is over. This releases the
+     * tables it shares with its clones, so it must be called from
+     * the thread that clones them.
      * @param battle is the battle to destroy.
      */
     void (*destroy) (Battle *battle);
 
     /**
-     * Clone a battle state.
+     * Clone a battle state. The copy, its units and its map are
+     * held in a single block of memory, which destroying the copy
+     * frees in one go. The copy shares the original's planes, rings
+     * and map grids, counted by plain int reference counts, so a
+     * battle and all its clones must be cloned and destroyed from
+     * one thread only. Other threads may play on a clone meanwhile.
      * @param battle is the battle to clone.
      * @return a copy of the battle.
      */
     Battle *(*clone) (Battle *battle);
 
     /**
-     * Write the battle to an already open file.
+     * Write the battle to a stream.
      * @param battle is the battle to write.
-     * @param output is the output file.
+     * @param output is the output stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*write) (Battle *battle, FILE *output);
+    int (*write) (Battle *battle, Stream *output);
 
     /**
-     * Read the battle from an already open file.
+     * Read the battle from a stream.
      * @param battle is the battle to read.
-     * @param input is the input file.
+     * @param input is the input stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*read) (Battle *battle, FILE *input);
+    int (*read) (Battle *battle, Stream *input);
 
     /**
      * Move a unit towards a destination.
@@ -178,18 +436,200 @@ struct battle {
      */
     int (*turn) (Battle *battle);
 
+    /**
+     * Find the squares a unit can reach with its remaining movement
+     * points. Squares occupied by other units can be neither entered
+     * nor crossed.
+     * @param battle is the battle to examine.
+     * @param unit is the unit to move.
+     * @param squares is filled with 1 for each square the unit can
+     * reach, including its own, and 0 for every other square.
+     * @return the number of squares the unit can reach.
+     */
+    int (*reachable) (Battle *battle, Unit *unit, unsigned char *squares);
+
+    /**
+     * Return the cost of travel between two squares for a unit type.
+     * Only the terrain is taken into account, not other units.
+     * @param battle is the battle to examine.
+     * @param utype is the unit type travelling.
+     * @param ox is the x coordinate of the origin.
+     * @param oy is the y coordinate of the origin.
+     * @param dx is the x coordinate of the destination.
+     * @param dy is the y coordinate of the destination.
+     * @return the movement points needed, or -1 if unreachable.
+     */
+    int (*pathdistance) (Battle *battle, int utype, int ox, int oy,
+			 int dx, int dy);
+
+    /**
+     * Return a grid of travel costs from each square to a destination,
+     * as smart movement uses to choose a unit's path. The destination
+     * holds 1, other squares the cost of reaching it from there, and
+     * squares that cannot reach it 0. When the unit is next to the
+     * destination, only the destination's own entry is filled in.
+     * @param battle is the battle to examine.
+     * @param unit is the unit to move.
+     * @param x is the x coordinate of the destination.
+     * @param y is the y coordinate of the destination.
+     * @return a new grid, which the caller must free, or NULL on failure.
+     */
+    int *(*pathcosts) (Battle *battle, Unit *unit, int x, int y);
+
     /**
      * Set the difficulty level for one side.
+     * @param battle The battle to affect.
      * @param side The side for which to set the difficulty.
      * @param level The difficulty level.
      */
-    void (*setlevel) (int side, int level);
+    void (*setlevel) (Battle *battle, int side, int level);
 
     /**
      * Set the movement algorithm.
+     * @param battle The battle to affect.
      * @param algorithm The algorithm to use for movement:
      */
-    void (*setmovement) (int algorithm);
+    void (*setmovement) (Battle *battle, int algorithm);
+
+    /**
+     * Seed the battle's random number generator.
+     * A battle seeded with the same number will play out the same way
+     * given the same orders.
+     * @param battle The battle to affect.
+     * @param number The seed, which may be any value.
+     */
+    void (*seed) (Battle *battle, unsigned long number);
+
+    /**
+     * Write the state of the battle's random number generator, which
+     * Write leaves out. A saved game writes it after the battle so
+     * that the game plays on as it would have done.
+     * @param battle The battle whose state to write.
+     * @param output The output stream.
+     * @return 1 on success, 0 on failure.
+     */
+    int (*writerandom) (Battle *battle, Stream *output);
+
+    /**
+     * Read the state of the battle's random number generator, as
+     * written by Writerandom.
+     * @param battle The battle whose state to read.
+     * @param input The input stream.
+     * @return 1 on success, 0 on failure.
+     */
+    int (*readrandom) (Battle *battle, Stream *input);
+
+    /**
+     * Apply an action so that it can later be undone.
+     * Display hooks are not called. Actions can only be undone while
+     * the battle is changed by no other means, and ending the turn or
+     * reading the battle forgets them.
+     * @param battle The battle to affect.
+     * @param action The action to apply.
+     * @return 1 if successful, 0 if not.
+     */
+    int (*apply) (Battle *battle, CwgAction *action);
+
+    /**
+     * Undo the last action applied, restoring the battle exactly.
+     * @param battle The battle to affect.
+     * @return 1 if an action was undone, 0 if there was none.
+     */
+    int (*undo) (Battle *battle);
+
+    /**
+     * Recalculate the hash of the battle state, the counts of units
+     * and victory points, and the roster if there is one, from
+     * scratch.
+     * @param battle The battle to examine.
+     */
+    void (*rehash) (Battle *battle);
+
+    /**
+     * List the legal actions for the side whose turn it is: moves to
+     * each square a unit can reach, attacks on enemies in range,
+     * builds of the battle's unit types on the squares around a
+     * builder, and repairs to damaged friends.
+     * @param battle The battle to examine.
+     * @param list The buffer to fill with actions.
+     * @param size The number of actions the buffer can hold.
+     * @return The number of legal actions, which may be more than size,
+     * or -1 if there is not enough memory.
+     */
+    int (*actions) (Battle *battle, CwgAction *list, int size);
+
+    /**
+     * Get bitboards of the map, building them if necessary.
+     * They are kept up to date as units move, attack and are built.
+     * @param battle The battle to examine.
+     * @return The bitboards, or NULL if there is not enough memory.
+     */
+    CwgBoards *(*getboards) (Battle *battle);
+
+    /**
+     * Get the terrain's movement costs and defence bonuses for each
+     * unit type and square, building them if necessary.
+     * @param battle The battle to examine.
+     * @return The planes, or NULL if there is not enough memory.
+     */
+    CwgPlanes *(*getplanes) (Battle *battle);
+
+    /**
+     * Get the lists of squares around each square, building them if
+     * necessary. The lists reach out as far as the longest range of
+     * any unit type, and never less than one square.
+     * @param battle The battle to examine.
+     * @return The rings, or NULL if there is not enough memory.
+     */
+    CwgRings *(*getrings) (Battle *battle);
+
+    /**
+     * Get the units' fields laid out in an array for each field,
+     * building them if necessary. They are kept up to date as the
+     * battle changes its units; code that changes units directly
+     * should call Rehash afterwards.
+     * @param battle The battle to examine.
+     * @return The roster, or NULL if there is not enough memory.
+     */
+    CwgRoster *(*getroster) (Battle *battle);
+
+    /**
+     * Put a unit into the lowest free slot, growing the unit list if
+     * it is full. The caller must place the unit on the map, and
+     * call Rehash if the hash and counts matter.
+     * @param battle The battle to add the unit to.
+     * @param unit The unit to add.
+     * @return The unit's ID, or CWG_NO_UNIT if the battle is full.
+     */
+    int (*addunit) (Battle *battle, Unit *unit);
+
+    /**
+     * Remove a unit and free its slot for reuse. The caller must
+     * take the unit off the map, and call Rehash if the hash and
+     * counts matter.
+     * @param battle The battle to remove the unit from.
+     * @param unitid The ID of the unit to remove.
+     */
+    void (*removeunit) (Battle *battle, int unitid);
+
+    /**
+     * Fill a bitboard with the squares within range of a square,
+     * allowing diagonals, including the square itself.
+     * @param battle The battle to examine.
+     * @param board The bitboard to fill.
+     * @param square The square at the centre.
+     * @param range The greatest distance from the centre.
+     */
+    void (*surround) (Battle *battle, CwgBoard *board, int square,
+		      int range);
+
+    /**
+     * Find the next square set on a bitboard.
+     * @param board The bitboard to search.
+     * @param square The first square to look at.
+     * @return The first square set from that square on, or -1 if none.
+     */
+    int (*nextsquare) (CwgBoard *board, int square);
 
 };
 
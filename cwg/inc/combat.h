@@ -0,0 +1,147 @@
+/*======================================================================
+ * CWG: Cyningstan Wargame Engine.
+ * An engine for simple turn-based wargames.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Combat Table Header.
+ */
+
+/* types defined in this header */
+typedef struct combat Combat;
+typedef struct combat_methods CombatMethods;
+
+#ifndef __COMBAT_H__
+#define __COMBAT_H__
+
+/* includes for required external type defs */
+#include "utype.h"
+#include "terrain.h"
+
+/*----------------------------------------------------------------------
+ * Data Definitions.
+ */
+
+/**
+ * @struct combat holds the outcomes of a unit firing upon another,
+ * worked out in advance for every attack power, defence and
+ * difficulty level that the unit types and terrain allow. The damage
+ * done by a shot is the best of (level + 1) rolls of a number up to
+ * the attack power less a number up to the defence, so its chances
+ * can be counted exactly. Chances are held out of CWG_CERTAIN, and
+ * expected damage in CWG_CERTAIN-ths of a hit, so that they can be
+ * looked up without floating point arithmetic.
+ */
+struct combat {
+
+    /*
+     * Attributes
+     */
+
+    /** @var maxattack is the greatest attack power in the tables. */
+    int maxattack;
+
+    /** @var maxdefence is the greatest defence in the tables. */
+    int maxdefence;
+
+    /**
+     * @var chances holds, for each level, attack power and defence,
+     * a row of the chances of doing at least 0, 1, 2 ... maxattack
+     * hits of damage.
+     */
+    unsigned int *chances;
+
+    /**
+     * @var expected holds, for each level, attack power and defence,
+     * a row of the damage expected against a target with 0, 1, 2 ...
+     * maxattack hits left.
+     */
+    long *expected;
+
+    /** @var methods points to the methods shared by all tables. */
+    const CombatMethods *methods;
+
+};
+
+/**
+ * @struct combat_methods holds the methods of the combat tables.
+ */
+struct combat_methods {
+
+    /**
+     * Destroy the combat tables when they are no longer needed.
+     * @param combat is the combat tables to destroy.
+     */
+    void (*destroy) (Combat *combat);
+
+    /**
+     * Return the chance of a shot doing an exact amount of damage.
+     * @param combat is the combat tables.
+     * @param attack is the attack power of the unit firing.
+     * @param defence is the target's armour plus its terrain defence.
+     * @param level is the difficulty level of the side firing.
+     * @param hits is the number of hits the target has left.
+     * @param damage is the damage to find the chance of.
+     * @return the chance out of CWG_CERTAIN.
+     */
+    unsigned int (*chance) (Combat *combat, int attack, int defence,
+			    int level, int hits, int damage);
+
+    /**
+     * Return the damage a shot is expected to do.
+     * @param combat is the combat tables.
+     * @param attack is the attack power of the unit firing.
+     * @param defence is the target's armour plus its terrain defence.
+     * @param level is the difficulty level of the side firing.
+     * @param hits is the number of hits the target has left.
+     * @return the expected damage in CWG_CERTAIN-ths of a hit.
+     */
+    long (*damage) (Combat *combat, int attack, int defence, int level,
+		    int hits);
+
+    /**
+     * Return the chance of a shot destroying its target.
+     * @param combat is the combat tables.
+     * @param attack is the attack power of the unit firing.
+     * @param defence is the target's armour plus its terrain defence.
+     * @param level is the difficulty level of the side firing.
+     * @param hits is the number of hits the target has left.
+     * @return the chance out of CWG_CERTAIN.
+     */
+    unsigned int (*kill) (Combat *combat, int attack, int defence,
+			  int level, int hits);
+
+    /**
+     * Return the damage expected from return fire, which comes only
+     * if the target survives the shot.
+     * @param combat is the combat tables.
+     * @param attack is the attack power of the unit firing.
+     * @param defence is the target's armour plus its terrain defence.
+     * @param level is the difficulty level of the side firing.
+     * @param hits is the number of hits the target has left.
+     * @param rattack is the attack power of the target.
+     * @param rdefence is the firing unit's armour and terrain defence.
+     * @param rlevel is the difficulty level of the target's side.
+     * @param rhits is the number of hits the firing unit has left.
+     * @return the expected damage in CWG_CERTAIN-ths of a hit.
+     */
+    long (*returnfire) (Combat *combat, int attack, int defence,
+			int level, int hits, int rattack, int rdefence,
+			int rlevel, int rhits);
+
+};
+
+/*----------------------------------------------------------------------
+ * Constructor Function Prototypes.
+ */
+
+/**
+ * Combat table constructor.
+ * @param utypes is the array of CWG_UTYPES unit types, some NULL.
+ * @param terrain is the array of CWG_TERRAIN terrain types, some NULL.
+ * @return the new combat tables, or NULL if there is not enough memory.
+ */
+Combat *new_Combat (UnitType **utypes, Terrain **terrain);
+
+#endif
@@ -21,15 +21,60 @@
 /* terrain types */
 #define CWG_TERRAIN 8
 
-/* units */
+/* units a battle has room for at first */
 #define CWG_UNITS 32
 
+/* most units a battle can hold; unit IDs are one byte wherever they
+   are stored, and must stay below the two markers that follow */
+#define CWG_MAXUNITS 254
+
+/* number of 32-bit words in a battle's mask of free unit slots */
+#define CWG_SLOTWORDS 8
+
 /* value for no unit */
 #define CWG_NO_UNIT 255
 
 /* maximum length of a string, including terminator */
 #define CWG_MAXLEN 32
 
+/* longest side of a map, which keeps coordinates within a byte */
+#define CWG_MAPSIDE 64
+
+/* most squares on a map, which keeps locations within 16 bits */
+#define CWG_SQUARES 4096
+
+/* 32-bit words in a bitboard of the largest map */
+#define CWG_BOARDWORDS 128
+
+/* path cost grids cached by a battle */
+#define CWG_PATHCACHE 8
+
+/* travel cost rows kept by a battle */
+#define CWG_DISTANCES 64
+
+/* most bytes of travel cost rows kept, which limits rows on big maps */
+#define CWG_DISTANCEBYTES 32768L
+
+/* bytes buffered by a file stream, and first held by a memory stream */
+#define CWG_STREAMBUF 512
+
+/* a certainty among the combat tables' chances */
+#define CWG_CERTAIN 16384
+
+/* difficulty levels covered by the combat tables */
+#define CWG_LEVELS 3
+
+/* actions that a battle can undo */
+#define CWG_JOURNAL 64
+
+/* salts for the two halves of a battle's hash keys */
+#define CWG_HASH_SALT0 0x9e3779b9UL
+#define CWG_HASH_SALT1 0x7f4a7c15UL
+
+/* hash key identifiers for the side to move and the resources */
+#define CWG_HASH_SIDE 0xfffe0000UL
+#define CWG_HASH_RESOURCES 0xffff0000UL
+
 /*----------------------------------------------------------------------
  * Includes.
  */
@@ -38,8 +83,10 @@
 #include <stdio.h>
 
 /* project headers */
+#include "stream.h"
 #include "utype.h"
 #include "terrain.h"
+#include "combat.h"
 #include "map.h"
 #include "unit.h"
 #include "battle.h"
@@ -63,38 +110,38 @@ struct cwg {
     void (*destroy) (void);
 
     /**
-     * Write an integer as a byte to an already open output file.
+     * Write an integer as a byte to a stream.
      * @param  value  A pointer to the integer variable to write.
-     * @param  output The output file handle.
+     * @param  output The output stream.
      * @return        1 if successful, 0 if not.
      */
-    int (*writeint) (int *value, FILE *output);
+    int (*writeint) (int *value, Stream *output);
 
     /**
-     * Write a string to an already open output file.
+     * Write a string to a stream.
      * @param  value  A pointer to the string buffer to write.
-     * @param  output The output file handle.
+     * @param  output The output stream.
      * @return        1 if successful, 0 if not.
      */
-    int (*writestring) (char *value, FILE *output);
+    int (*writestring) (char *value, Stream *output);
 
     /**
-     * Read a byte from an already open input file
+     * Read a byte from a stream
      * and store it in an integer variable.
      * @param  value A pointer to the integer variable to store into.
-     * @param  input The input file handle.
+     * @param  input The input stream.
      * @return       1 if successful, 0 if not.
      */
-    int (*readint) (int *value, FILE *input);
+    int (*readint) (int *value, Stream *input);
 
     /**
-     * Read a string from an already open input file
+     * Read a string from a stream
      * and store it in a string buffer.
      * @param  value A pointer to the string buffer to store into.
-     * @param  input The input file handle.
+     * @param  input The input stream.
      * @return       1 if successful, 0 if not.
      */
-    int (*readstring) (char *value, FILE *input);
+    int (*readstring) (char *value, Stream *input);
 
     /**
      * Open the debug log file.
@@ -10,10 +10,14 @@
 
 /* types defined in this header */
 typedef struct map Map;
+typedef struct map_methods MapMethods;
 
 #ifndef __MAP_H__
 #define __MAP_H__
 
+/* includes for required external type defs */
+#include "stream.h"
+
 /*----------------------------------------------------------------------
  * Data Definitions.
  */
@@ -42,41 +46,72 @@ struct map {
     /** @var points is a grid of victory points */
     unsigned char *points;
 
-    /*
-     * Methods
+    /**
+     * @var users counts the maps sharing the terrain and points.
+     * Clones share these grids rather than copying them, so they
+     * must not be changed once a map has been cloned.
      */
+    int *users;
+
+    /** @var methods points to the methods shared by all maps. */
+    const MapMethods *methods;
+
+};
+
+/**
+ * @struct map_methods holds the methods shared by all maps, so that
+ * each one needs only a single pointer to them.
+ */
+struct map_methods {
 
     /**
-     * Destroy a map when it is no longer needed.
+     * Destroy a map when it is no longer needed. This releases the
+     * grids it shares with its clones, so it must be called from the
+     * thread that clones them.
      * @param map is the map to destroy.
      */
     void (*destroy) (Map *map);
 
     /**
-     * Clone the current map.
+     * Clone the current map. The clone shares the terrain and
+     * points, counted by a plain int reference count, so a map and
+     * its clones must be cloned and destroyed from one thread only.
      * @param map is the map to clone.
      * @return the cloned map.
      */
     Map *(*clone) (Map *map);
 
     /**
-     * Write the map to an already open file.
+     * Clone the map into memory owned by something else, such as the
+     * block holding a whole battle. The memory must have room for
+     * the map followed by its grid of units. Destroying the clone
+     * leaves the memory alone, and the clone cannot be resized. As
+     * with clone, this must be called from one thread only.
+     * @param map is the map to clone.
+     * @param memory is where to put the clone.
+     * @return the cloned map.
+     */
+    Map *(*cloneinto) (Map *map, Map *memory);
+
+    /**
+     * Write the map to a stream.
      * @param map is the map to write.
-     * @param output is the output file.
+     * @param output is the output stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*write) (Map *map, FILE *output);
+    int (*write) (Map *map, Stream *output);
     
     /**
-     * Read the map from an already open file.
+     * Read the map from a stream.
      * @param map is the map to read.
-     * @param input is the input file.
+     * @param input is the input stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*read) (Map *map, FILE *input);
+    int (*read) (Map *map, Stream *input);
 
     /**
-     * Set the size of the map, clearing any current content.
+     * Set the size of the map, clearing any current content. Each
+     * side must be from 9 to CWG_MAPSIDE squares long.
      * @param map is the map to resize.
      * @param width is the new width.
      * @param height is the new height.
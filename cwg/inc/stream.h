@@ -0,0 +1,133 @@
+/*======================================================================
+ * CWG: Cyningstan Wargame Engine.
+ * An engine for simple turn-based wargames.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Stream Header.
+ */
+
+/* types defined in this header */
+typedef struct stream Stream;
+typedef struct stream_methods StreamMethods;
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+/* includes for required external type defs */
+#include <stdio.h>
+
+/*----------------------------------------------------------------------
+ * Data Definitions.
+ */
+
+/**
+ * @struct stream is a source of bytes to read or a place to write
+ * them, which the objects of the library use to save and load
+ * themselves. A file stream gathers bytes in a buffer and moves them
+ * to or from its file in bulk. A memory stream keeps all its bytes in
+ * its buffer, growing it as needed, so that a battle can be saved to
+ * memory and read back without touching a file.
+ */
+struct stream {
+
+    /*
+     * Attributes
+     */
+
+    /** @var file is the file behind the stream, or NULL for memory. */
+    FILE *file;
+
+    /**
+     * @var buffer holds the bytes waiting to be read or written, or
+     * for a memory stream, everything written to it.
+     */
+    unsigned char *buffer;
+
+    /** @var size is the number of bytes the buffer can hold. */
+    unsigned int size;
+
+    /** @var length is the number of bytes in the buffer. */
+    unsigned int length;
+
+    /** @var position is the next byte of the buffer to use. */
+    unsigned int position;
+
+    /** @var writing is 1 if the buffer holds bytes to be written. */
+    int writing;
+
+    /** @var methods points to the methods shared by its kind. */
+    const StreamMethods *methods;
+
+};
+
+/**
+ * @struct stream_methods holds the methods shared by all streams of a
+ * kind, one table for file streams and one for memory streams, so
+ * that each stream needs only a single pointer to them.
+ */
+struct stream_methods {
+
+    /**
+     * Destroy a stream when it is no longer needed. The bytes
+     * waiting to be written to a file stream are written first, and
+     * the file is left open at the point the stream reached.
+     * @param stream is the stream to destroy.
+     */
+    void (*destroy) (Stream *stream);
+
+    /**
+     * Write bytes to the stream.
+     * @param stream is the stream to write to.
+     * @param data is the bytes to write.
+     * @param count is the number of bytes to write.
+     * @return 1 on success, 0 on failure.
+     */
+    int (*write) (Stream *stream, void *data, unsigned int count);
+
+    /**
+     * Read bytes from the stream.
+     * @param stream is the stream to read from.
+     * @param data is where to put the bytes read.
+     * @param count is the number of bytes to read.
+     * @return 1 if all the bytes were read, 0 if not.
+     */
+    int (*read) (Stream *stream, void *data, unsigned int count);
+
+    /**
+     * Go back to the start of the stream, so that what was written
+     * can be read back.
+     * @param stream is the stream to rewind.
+     */
+    void (*rewind) (Stream *stream);
+
+    /**
+     * Get the file behind a file stream, positioned where the stream
+     * has reached, so that other code can read or write the file
+     * directly before the stream carries on.
+     * @param stream is the stream to examine.
+     * @return the file, or NULL for a memory stream.
+     */
+    FILE *(*getfile) (Stream *stream);
+
+};
+
+/*----------------------------------------------------------------------
+ * Constructor Function Prototypes.
+ */
+
+/**
+ * File stream constructor.
+ * @param file is an open file to read from or write to.
+ * @return the new stream, or NULL if there is not enough memory.
+ */
+Stream *new_FileStream (FILE *file);
+
+/**
+ * Memory stream constructor.
+ * @return the new, empty stream, or NULL if there is not enough memory.
+ */
+Stream *new_MemoryStream (void);
+
+#endif
@@ -10,10 +10,14 @@
 
 /* types defined in this header */
 typedef struct terrain Terrain;
+typedef struct terrain_methods TerrainMethods;
 
 #ifndef __TERRAIN_H__
 #define __TERRAIN_H__
 
+/* includes for required external type defs */
+#include "stream.h"
+
 /*----------------------------------------------------------------------
  * Data Definitions.
  */
@@ -36,9 +40,19 @@ struct terrain {
     /** @var defence is a table of defence bonuses. */
     int defence[CWG_UTYPES];
 
-    /*
-     * Methods
+    /**
+     * @var methods points to the methods shared by all
+     * terrain types.
      */
+    const TerrainMethods *methods;
+
+};
+
+/**
+ * @struct terrain_methods holds the methods shared by all
+ * terrain types, so that each one needs only a single pointer to them.
+ */
+struct terrain_methods {
 
     /**
      * Destroy a terrain type when it is no longer needed.
@@ -47,20 +61,20 @@ struct terrain {
     void (*destroy) (Terrain *terrain);
 
     /**
-     * Write a terrain type to an already open file.
+     * Write a terrain type to a stream.
      * @param terrain is the terrain to write.
-     * @param output is the file to write to.
+     * @param output is the stream to write to.
      * @return 1 on success, 0 on failure.
      */
-    int (*write) (Terrain *terrain, FILE *output);
+    int (*write) (Terrain *terrain, Stream *output);
 
     /**
-     * Read a terrain type from an already open file.
+     * Read a terrain type from a stream.
      * @param terrain is the terrain to read.
-     * @param input is the file to read from.
+     * @param input is the stream to read from.
      * @return 1 on success, 0 on failure.
      */
-    int (*read) (Terrain *terrain, FILE *input);
+    int (*read) (Terrain *terrain, Stream *input);
 
 };
 
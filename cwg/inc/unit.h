@@ -10,10 +10,14 @@
 
 /* types defined in this header */
 typedef struct unit Unit;
+typedef struct unit_methods UnitMethods;
 
 #ifndef __UNIT_H__
 #define __UNIT_H__
 
+/* includes for required external type defs */
+#include "stream.h"
+
 /*----------------------------------------------------------------------
  * Data Definitions.
  */
@@ -48,9 +52,16 @@ struct unit {
     /** @var moves is the current movement points. */
     int moves;
 
-    /*
-     * Methods
-     */
+    /** @var methods points to the methods shared by all units. */
+    const UnitMethods *methods;
+
+};
+
+/**
+ * @struct unit_methods holds the methods shared by all units, so that
+ * each one needs only a single pointer to them.
+ */
+struct unit_methods {
 
     /**
      * Destroy a unit when no longer needed.
@@ -66,20 +77,30 @@ struct unit {
     Unit *(*clone) (Unit *unit);
 
     /**
-     * Write a unit to a file.
+     * Clone a unit into memory owned by something else, such as the
+     * block holding a whole battle. Destroying the clone leaves the
+     * memory alone.
+     * @param unit is the unit to clone.
+     * @param memory is where to put the clone.
+     * @return the new unit.
+     */
+    Unit *(*cloneinto) (Unit *unit, Unit *memory);
+
+    /**
+     * Write a unit to a stream.
      * @param unit is the unit to write.
-     * @param output is the output file handle.
+     * @param output is the output stream.
      * @return 1 if successful, 0 if not.
      */
-    int (*write) (Unit *unit, FILE *output);
+    int (*write) (Unit *unit, Stream *output);
 
     /**
-     * Read a unit from the file.
+     * Read a unit from a stream.
      * @param unit is the unit to read.
-     * @param input is the input file handle.
+     * @param input is the input stream.
      * @return 1 if successful, 0 if not.
      */
-    int (*read) (Unit *unit, FILE *input);
+    int (*read) (Unit *unit, Stream *input);
 
 };
 
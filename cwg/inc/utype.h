@@ -10,10 +10,14 @@
 
 /* types defined in this header */
 typedef struct unit_type UnitType;
+typedef struct unit_type_methods UnitTypeMethods;
 
 #ifndef __UTYPE_H__
 #define __UTYPE_H__
 
+/* includes for required external type defs */
+#include "stream.h"
+
 /*----------------------------------------------------------------------
  * Data Structures.
  */
@@ -51,10 +55,20 @@ struct unit_type {
     /** @var builds is the list of units that this one builds. */
     int builds[CWG_UTYPES];
 
-    /*
-     * Methods
+    /**
+     * @var methods points to the methods shared by all
+     * unit types.
      */
-    
+    const UnitTypeMethods *methods;
+
+};
+
+/**
+ * @struct unit_type_methods holds the methods shared by all
+ * unit types, so that each one needs only a single pointer to them.
+ */
+struct unit_type_methods {
+
     /**
      * Destroy a unit type when it is no longer needed.
      * @param utype is the unit type to destroy.
@@ -62,20 +76,20 @@ struct unit_type {
     void (*destroy) (UnitType *utype);
 
     /**
-     * Write the unit type to an already open file.
+     * Write the unit type to a stream.
      * @param utype is the unit type to write.
-     * @param output is the output file.
+     * @param output is the output stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*write) (UnitType *utype, FILE *output);
+    int (*write) (UnitType *utype, Stream *output);
 
     /**
-     * Read the unit type from an already open file.
+     * Read the unit type from a stream.
      * @param utype is the unit type to read.
-     * @param input is the input file.
+     * @param input is the input stream.
      * @return 1 on success, 0 on failure.
      */
-    int (*read) (UnitType *utype, FILE *input);
+    int (*read) (UnitType *utype, Stream *input);
 
 };
 
@@ -12,6 +12,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef CWG_DEBUG
+#include <assert.h>
+#endif
 
 /* project headers */
 #include "cwg.h"
@@ -22,125 +25,401 @@
 #include "unit.h"
 
 /*----------------------------------------------------------------------
- * Data Definitions.
+ * Private Level 1 Functions.
  */
 
-/** @var levels Difficulty levels for both sides. */
-static int levels[2] = {0, 0};
+#ifdef CWG_DEBUG
 
-/** @var movement Algorithm used for unit movement. */
-static int movement = CWG_MOVE_SMART;
+/**
+ * Check the battle's unit and victory point counts by scanning the map.
+ * This is the original victory check, kept in debug builds so that
+ * the counts kept as the battle changes can be checked against it.
+ * @param battle is the battle to check.
+ */
+static void scancounts (Battle *battle)
+{
+    int l, /* location counter */
+	pointcount[3], /* count of victory points per side & total */
+	unitcount[2], /* count of units per side */
+	vp; /* flag for current location being victory point */
+    Unit *unit; /* convenience pointer to current unit */
 
-/*----------------------------------------------------------------------
- * Private Level 1 Functions.
+    /* count units per side and victory points occupied */
+    pointcount[0] = pointcount[1] = pointcount[2] = 0;
+    unitcount[0] = unitcount[1] = 0;
+    for (l = 0; l < battle->map->width * battle->map->height; ++l) {
+	if ((vp = battle->map->points[l]))
+	    ++pointcount[2];
+	if (battle->map->units[l] != CWG_NO_UNIT) {
+	    unit = battle->units[battle->map->units[l]];
+	    if (unit->hits)
+		++unitcount[unit->side];
+	    if (vp)
+		++pointcount[unit->side];
+	}
+    }
+
+    /* compare them with the counts kept */
+    assert (unitcount[0] == battle->unitcount[0]);
+    assert (unitcount[1] == battle->unitcount[1]);
+    assert (pointcount[0] == battle->pointcount[0]);
+    assert (pointcount[1] == battle->pointcount[1]);
+    assert (pointcount[2] == battle->pointcount[2]);
+}
+
+/**
+ * Check the battle's roster, if it has one, against the units.
+ * @param battle is the battle to check.
+ */
+static void scanroster (Battle *battle)
+{
+    CwgRoster *roster; /* the roster */
+    Unit *unit; /* convenience pointer to current unit */
+    int c, /* slot counter */
+	alive; /* 1 if the roster has a live unit in the slot */
+    if (! (roster = battle->roster))
+	return;
+    for (c = 0; c < battle->unitcap; ++c) {
+	alive = (int) ((roster->alive[c / 32] >> (c % 32)) & 1);
+	unit = battle->units[c];
+	assert (alive == (unit && unit->hits));
+	if (unit) {
+	    assert (roster->side[c] == unit->side);
+	    assert (roster->utype[c] == unit->utype);
+	    assert (roster->x[c] == unit->x);
+	    assert (roster->y[c] == unit->y);
+	    assert (roster->hits[c] == unit->hits);
+	    assert (roster->moves[c] == unit->moves);
+	}
+    }
+}
+#endif
+
+/**
+ * Return a number from the battle's random number generator.
+ * This is a 32-bit xorshift generator, so a seeded battle gives the
+ * same numbers whatever the size of a long on the host.
+ * @param battle is the battle whose generator is used.
+ * @param range is the number of possible results.
+ * @return a number from 0 to range - 1.
+ */
+static int randomnumber (Battle *battle, int range)
+{
+    unsigned long x; /* generator state */
+    x = battle->rng;
+    x ^= (x << 13) & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xffffffffUL;
+    battle->rng = x;
+    return (int) (x % range);
+}
+
+/**
+ * Scramble the bits of a 32-bit number.
+ * Each input gives a different output, and similar inputs give very
+ * different outputs.
+ * @param x is the number to scramble.
+ * @return the scrambled number.
  */
+static unsigned long mixbits (unsigned long x)
+{
+    x &= 0xffffffffUL;
+    x ^= x >> 16;
+    x = (x * 0x85ebca6bUL) & 0xffffffffUL;
+    x ^= x >> 13;
+    x = (x * 0xc2b2ae35UL) & 0xffffffffUL;
+    x ^= x >> 16;
+    return x;
+}
 
 /**
- * Create a grid of travel costs from each map square to a destination.
+ * Toggle a key in the battle's hash.
+ * Keys are computed from what they represent rather than looked up in
+ * tables of random numbers, to save memory.
+ * @param battle is the battle whose hash is affected.
+ * @param what identifies the thing hashed.
+ * @param value is the state of the thing hashed.
+ */
+static void hashkey (Battle *battle, unsigned long what,
+		     unsigned long value)
+{
+    battle->hash[0] ^= mixbits (mixbits (what ^ CWG_HASH_SALT0) ^ value);
+    battle->hash[1] ^= mixbits (mixbits (what ^ CWG_HASH_SALT1) ^ value);
+}
+
+/**
+ * Toggle a unit's key in the battle's hash.
+ * @param battle is the battle whose hash is affected.
+ * @param unit is the unit to add or remove.
+ */
+static void hashunit (Battle *battle, Unit *unit)
+{
+    hashkey (battle,
+	     (unsigned long) (unit->x & 0xff)
+	     | (unsigned long) (unit->y & 0xff) << 8
+	     | (unsigned long) (unit->side & 1) << 16
+	     | (unsigned long) (unit->utype & 0xff) << 17,
+	     (unsigned long) (unit->hits & 0xffff)
+	     | (unsigned long) (unit->moves & 0xffff) << 16);
+}
+
+/**
+ * Toggle the keys for both sides' resources in the battle's hash.
+ * @param battle is the battle whose hash is affected.
+ */
+static void hashresources (Battle *battle)
+{
+    hashkey (battle, CWG_HASH_RESOURCES,
+	     (unsigned long) (battle->resources[0] & 0xffff));
+    hashkey (battle, CWG_HASH_RESOURCES + 1,
+	     (unsigned long) (battle->resources[1] & 0xffff));
+}
+
+/**
+ * Find the flat planes of terrain costs and defences, building them
+ * if need be.
  * @param battle is the battlefield.
- * @param unit is the unit concerned.
- * @param dx is the destination x coordinate.
- * @param dy is the destination y coordinate.
+ * @return the planes, or NULL if there is not enough memory.
+ */
+static CwgPlanes *makeplanes (Battle *battle)
+{
+    /* local variables */
+    CwgPlanes *planes; /* the planes */
+    Terrain *terrain; /* terrain of the current square */
+    int size, /* number of squares on the map */
+	l, /* location counter */
+	u; /* unit type counter */
+
+    /* return the planes if already built */
+    if (battle->planes)
+	return battle->planes;
+    if (! battle->terrain || ! battle->map)
+	return NULL;
+
+    /* allocate the moves with the header, and the defences apart,
+       as together they are too big for one block on the largest map */
+    size = battle->map->width * battle->map->height;
+    if (! (planes = malloc (sizeof (CwgPlanes) + CWG_UTYPES * size)))
+	return NULL;
+    if (! (planes->defence = malloc (CWG_UTYPES * size))) {
+	free (planes);
+	return NULL;
+    }
+    planes->users = 1;
+    planes->size = size;
+    planes->moves = (unsigned char *) (planes + 1);
+
+    /* copy in the terrain values */
+    for (l = 0; l < size; ++l) {
+	terrain = battle->terrain[(int) battle->map->terrain[l]];
+	for (u = 0; u < CWG_UTYPES; ++u) {
+	    planes->moves[u * size + l] = terrain->moves[u];
+	    planes->defence[u * size + l] = terrain->defence[u];
+	}
+    }
+
+    /* return the new planes */
+    return battle->planes = planes;
+}
+
+/**
+ * Find where the list of squares around a square starts in the rings.
+ * @param battle is the battlefield.
+ * @param x is the x coordinate of the square.
+ * @param y is the y coordinate of the square.
+ * @return the index of the first entry of the square's list.
+ */
+static int ringquarter (Battle *battle, int x, int y)
+{
+    return battle->rings->stride
+	* ((x >= battle->map->width / 2)
+	   + 2 * (y >= battle->map->height / 2));
+}
+
+/**
+ * Find the lists of squares around each square, building them if
+ * need be.
+ * @param battle is the battlefield.
+ * @return the rings, or NULL if there is not enough memory.
+ */
+static CwgRings *makerings (Battle *battle)
+{
+    /* local variables */
+    CwgRings *rings; /* the rings */
+    int width, /* width of the map */
+	height, /* height of the map */
+	radius, /* furthest ring to list */
+	stride, /* length of each list */
+	xdir, /* x direction towards map centre */
+	ydir, /* y direction towards map centre */
+	xo, /* x offset of a square in the ring */
+	yo, /* y offset of a square in the ring */
+	q, /* quarter of the map */
+	r, /* ring counter */
+	c; /* list entry counter */
+
+    /* return the rings if already built */
+    if (battle->rings)
+	return battle->rings;
+    if (! battle->map)
+	return NULL;
+
+    /* the radius is the longest range of any unit type */
+    radius = 1;
+    for (c = 0; c < CWG_UTYPES; ++c)
+	if (battle->utypes[c] && battle->utypes[c]->range > radius)
+	    radius = battle->utypes[c]->range;
+
+    /* allocate the lists and edges in the same block as their header */
+    width = battle->map->width;
+    height = battle->map->height;
+    stride = (2 * radius + 1) * (2 * radius + 1);
+    if (! (rings = malloc (sizeof (CwgRings)
+			   + (8 * stride + radius + 1) * sizeof (int)
+			   + width * height)))
+	return NULL;
+    rings->users = 1;
+    rings->radius = radius;
+    rings->stride = stride;
+    rings->offsets = (int *) (rings + 1);
+    rings->xoffsets = rings->offsets + 4 * stride;
+    rings->ends = rings->xoffsets + 4 * stride;
+    rings->edges = (unsigned char *) (rings->ends + radius + 1);
+
+    /* mark the squares on the edge of the map */
+    for (c = 0; c < width * height; ++c)
+	rings->edges[c] = c % width == 0 || c % width == width - 1
+	    || c < width || c >= width * (height - 1);
+
+    /* list the rings for each quarter of the map */
+    for (q = 0; q < 4; ++q) {
+	xdir = (q & 1) ? -1 : 1;
+	ydir = (q & 2) ? -1 : 1;
+	c = q * stride;
+	rings->offsets[c] = rings->xoffsets[c] = 0;
+	rings->ends[0] = 1;
+	++c;
+	for (r = 1; r <= radius; ++r) {
+	    for (xo = -r * xdir; xo != (r + 1) * xdir; xo += xdir)
+		for (yo = -r * ydir; yo != (r + 1) * ydir; yo += ydir)
+		    if (abs (xo) == r || abs (yo) == r) {
+			rings->offsets[c] = xo + width * yo;
+			rings->xoffsets[c++] = xo;
+		    }
+	    rings->ends[r] = c - q * stride;
+	}
+    }
+
+    /* return the new rings */
+    return battle->rings = rings;
+}
+
+/**
+ * Fill a grid of travel costs outwards from a square in order of cost.
+ * Terrain costs are small integers, so a ring of buckets indexed by
+ * cost serves as the priority queue. A square's cost is final when it
+ * is first reached, so each square is visited only once.
+ * @param battle is the battlefield.
+ * @param utype is the unit type travelling.
+ * @param ox is the x coordinate to search from.
+ * @param oy is the y coordinate to search from.
+ * @param blocking is 1 if units block the way, 0 to ignore them.
+ * @param limit is the highest cost to fill in, or 0 for no limit.
  * @return an array of costs for each square.
  */
-static int *getpathcosts (Battle *battle, Unit *unit, int dx, int dy)
+static int *searchcosts (Battle *battle, int utype, int ox, int oy,
+			 int blocking, int limit)
 {
     /* local variables */
+    unsigned char *plane; /* movement costs for the unit type */
     int *costs, /* travel cost grid */
+	*offsets, /* offsets to the squares around the one expanded */
+	*xoffsets, /* x offsets of those squares */
+	*links, /* next square in the same bucket */
+	*buckets, /* first square in each bucket */
+	count, /* number of buckets */
+	pending, /* number of squares waiting in the buckets */
+	level, /* cost level currently being expanded */
 	width, /* width of the map */
 	height, /* height of the map */
-	sx, /* start x coordinate of sweep */
-	sy, /* start y coordinate of sweep */
-	ex, /* end x coordinate of sweep */
-	ey, /* end y coordinate of sweep */
-	x, /* current x coordinate of sweep */
-	y, /* current y coordinate of sweep */
-	dir, /* current direction of sweep */
-	xo, /* x offset to examine */
-	yo, /* y offset to examine */
-	pos, /* 1-dimensional position with offset */
+	size, /* number of squares on the map */
+	pos, /* 1-dimensional position being expanded */
+	npos, /* 1-dimensional position of neighbour */
+	x, /* x coordinate being expanded */
+	nx, /* x coordinate of neighbour */
+	edge, /* 1 if the square expanded is on the edge of the map */
 	moves, /* movement cost into a square */
-	best, /* best cost met so far */
-	modified; /* 1 if costs modified this sweep */
+	ends, /* end of the neighbours in a square's list */
+	c; /* general counter */
     Map *map; /* map of the battlefield */
-    Terrain *terrain; /* terrain type of a map square */
+    CwgRings *rings; /* squares around each square */
 
     /* initialise */
     map = battle->map;
     width = map->width;
     height = map->height;
-    if (! (costs = calloc (width * height, sizeof (int))))
+    size = width * height;
+    if (! makeplanes (battle) || ! (rings = makerings (battle)))
 	return NULL;
 
-    /* shortcut for path to adjacent square */
-    if (abs (unit->x - dx) <= 1 && abs (unit->y - dy) <= 1) {
-	terrain = battle->terrain
-	    [(int) map->terrain[dx + width * dy]];
-	if (! (moves = terrain->moves[unit->utype]))
-	    costs[dx + width * dy] = 0;
-	else if (map->units[dx + width * dy] != CWG_NO_UNIT)
-	    costs[dx + width * dy] = 0;
-	else
-	    costs[dx + width * dy] = moves;
-	return costs;
-    }
-
-    /* outer loop - sweep map until all costs finalised */
-    costs[dx + width * dy] = 1;
-    sx = sy = 0;
-    ex = width - 1;
-    ey = height - 1;
-    dir = 1;
-    do {
-
-	/* inner loop - perform a single sweep */
-	modified = 0;
-	for (x = sx; x != ex + dir; x += dir)
-	    for (y = sy; y != ey + dir; y += dir) {
- 
-		/* don't check the destination or blocked squares */
-		if (x == dx && y == dy)
+    /* the order of the neighbours does not change the costs */
+    offsets = rings->offsets;
+    xoffsets = rings->xoffsets;
+    ends = rings->ends[1];
+    plane = battle->planes->moves + utype * battle->planes->size;
+
+    /* the bucket ring must be longer than the dearest step */
+    count = 1;
+    for (c = 0; c < CWG_TERRAIN; ++c)
+	if (battle->terrain[c] &&
+	    battle->terrain[c]->moves[utype] >= count)
+	    count = battle->terrain[c]->moves[utype] + 1;
+
+    /* the links and buckets share the costs grid's allocation */
+    if (! (costs = calloc (2 * size + count, sizeof (int))))
+	return NULL;
+    links = costs + size;
+    buckets = links + size;
+
+    /* seed the queue with the origin */
+    for (c = 0; c < count; ++c)
+	buckets[c] = -1;
+    pos = ox + width * oy;
+    costs[pos] = 1;
+    links[pos] = -1;
+    buckets[1 % count] = pos;
+    pending = 1;
+
+    /* expand the squares in order of increasing cost */
+    for (level = 1; pending; ++level)
+	while ((pos = buckets[level % count]) != -1) {
+	    buckets[level % count] = links[pos];
+	    --pending;
+	    if ((edge = rings->edges[pos]))
+		x = pos % width;
+
+	    /* reach the neighbours on the map not already costed */
+	    for (c = 1; c < ends; ++c) {
+		npos = pos + offsets[c];
+		if (edge) {
+		    nx = x + xoffsets[c];
+		    if (nx < 0 || nx >= width || npos < 0 || npos >= size)
+			continue;
+		}
+		if (costs[npos])
 		    continue;
-		terrain = battle->terrain
-		    [(int) map->terrain[x + width * y]];
-		if (! (moves = terrain->moves[unit->utype]))
+		if (blocking && map->units[npos] != CWG_NO_UNIT)
 		    continue;
-
-		/* inner inner loop - look around */
-		best = 0;
-		for (xo = -1; xo <= 1; ++xo)
-		    for (yo = -1; yo <= 1; ++yo) {
-			pos = (x + xo) + width * (y + yo);
-			if (xo == 0 && yo == 0)
-			    continue;
-			if (x + xo < 0 || x + xo >= width ||
-			    y + yo < 0 || y + yo >= height)
-			    continue;
-			if (map->units[x + width * y] != CWG_NO_UNIT)
-			    continue;
-			if ((costs[pos] > 0 ||
-			     (x + xo == dx && y + yo == dy)) &&
-			    (costs[pos] < best ||
-			     best == 0))
-			    best = costs[pos];
-		    }
-
-		/* modify square if better cost found */
-		if (costs[x + width * y] != best + moves && best != 0) {
-		    costs[x + width * y] = best + moves;
-		    modified = 1;
-		}
+		if (! (moves = plane[npos]))
+		    continue;
+		if (limit && level + moves > limit)
+		    continue;
+		costs[npos] = level + moves;
+		links[npos] = buckets[costs[npos] % count];
+		buckets[costs[npos] % count] = npos;
+		++pending;
 	    }
-
-	/* reverse direction for next sweep */
-	sx ^= ex;
-	ex ^= sx;
-	sx ^= ex;
-	sy ^= ey;
-	ey ^= sy;
-	sy ^= ey;
-	dir = -dir;
-    } while (modified);
+	}
 
     /* all done */
     return costs;
@@ -152,11 +431,528 @@ static int *getpathcosts (Battle *battle, Unit *unit, int dx, int dy)
  * @param  unit   The unit concerned.
  * @param  dx     The destination x coordinate.
  * @param  dy     The destination y coordinate.
- * @return        A dummy array that can be freed safely.
+ * @return        A dummy array, which quick movement ignores.
  */
 static int *ignorepathcosts (Battle *battle, Unit *unit, int dx, int dy)
 {
-    return malloc (1);
+    static int dummy = 0; /* the dummy cost grid */
+    return &dummy;
+}
+
+/**
+ * Discard all the path cost grids in the cache.
+ * @param battle is the battle whose cache is to be cleared.
+ */
+static void clearpathcache (Battle *battle)
+{
+    int c; /* cache entry counter */
+    for (c = 0; c < CWG_PATHCACHE; ++c) {
+	if (battle->pathcache[c].costs)
+	    free (battle->pathcache[c].costs);
+	battle->pathcache[c].costs = NULL;
+    }
+}
+
+/**
+ * Discard the rows of travel costs.
+ * @param battle is the battle whose rows are to be discarded.
+ */
+static void cleardistances (Battle *battle)
+{
+    int c; /* row counter */
+    if (battle->distances) {
+	for (c = 0; c < CWG_DISTANCES; ++c)
+	    if (battle->distances->rows[c])
+		free (battle->distances->rows[c]);
+	free (battle->distances->index);
+	free (battle->distances);
+	battle->distances = NULL;
+    }
+}
+
+/**
+ * Discard the journal of actions and the spare units it holds.
+ * @param battle is the battle whose journal is to be discarded.
+ */
+static void clearjournal (Battle *battle)
+{
+    int c; /* spare unit counter */
+    if (battle->journal) {
+	for (c = 0; c < battle->journal->sparecount; ++c)
+	    battle->journal->spares[c]->methods->destroy
+		(battle->journal->spares[c]);
+	free (battle->journal);
+	battle->journal = NULL;
+    }
+}
+
+/**
+ * Let go of the flat planes of terrain costs and defences, freeing
+ * them if no other battle shares them.
+ * @param battle is the battle whose planes are to be discarded.
+ */
+static void clearplanes (Battle *battle)
+{
+    if (battle->planes && ! --battle->planes->users) {
+	free (battle->planes->defence);
+	free (battle->planes);
+    }
+    battle->planes = NULL;
+}
+
+/**
+ * Let go of the lists of squares around each square, freeing them if
+ * no other battle shares them.
+ * @param battle is the battle whose rings are to be discarded.
+ */
+static void clearrings (Battle *battle)
+{
+    if (battle->rings && ! --battle->rings->users)
+	free (battle->rings);
+    battle->rings = NULL;
+}
+
+/**
+ * Discard the bitboards.
+ * @param battle is the battle whose bitboards are to be discarded.
+ */
+static void clearboards (Battle *battle)
+{
+    if (battle->boards) {
+	free (battle->boards);
+	battle->boards = NULL;
+    }
+}
+
+/**
+ * Rebuild the bitboards of squares held by each side.
+ * @param battle is the battle whose bitboards are to be rebuilt.
+ */
+static void boardsides (Battle *battle)
+{
+    CwgBoards *boards; /* the bitboards */
+    int l; /* location counter */
+    boards = battle->boards;
+    for (l = 0; l < CWG_BOARDWORDS; ++l)
+	boards->sides[0].bits[l] = boards->sides[1].bits[l] = 0;
+    for (l = 0; l < battle->map->width * battle->map->height; ++l)
+	if (battle->map->units[l] != CWG_NO_UNIT)
+	    boards->sides[battle->units[battle->map->units[l]]->side]
+		.bits[l / 32] |= 1UL << (l % 32);
+    boards->generation = battle->generation;
+}
+
+/**
+ * Update the bitboards when a unit arrives on or leaves a square.
+ * This must be called after the unit grid generation is incremented.
+ * @param battle is the battle whose bitboards are to be updated.
+ * @param side is the side of the unit.
+ * @param square is the square affected.
+ * @param present is 1 if the unit arrives, 0 if it leaves.
+ */
+static void boardunit (Battle *battle, int side, int square, int present)
+{
+    CwgBoards *boards; /* the bitboards */
+    if (! (boards = battle->boards))
+	return;
+    if (present)
+	boards->sides[side].bits[square / 32] |= 1UL << (square % 32);
+    else
+	boards->sides[side].bits[square / 32] &= ~(1UL << (square % 32));
+    boards->generation = battle->generation;
+}
+
+/**
+ * Discard the roster of unit fields.
+ * @param battle is the battle whose roster is to be discarded.
+ */
+static void clearroster (Battle *battle)
+{
+    if (battle->roster) {
+	free (battle->roster);
+	battle->roster = NULL;
+    }
+}
+
+/**
+ * Copy a unit's fields into the roster, if there is one.
+ * @param battle is the battle whose roster is to be updated.
+ * @param c is the unit's slot, which may now be empty.
+ */
+static void rosterunit (Battle *battle, int c)
+{
+    CwgRoster *roster; /* the roster */
+    Unit *unit; /* the unit to copy */
+    if (! (roster = battle->roster))
+	return;
+    roster->alive[c / 32] &= ~(1UL << (c % 32));
+    if (! (unit = battle->units[c]))
+	return;
+    roster->side[c] = (unsigned char) unit->side;
+    roster->utype[c] = (unsigned char) unit->utype;
+    roster->x[c] = (unsigned char) unit->x;
+    roster->y[c] = (unsigned char) unit->y;
+    roster->hits[c] = (unsigned char) unit->hits;
+    roster->moves[c] = (unsigned char) unit->moves;
+    if (unit->hits)
+	roster->alive[c / 32] |= 1UL << (c % 32);
+}
+
+/**
+ * Rebuild the roster of unit fields from the units.
+ * @param battle is the battle whose roster is to be rebuilt.
+ */
+static void fillroster (Battle *battle)
+{
+    int c; /* slot counter */
+    for (c = 0; c < CWG_SLOTWORDS; ++c)
+	battle->roster->alive[c] = 0;
+    for (c = 0; c < battle->unitcap; ++c)
+	rosterunit (battle, c);
+}
+
+/**
+ * Find the roster of unit fields, building it if need be.
+ * @param battle is the battle to examine.
+ * @return the roster, or NULL if there is not enough memory.
+ */
+static CwgRoster *makeroster (Battle *battle)
+{
+    if (! battle->roster) {
+	if (! (battle->roster = malloc (sizeof (CwgRoster))))
+	    return NULL;
+	fillroster (battle);
+    }
+    return battle->roster;
+}
+
+/**
+ * Set a run of consecutive squares on a bitboard.
+ * @param board is the bitboard to affect.
+ * @param first is the first square of the run.
+ * @param last is the last square of the run.
+ */
+static void setrun (CwgBoard *board, int first, int last)
+{
+    int word; /* word counter */
+    unsigned long mask; /* bits of the run within the word */
+    for (word = first / 32; word <= last / 32; ++word) {
+	mask = 0xffffffffUL;
+	if (word == first / 32)
+	    mask &= 0xffffffffUL << (first % 32);
+	if (word == last / 32)
+	    mask &= 0xffffffffUL >> (31 - last % 32);
+	board->bits[word] |= mask;
+    }
+}
+
+/**
+ * Get a blank unit, reusing a spare one from the journal if possible.
+ * @param battle is the battle that needs the unit.
+ * @return the unit, or NULL if there is not enough memory.
+ */
+static Unit *newunit (Battle *battle)
+{
+    Unit *unit; /* the unit to return */
+
+    /* create a new unit if there are no spares */
+    if (! battle->journal || ! battle->journal->sparecount)
+	return new_Unit ();
+
+    /* otherwise blank a spare unit and return it */
+    unit = battle->journal->spares[--battle->journal->sparecount];
+    *unit->name = '\0';
+    unit->utype = -1;
+    unit->side = 0;
+    unit->x = 0;
+    unit->y = 0;
+    unit->hits = 0;
+    unit->moves = 0;
+    return unit;
+}
+
+/**
+ * Save the state of a unit before an action is applied.
+ * @param battle is the battle to be affected.
+ * @param entry is the journal entry for the action.
+ * @param e is the entry slot to use, 0 or 1.
+ * @param unitid is the ID of the unit, or CWG_NO_UNIT.
+ */
+static void saveunit (Battle *battle, CwgUndo *entry, int e, int unitid)
+{
+    Unit *unit; /* the unit to save */
+    entry->units[e] = unitid;
+    if (unitid != CWG_NO_UNIT) {
+	unit = battle->units[unitid];
+	entry->x[e] = unit->x;
+	entry->y[e] = unit->y;
+	entry->hits[e] = unit->hits;
+	entry->moves[e] = unit->moves;
+    }
+}
+
+/**
+ * Put a unit into a slot, or empty the slot, keeping the mask of
+ * free slots and the roster up to date.
+ * @param battle is the battle to affect.
+ * @param c is the slot.
+ * @param unit is the unit to put there, or NULL to empty it.
+ */
+static void setslot (Battle *battle, int c, Unit *unit)
+{
+    battle->units[c] = unit;
+    if (unit)
+	battle->freeslots[c / 32] &= ~(1UL << (c % 32));
+    else
+	battle->freeslots[c / 32] |= 1UL << (c % 32);
+    rosterunit (battle, c);
+}
+
+/**
+ * Rebuild the mask of free slots from the unit list.
+ * @param battle is the battle to examine.
+ */
+static void findslots (Battle *battle)
+{
+    int c; /* slot counter */
+    for (c = 0; c < CWG_SLOTWORDS; ++c)
+	battle->freeslots[c] = 0;
+    for (c = 0; c < battle->unitcap; ++c)
+	if (! battle->units[c])
+	    battle->freeslots[c / 32] |= 1UL << (c % 32);
+}
+
+/**
+ * Find the lowest free slot for a new unit.
+ * @param battle is the battle to examine.
+ * @return the free slot, which is just beyond the unit list if the
+ * list is full but can grow, or CWG_NO_UNIT if there is none.
+ */
+static int freeslot (Battle *battle)
+{
+    unsigned long word; /* word of the free slot mask */
+    int w, /* word counter */
+	b; /* bit counter */
+    for (w = 0; w < CWG_SLOTWORDS; ++w)
+	if ((word = battle->freeslots[w])) {
+	    for (b = 0; ! (word & 1); ++b)
+		word >>= 1;
+	    return 32 * w + b;
+	}
+    return battle->unitcap < CWG_MAXUNITS ? battle->unitcap : CWG_NO_UNIT;
+}
+
+/**
+ * Check whether the unit list lies in a clone's block of memory,
+ * rather than being allocated by itself.
+ * @param battle is the battle to examine.
+ * @return 1 if the list is in the battle's block, 0 if not.
+ */
+static int blockslots (Battle *battle)
+{
+    return (void *) battle->units == (void *) (battle + 1);
+}
+
+/**
+ * Grow the unit list until it includes a given slot, doubling it
+ * each time. A list in a clone's block is copied out rather than
+ * reallocated.
+ * @param battle is the battle to affect.
+ * @param c is the slot that must be in the list.
+ * @return 1 on success, 0 if there is not enough memory.
+ */
+static int growslots (Battle *battle, int c)
+{
+    Unit **units; /* the grown unit list */
+    int cap; /* the new number of slots */
+
+    /* see how far the list must grow */
+    if (c < battle->unitcap)
+	return 1;
+    cap = battle->unitcap;
+    while (c >= cap)
+	cap *= 2;
+    if (cap > CWG_MAXUNITS)
+	cap = CWG_MAXUNITS;
+
+    /* move the list to a larger table */
+    if (! blockslots (battle))
+	units = realloc (battle->units, cap * sizeof (Unit *));
+    else if ((units = malloc (cap * sizeof (Unit *))))
+	memcpy (units, battle->units, battle->unitcap * sizeof (Unit *));
+    if (! units)
+	return 0;
+    battle->units = units;
+
+    /* clear the new slots */
+    for (; battle->unitcap < cap; ++battle->unitcap)
+	setslot (battle, battle->unitcap, NULL);
+    return 1;
+}
+
+/**
+ * Take a unit out of its slot, keeping it for reuse if the journal
+ * has room, or destroying it if not.
+ * @param battle is the battle to affect.
+ * @param c is the slot holding the unit.
+ */
+static void dropunit (Battle *battle, int c)
+{
+    Unit *unit; /* the unit to drop */
+    unit = battle->units[c];
+    setslot (battle, c, NULL);
+    if (battle->journal && battle->journal->sparecount < CWG_MAXUNITS)
+	battle->journal->spares[battle->journal->sparecount++] = unit;
+    else
+	unit->methods->destroy (unit);
+}
+
+/**
+ * Check whether one unit may attack another.
+ * @param battle is the battle to examine.
+ * @param unit is the unit to attack with.
+ * @param target is the target to attack.
+ * @return 1 if the attack is allowed, 0 if not.
+ */
+static int canattack (Battle *battle, Unit *unit, Unit *target)
+{
+    /* local variables */
+    int distance; /* distance from unit to target */
+
+    /* validation */
+    if (! battle->utypes)
+	return 0;
+    if (! battle->terrain)
+	return 0;
+    if (unit->side != battle->side)
+	return 0;
+    if (target->side == battle->side)
+	return 0;
+    if (! unit->moves)
+	return 0;
+
+    /* is the target within range? */
+    distance = abs (unit->x - target->x) > abs (unit->y - target->y) ?
+	abs (unit->x - target->x) : abs (unit->y - target->y);
+    return distance <= battle->utypes[unit->utype]->range;
+}
+
+/**
+ * Check whether a unit may build another on a square.
+ * The battle's own list of unit types that can be built is left to
+ * the caller to check.
+ * @param battle is the battle to examine.
+ * @param src is the unit doing the building.
+ * @param utype is the unit type to build.
+ * @param x is the x coordinate to place the new unit.
+ * @param y is the y coordinate to place the new unit.
+ * @return 1 if the building is allowed, 0 if not.
+ */
+static int cancreate (Battle *battle, Unit *src, int utype, int x, int y)
+{
+    /* local variables */
+    UnitType *srctype; /* builder unit type */
+    Map *map; /* the battlefield map */
+
+    /* validation */
+    if (! battle->utypes)
+	return 0;
+    if (! battle->terrain)
+	return 0;
+
+    /* initialisation */
+    srctype = battle->utypes[src->utype];
+    map = battle->map;
+
+    /* more validation */
+    if (battle->side != src->side)
+	return 0;
+    if (map->units[x + map->width * y] != CWG_NO_UNIT)
+	return 0;
+    if (! srctype->builds[utype])
+	return 0;
+    if (src->moves < srctype->moves)
+	return 0;
+    if (battle->resources[battle->side] < battle->utypes[utype]->cost)
+	return 0;
+    if (map->methods->distance (x, y, src->x, src->y, 0) > 1)
+	return 0;
+    if (battle->terrain[map->terrain[x + map->width * y]]->moves[utype]
+	== 0)
+	return 0;
+
+    /* the building is allowed */
+    return 1;
+}
+
+/**
+ * Check whether one unit may repair another.
+ * @param battle is the battle to examine.
+ * @param builder is the unit doing the repairing.
+ * @param built is the unit to repair.
+ * @return 1 if the repair is allowed, 0 if not.
+ */
+static int canrestore (Battle *battle, Unit *builder, Unit *built)
+{
+    /* local variables */
+    UnitType *srctype, /* unit type of the builder */
+	*tgttype; /* unit type of the unit to repair */
+    int sx, /* x coordinate of the builder */
+	sy, /* y coordinate of the builder */
+	tx, /* x coordinate of the target */
+	ty, /* y coordinate of the target */
+	distance; /* distance from source to target */
+
+    /* validation */
+    if (! battle->utypes)
+	return 0;
+    if (! battle->terrain)
+	return 0;
+
+    /* initialisation */
+    srctype = battle->utypes[builder->utype];
+    sx = builder->x;
+    sy = builder->y;
+    tgttype = battle->utypes[built->utype];
+    tx = built->x;
+    ty = built->y;
+    distance = abs (sx - tx) > abs (sy - ty) ?
+	abs (sx - tx) : abs (sy - ty);
+
+    /* more validation */
+    if (distance != 1)
+	return 0;
+    if (! srctype->builds[built->utype])
+	return 0;
+    if (builder->moves < srctype->moves / 2)
+	return 0;
+    if (builder->side != battle->side)
+	return 0;
+    if (built->side != battle->side)
+	return 0;
+    if (battle->resources[battle->side] < tgttype->cost / 2)
+	return 0;
+    if (built->hits >= tgttype->hits)
+	return 0;
+
+    /* the repair is allowed */
+    return 1;
+}
+
+/**
+ * Add an action to a list if there is room for it.
+ * @param list is the list of actions.
+ * @param size is the number of actions the list can hold.
+ * @param count is the number of actions found so far.
+ * @param action is the action to add.
+ * @return the new number of actions found.
+ */
+static int listaction (CwgAction *list, int size, int count,
+		       CwgAction *action)
+{
+    if (count < size)
+	list[count] = *action;
+    return count + 1;
 }
 
 /**
@@ -172,54 +968,59 @@ static int movenextsquare (Battle *battle, Unit *unit, int dx, int dy,
 			   int *costs)
 {
     /* local variables */
-    int xo, /* x offset to check */
-	yo, /* y offset to check */
-	xdir, /* x direction towards map centre */
-	ydir, /* y direction towards map centre */
+    int *offsets, /* offsets to the squares around the unit */
+	*xoffsets, /* x offsets of those squares */
 	best, /* best cost of potential next square */
 	cost, /* cost of potential next square */
 	x, /* current x coordinate of unit */
 	y, /* current y coordinate of unit */
 	width, /* width of the map */
-	height, /* height of the map */
+	pos, /* 1-dimensional position of the unit */
+	npos, /* 1-dimensional position of a neighbour */
+	ends, /* end of the neighbours in the unit's list */
+	c, /* neighbour counter */
 	nx, /* next x coordinate */
 	ny; /* next y coordinate */
     Map *map; /* map of the battlefield */
-    Terrain *terrain; /* terrain to move into */
+    CwgRings *rings; /* squares around each square */
 
     /* initialise */
     map = battle->map;
     width = map->width;
-    height = map->height;
     x = unit->x;
     y = unit->y;
+    pos = x + width * y;
     nx = ny = -1;
     best = 0;
-    xdir = (x < width / 2) - (x >= width / 2);
-    ydir = (y < height / 2) - (y >= height / 2);
 
     /* validate */
     if (x == dx && y == dy)
 	return 0;
+    if (! (rings = makerings (battle)))
+	return 0;
 
-    /* find the best adjacent square */
-    for (xo = -xdir; xo != 2 * xdir; xo += xdir)
-	for (yo = -ydir; yo != 2 * ydir; yo += ydir) {
-	    if (x + xo < 0 || x + xo >= width ||
-		y + yo < 0 || y + yo >= height ||
-		(xo == 0 && yo == 0))
-		continue;
-	    if (! (cost = costs[(x + xo) + width * (y + yo)]));
-	    else if (cost < best || best == 0) {
-		best = cost;
-		nx = x + xo;
-		ny = y + yo;
-	    } else if (cost <= best && (xo == 0 || yo == 0)) {
-		best = cost;
-		nx = x + xo;
-		ny = y + yo;
-	    }
+    /* find the best adjacent square, preferring orthogonal steps */
+    c = ringquarter (battle, x, y);
+    offsets = rings->offsets + c;
+    xoffsets = rings->xoffsets + c;
+    ends = rings->ends[1];
+    for (c = 1; c < ends; ++c) {
+	npos = pos + offsets[c];
+	if (rings->edges[pos]
+	    && (x + xoffsets[c] < 0 || x + xoffsets[c] >= width
+		|| npos < 0 || npos >= width * map->height));
+	else if (! (cost = costs[npos]));
+	else if (cost < best || best == 0) {
+	    best = cost;
+	    nx = npos % width;
+	    ny = npos / width;
+	} else if (cost <= best
+		   && (abs (npos - pos) == 1 || abs (npos - pos) == width)) {
+	    best = cost;
+	    nx = npos % width;
+	    ny = npos / width;
 	}
+    }
 
     /* return now if we couldn't find a square */
     if (nx == -1 || ny == -1)
@@ -230,17 +1031,27 @@ static int movenextsquare (Battle *battle, Unit *unit, int dx, int dy,
 	return 0;
 
     /* return if we lack enough movement points */
-    terrain = battle->terrain[(int) map->terrain[nx + width * ny]];
-    cost = terrain->moves[unit->utype];
+    if (! makeplanes (battle))
+	return 0;
+    cost = battle->planes->moves
+	[unit->utype * battle->planes->size + nx + width * ny];
     if (cost == 0 || cost > unit->moves)
 	return 0;
 
     /* otherwise move the unit */
     map->units[nx + width * ny] = map->units[x + width * y];
     map->units[x + width * y] = CWG_NO_UNIT;
+    ++battle->generation;
+    boardunit (battle, unit->side, x + width * y, 0);
+    boardunit (battle, unit->side, nx + width * ny, 1);
+    battle->pointcount[unit->side] -= map->points[x + width * y] != 0;
+    battle->pointcount[unit->side] += map->points[nx + width * ny] != 0;
+    hashunit (battle, unit);
     unit->x = nx;
     unit->y = ny;
     unit->moves -= cost;
+    hashunit (battle, unit);
+    rosterunit (battle, map->units[nx + width * ny]);
     return 1;
 }
 
@@ -268,25 +1079,27 @@ static int quicknextsquare (Battle *battle, Unit *unit, int dx, int dy,
 	bestx, /* best next step X coordinate */
 	besty, /* best next step Y coordinate */
 	bestl; /* best location as a single value */
-    Terrain *terrain; /* terrain to check */
+    unsigned char *plane; /* movement costs for the unit type */
 
     /* get general direction of travel */
+    if (! makeplanes (battle))
+	return 0;
+    plane = battle->planes->moves + unit->utype * battle->planes->size;
     xdir = (dx > unit->x) - (dx < unit->x);
     ydir = (dy > unit->y) - (dy < unit->y);
     bestx = unit->x + xdir;
     besty = unit->y + ydir;
     bestl = bestx + battle->map->width * besty;
-    if (battle->map->units[bestl] == CWG_NO_UNIT) {
-	terrain = battle->terrain[battle->map->terrain[bestl]];
-	best = terrain->moves[unit->utype];
-    } else
+    if (battle->map->units[bestl] == CWG_NO_UNIT)
+	best = plane[bestl];
+    else
 	best = 0;
 
     /* if more than one square away, work out quickest direction */
-    if (battle->map->distance (unit->x, unit->y, dx, dy, 0) > 1) {
+    if (battle->map->methods->distance (unit->x, unit->y, dx, dy, 0) > 1) {
 
 	/* check oblique routes */
-	hand = (2 * rand () % 2) - 1;
+	hand = 2 * randomnumber (battle, 2) - 1;
 	for (step = -1; step <= 1; step += 2) {
 
 	    /* where is the next step? */
@@ -306,10 +1119,9 @@ static int quicknextsquare (Battle *battle, Unit *unit, int dx, int dy,
 	    stepl = stepx + battle->map->width * stepy;
 
 	    /* check the next step */
-	    if (battle->map->units[stepl] == CWG_NO_UNIT) {
-		terrain = battle->terrain[battle->map->terrain[stepl]];
-		stepc = terrain->moves[unit->utype];
-	    } else
+	    if (battle->map->units[stepl] == CWG_NO_UNIT)
+		stepc = plane[stepl];
+	    else
 		stepc = 0;
 	    if ((stepc < best || best == 0) && stepc != 0) {
 		best = stepc;
@@ -329,8 +1141,7 @@ static int quicknextsquare (Battle *battle, Unit *unit, int dx, int dy,
 	return 0;
 
     /* return if we lack enough movement points */
-    terrain = battle->terrain[bestl];
-    if (best == 0 || best > unit->moves)
+    if (best > unit->moves)
 	return 0;
 
     /* otherwise move the unit */
@@ -338,9 +1149,19 @@ static int quicknextsquare (Battle *battle, Unit *unit, int dx, int dy,
 	= battle->map->units[unit->x + battle->map->width * unit->y];
     battle->map->units[unit->x + battle->map->width * unit->y]
 	= CWG_NO_UNIT;
+    ++battle->generation;
+    boardunit (battle, unit->side,
+	       unit->x + battle->map->width * unit->y, 0);
+    boardunit (battle, unit->side, bestl, 1);
+    battle->pointcount[unit->side] -=
+	battle->map->points[unit->x + battle->map->width * unit->y] != 0;
+    battle->pointcount[unit->side] += battle->map->points[bestl] != 0;
+    hashunit (battle, unit);
     unit->x = bestx;
     unit->y = besty;
     unit->moves -= best;
+    hashunit (battle, unit);
+    rosterunit (battle, battle->map->units[bestl]);
     return 1;
 }
 
@@ -354,7 +1175,6 @@ static int quicknextsquare (Battle *battle, Unit *unit, int dx, int dy,
 static int fireupon (Battle *battle, Unit *unit, Unit *target)
 {
     /* local variables */
-    Terrain *terrain; /* target terrain */
     Map *map; /* the battlefield map */
     int ux, /* unit x coordinate */
 	uy, /* unit y coordinate */
@@ -365,7 +1185,9 @@ static int fireupon (Battle *battle, Unit *unit, Unit *target)
 	defence, /* defence value of target */
 	damage, /* damage caused to target */
 	roll, /* damage roll */
-	r; /* roll counter for higher difficulty */
+	r, /* roll counter for higher difficulty */
+	unitid, /* ID of the unit */
+	targetid; /* ID of the target */
 
     /* initialise unit and terrain information */
     map = battle->map;
@@ -373,7 +1195,8 @@ static int fireupon (Battle *battle, Unit *unit, Unit *target)
     uy = unit->y;
     tx = target->x;
     ty = target->y;
-    terrain = battle->terrain[(int) map->terrain[tx + map->width * ty]];
+    unitid = map->units[ux + map->width * uy];
+    targetid = map->units[tx + map->width * ty];
 
     /* validation */
     distance = abs (ux - tx) > abs (uy - ty) ?
@@ -382,16 +1205,20 @@ static int fireupon (Battle *battle, Unit *unit, Unit *target)
 	return 0;
     if (! unit->moves)
 	return 0;
+    if (! makeplanes (battle))
+	return 0;
 
     /* calculate attack and defence values */
     attack = battle->utypes[unit->utype]->power;
     defence = battle->utypes[target->utype]->armour +
-	terrain->defence[target->utype];
+	battle->planes->defence[target->utype * battle->planes->size
+				+ tx + map->width * ty];
 
     /* calculate damage */
     damage = 0;
-    for (r = 0; r <= levels[unit->side]; ++r) {
-	roll = rand () % (1 + attack) - rand () % (1 + defence);
+    for (r = 0; r <= battle->levels[unit->side]; ++r) {
+	roll = randomnumber (battle, 1 + attack);
+	roll -= randomnumber (battle, 1 + defence);
 	if (roll > damage)
 	    damage = roll;
     }
@@ -399,15 +1226,249 @@ static int fireupon (Battle *battle, Unit *unit, Unit *target)
     damage = damage > target->hits ? target->hits : damage;
 
     /* reduce target hits and remove from map if killed */
+    hashunit (battle, target);
     target->hits -= damage;
-    if (target->hits == 0)
+    hashunit (battle, target);
+    if (target->hits == 0) {
 	map->units[tx + map->width * ty] = CWG_NO_UNIT;
+	++battle->generation;
+	boardunit (battle, target->side, tx + map->width * ty, 0);
+	--battle->unitcount[target->side];
+	battle->pointcount[target->side] -=
+	    map->points[tx + map->width * ty] != 0;
+    }
 
     /* firing successful */
+    hashunit (battle, unit);
     unit->moves = 0;
+    hashunit (battle, unit);
+    rosterunit (battle, targetid);
+    rosterunit (battle, unitid);
     return 1;
 }
 
+/*----------------------------------------------------------------------
+ * Private Level 2 Functions.
+ */
+
+/**
+ * Calculate the battle's hash from scratch.
+ * @param battle is the battle to hash.
+ */
+static void hashbattle (Battle *battle)
+{
+    int c; /* unit counter */
+    battle->hash[0] = battle->hash[1] = 0;
+    for (c = 0; c < battle->unitcap; ++c)
+	if (battle->units[c])
+	    hashunit (battle, battle->units[c]);
+    hashresources (battle);
+    if (battle->side)
+	hashkey (battle, CWG_HASH_SIDE, 0);
+}
+
+/**
+ * Count the live units and victory points held by each side.
+ * @param battle is the battle to count.
+ */
+static void countbattle (Battle *battle)
+{
+    int l; /* location counter */
+    Unit *unit; /* unit on the current location */
+
+    /* clear the counts */
+    battle->unitcount[0] = battle->unitcount[1] = 0;
+    battle->pointcount[0] = battle->pointcount[1] = 0;
+    battle->pointcount[2] = 0;
+    if (! battle->map)
+	return;
+
+    /* count units per side and victory points occupied */
+    for (l = 0; l < battle->map->width * battle->map->height; ++l) {
+	if (battle->map->points[l])
+	    ++battle->pointcount[2];
+	if (battle->map->units[l] != CWG_NO_UNIT) {
+	    unit = battle->units[battle->map->units[l]];
+	    if (unit->hits)
+		++battle->unitcount[unit->side];
+	    if (battle->map->points[l])
+		++battle->pointcount[unit->side];
+	}
+    }
+}
+
+/**
+ * Create a grid of travel costs from each map square to a destination.
+ * @param battle is the battlefield.
+ * @param unit is the unit concerned.
+ * @param dx is the destination x coordinate.
+ * @param dy is the destination y coordinate.
+ * @return an array of costs for each square.
+ */
+static int *getpathcosts (Battle *battle, Unit *unit, int dx, int dy)
+{
+    /* local variables */
+    int *costs, /* travel cost grid */
+	width, /* width of the map */
+	height, /* height of the map */
+	moves; /* movement cost into a square */
+    Map *map; /* map of the battlefield */
+
+    /* initialise */
+    map = battle->map;
+    width = map->width;
+    height = map->height;
+
+    /* shortcut for path to adjacent square */
+    if (abs (unit->x - dx) <= 1 && abs (unit->y - dy) <= 1) {
+	if (! makeplanes (battle))
+	    return NULL;
+	if (! (costs = calloc (width * height, sizeof (int))))
+	    return NULL;
+	if (! (moves = battle->planes->moves
+	       [unit->utype * battle->planes->size + dx + width * dy]))
+	    costs[dx + width * dy] = 0;
+	else if (map->units[dx + width * dy] != CWG_NO_UNIT)
+	    costs[dx + width * dy] = 0;
+	else
+	    costs[dx + width * dy] = moves;
+	return costs;
+    }
+
+    /* search outwards from the destination */
+    if (! (costs = searchcosts (battle, unit->utype, dx, dy, 1, 0)))
+	return NULL;
+
+    /* all done */
+    return costs;
+}
+
+/**
+ * Find the row of travel costs from a square, building it if need be.
+ * @param battle is the battlefield.
+ * @param utype is the unit type travelling.
+ * @param ox is the x coordinate of the origin.
+ * @param oy is the y coordinate of the origin.
+ * @return the row of travel costs, or NULL on failure.
+ */
+static unsigned short *getdistances (Battle *battle, int utype,
+				     int ox, int oy)
+{
+    /* local variables */
+    CwgDistances *distances; /* the battle's travel cost rows */
+    int *costs, /* travel cost grid from the origin */
+	size, /* number of squares on the map */
+	key, /* index entry for the unit type and origin */
+	row, /* row number */
+	c; /* general counter */
+    long rowbytes; /* bytes in each row */
+
+    /* set up the index when first needed */
+    size = battle->map->width * battle->map->height;
+    rowbytes = (long) size * sizeof (unsigned short);
+    if (! (distances = battle->distances)) {
+	if (! (distances = malloc (sizeof (CwgDistances))))
+	    return NULL;
+	if (! (distances->index = malloc (CWG_UTYPES * size))) {
+	    free (distances);
+	    return NULL;
+	}
+	for (c = 0; c < CWG_UTYPES * size; ++c)
+	    distances->index[c] = -1;
+	for (c = 0; c < CWG_DISTANCES; ++c) {
+	    distances->owners[c] = -1;
+	    distances->rows[c] = NULL;
+	}
+	distances->count = CWG_DISTANCEBYTES / rowbytes < CWG_DISTANCES
+	    ? (int) (CWG_DISTANCEBYTES / rowbytes)
+	    : CWG_DISTANCES;
+	if (! distances->count)
+	    distances->count = 1;
+	distances->next = 0;
+	battle->distances = distances;
+    }
+
+    /* return the row if it has already been built */
+    key = utype * size + ox + battle->map->width * oy;
+    if ((row = distances->index[key]) != -1)
+	return distances->rows[row];
+
+    /* otherwise search the terrain from the origin */
+    row = distances->next;
+    if (! distances->rows[row] &&
+	! (distances->rows[row] = malloc ((unsigned int) rowbytes)))
+	return NULL;
+    if (! (costs = searchcosts (battle, utype, ox, oy, 0, 0)))
+	return NULL;
+    for (c = 0; c < size; ++c)
+	distances->rows[row][c] = (unsigned short) costs[c];
+    free (costs);
+
+    /* index the new row in place of the one it replaced */
+    if (distances->owners[row] != -1)
+	distances->index[distances->owners[row]] = -1;
+    distances->owners[row] = key;
+    distances->index[key] = row;
+    distances->next = (row + 1) % distances->count;
+    return distances->rows[row];
+}
+
+/*----------------------------------------------------------------------
+ * Private Level 3 Functions.
+ */
+
+/**
+ * Find a grid of travel costs in the cache, or compute and cache it.
+ * Grids stay valid until the unit grid changes, so units of one type
+ * heading for the same square can share one search.
+ * @param battle is the battlefield.
+ * @param unit is the unit concerned.
+ * @param dx is the destination x coordinate.
+ * @param dy is the destination y coordinate.
+ * @return a cost grid owned by the cache.
+ */
+static int *findpathcosts (Battle *battle, Unit *unit, int dx, int dy)
+{
+    /* local variables */
+    CwgPathCache *entry, /* cache entry being checked */
+	*spare; /* cache entry to fill on a miss */
+    int dest, /* destination square as a single value */
+	adjacent, /* 1 if the destination is next to the unit */
+	c; /* cache entry counter */
+
+    /* look for a grid computed since the unit grid last changed */
+    dest = dx + battle->map->width * dy;
+    adjacent = abs (unit->x - dx) <= 1 && abs (unit->y - dy) <= 1;
+    spare = NULL;
+    for (c = 0; c < CWG_PATHCACHE; ++c) {
+	entry = &battle->pathcache[c];
+	if (! entry->costs || entry->generation != battle->generation) {
+	    if (! spare)
+		spare = entry;
+	} else if (entry->utype == unit->utype &&
+		   entry->dest == dest &&
+		   (adjacent || ! entry->adjacent)) {
+	    ++battle->pathhits;
+	    return entry->costs;
+	}
+    }
+
+    /* if every grid is current, replace one in rotation */
+    if (! spare)
+	spare = &battle->pathcache[battle->pathmisses % CWG_PATHCACHE];
+    ++battle->pathmisses;
+
+    /* compute the grid and remember it */
+    if (spare->costs)
+	free (spare->costs);
+    spare->utype = unit->utype;
+    spare->dest = dest;
+    spare->adjacent = adjacent;
+    spare->generation = battle->generation;
+    spare->costs = getpathcosts (battle, unit, dx, dy);
+    return spare->costs;
+}
+
 /*----------------------------------------------------------------------
  * Public Level Functions.
  */
@@ -420,17 +1481,26 @@ static void destroy (Battle *battle)
 {
     int c; /* unit counter */
     if (battle) {
-	for (c = 0; c < CWG_UNITS; ++c)
+	for (c = 0; c < battle->unitcap; ++c)
 	    if (battle->units[c])
-		battle->units[c]->destroy (battle->units[c]);
+		battle->units[c]->methods->destroy (battle->units[c]);
 	if (battle->map)
-	    battle->map->destroy (battle->map);
+	    battle->map->methods->destroy (battle->map);
+	clearpathcache (battle);
+	cleardistances (battle);
+	clearjournal (battle);
+	clearboards (battle);
+	clearplanes (battle);
+	clearrings (battle);
+	clearroster (battle);
+	if (! blockslots (battle))
+	    free (battle->units);
 	free (battle);
     }
 }
 
 /**
- * Clone a battle state.
+ * Clone a battle state into a single block of memory.
  * @param battle is the battle to clone.
  * @return a copy of the battle.
  */
@@ -438,42 +1508,60 @@ static Battle *clone (Battle *battle)
 {
     /* local variables */
     Battle *newbattle; /* the copy of the battle */
-    Unit *unit; /* pointer to a unit to be cloned */
+    Unit **slots, /* the unit list within the block */
+	*units, /* the unit slots within the block */
+	*unit; /* pointer to a unit to be cloned */
+    Map *map; /* the map within the block */
     int c; /* array counter */
 
-    /* reserve memory for the new battle */
-    if (! (newbattle = new_Battle (battle->utypes, battle->terrain)))
+    /* reserve one block for the battle, its units and its map */
+    if (! (newbattle = malloc (sizeof (Battle)
+			       + sizeof (Unit *) * battle->unitcap
+			       + sizeof (Unit) * battle->unitcap
+			       + sizeof (Map)
+			       + battle->map->width * battle->map->height)))
 	return NULL;
-
-    /* clone the simple attributes */
-    newbattle->start = battle->start;
-    newbattle->side = battle->side;
-    newbattle->resources[0] = battle->resources[0];
-    newbattle->resources[1] = battle->resources[1];
-
-    /* clone the arrays */
-    for (c = 0; c < CWG_UTYPES; ++c)
-	newbattle->builds[c] = battle->builds[c];
-    for (c = 0; c < CWG_UNITS; ++c)
-	if ((unit = battle->units[c]))
-	    newbattle->units[c] = unit->clone (unit);
-	else
-	    newbattle->units[c] = NULL;
-
-    /* clone the map */
-    newbattle->map = battle->map->clone (battle->map);
+    slots = (Unit **) (newbattle + 1);
+    units = (Unit *) (slots + battle->unitcap);
+    map = (Map *) (units + battle->unitcap);
+
+    /* copy the battle, then fix the pointers that it cannot share */
+    *newbattle = *battle;
+    newbattle->generation = 0;
+    for (c = 0; c < CWG_PATHCACHE; ++c)
+	newbattle->pathcache[c].costs = NULL;
+    newbattle->pathhits = 0;
+    newbattle->pathmisses = 0;
+    newbattle->distances = NULL;
+    newbattle->journal = NULL;
+    newbattle->boards = NULL;
+    newbattle->roster = NULL;
+
+    /* clone the unit list, units and map into the block */
+    newbattle->units = slots;
+    for (c = 0; c < battle->unitcap; ++c)
+	slots[c] = (unit = battle->units[c])
+	    ? unit->methods->cloneinto (unit, &units[c])
+	    : NULL;
+    newbattle->map = battle->map->methods->cloneinto (battle->map, map);
+
+    /* share the tables built from the terrain */
+    if (newbattle->planes)
+	++newbattle->planes->users;
+    if (newbattle->rings)
+	++newbattle->rings->users;
 
     /* return the new battle */
     return newbattle;
 }
 
 /**
- * Write the battle to an already open file.
+ * Write the battle to a stream.
  * @param battle is the battle to write.
- * @param output is the output file.
+ * @param output is the output stream.
  * @return 1 on success, 0 on failure.
  */
-static int write (Battle *battle, FILE *output)
+static int write (Battle *battle, Stream *output)
 {
     /* local variables */
     int c, /* array counter */
@@ -497,16 +1585,18 @@ static int write (Battle *battle, FILE *output)
 	s &= cwg->writeint (&battle->builds[c], output);
 
     /* write the map */
-    s &= battle->map->write (battle->map, output);
+    s &= battle->map->methods->write (battle->map, output);
 
     /* write the units on the map */
-    for (c = 0; c < CWG_UNITS; ++c) {
+    for (c = 0; c < battle->unitcap; ++c) {
 	if (battle->units[c]) {
 	    unitid = c;
 	    s &= cwg->writeint (&unitid, output);
-	    s &= battle->units[c]->write (battle->units[c], output);
+	    s &= battle->units[c]->methods->write (battle->units[c], output);
 	}
     }
+
+    /* mark the end of the units */
     unitid = CWG_NO_UNIT;
     s &= cwg->writeint (&unitid, output);
 
@@ -515,12 +1605,12 @@ static int write (Battle *battle, FILE *output)
 }
 
 /**
- * Read the battle from an already open file.
+ * Read the battle from a stream.
  * @param battle is the battle to read.
- * @param input is the input file.
+ * @param input is the input stream.
  * @return 1 on success, 0 on failure.
  */
-static int read (Battle *battle, FILE *input)
+static int read (Battle *battle, Stream *input)
 {
     /* local variables */
     int c, /* array counter */
@@ -545,22 +1635,40 @@ static int read (Battle *battle, FILE *input)
 
     /* read the map */
     if (battle->map)
-	battle->map->destroy (battle->map);
+	battle->map->methods->destroy (battle->map);
     battle->map = new_Map ();
-    s &= battle->map->read (battle->map, input);
+    clearpathcache (battle);
+    cleardistances (battle);
+    clearboards (battle);
+    clearplanes (battle);
+    clearrings (battle);
+    if (battle->journal)
+	battle->journal->count = 0;
+    ++battle->generation;
+    s &= battle->map->methods->read (battle->map, input);
 
     /* read the units on the map */
-    for (c = 0; c < CWG_UNITS; ++c)
+    for (c = 0; c < battle->unitcap; ++c)
 	if (battle->units[c]) {
-	    free (battle->units[c]);
+	    battle->units[c]->methods->destroy (battle->units[c]);
 	    battle->units[c] = NULL;
 	}
     for (cwg->readint (&unitid, input);
 	 unitid != CWG_NO_UNIT && s;
-	 cwg->readint (&unitid, input)) {
-	battle->units[unitid] = new_Unit ();
-	s &= battle->units[unitid]->read (battle->units[unitid], input);
-    }
+	 cwg->readint (&unitid, input))
+	if (unitid < CWG_MAXUNITS && growslots (battle, unitid) &&
+	    (battle->units[unitid] = new_Unit ()))
+	    s &= battle->units[unitid]->methods->read
+		(battle->units[unitid], input);
+	else
+	    s = 0;
+
+    /* calculate the free slots, hash, counts and roster afresh */
+    findslots (battle);
+    hashbattle (battle);
+    countbattle (battle);
+    if (battle->roster)
+	fillroster (battle);
 
     /* return */
     return s;
@@ -595,15 +1703,15 @@ static int move (Battle *battle, Unit *unit, int x, int y,
 	return 0;
 
     /* select the movement algorithm */
-    if (movement == CWG_MOVE_QUICK) {
+    if (battle->movement == CWG_MOVE_QUICK) {
 	prepare = ignorepathcosts;
 	next = quicknextsquare;
     } else {
-	prepare = getpathcosts;
+	prepare = findpathcosts;
 	next = movenextsquare;
     }
 
-    /* work out the costs grid */
+    /* find the costs grid */
     if (! (costs = prepare (battle, unit, x, y)))
 	return 0;
 
@@ -618,7 +1726,6 @@ static int move (Battle *battle, Unit *unit, int x, int y,
     }
 
     /* return success */
-    if (costs) free (costs);
     return 1;
 }
 
@@ -635,15 +1742,7 @@ static int attack (Battle *battle, Unit *unit, Unit *target,
     CwgAttackResult result; /* result of attack */
 
     /* validation */
-    if (! battle->utypes)
-	return 0;
-    if (! battle->terrain)
-	return 0;
-    if (unit->side != battle->side)
-	return 0;
-    if (target->side == battle->side)
-	return 0;
-    if (! unit->moves)
+    if (! canattack (battle, unit, target))
 	return 0;
 
     /* unit fires on target */
@@ -676,58 +1775,44 @@ static int create (Battle *battle, Unit *src, int utype,
 		   int x, int y, CreateHook hook)
 {
     /* local variables */
-    UnitType *srctype; /* builder unit type */
     Map *map; /* the battlefield map */
     Unit *tgt; /* the newly built unit */
     int c; /* array counter */
 
-    /* validation */
-    if (! battle->utypes)
-	return CWG_NO_UNIT;
-    if (! battle->terrain)
-	return CWG_NO_UNIT;
-
-    /* initialisation */
-    srctype = battle->utypes[src->utype];
-    map = battle->map;
-
-    /* more validation */
-    if (battle->side != src->side)
-	return CWG_NO_UNIT;
-    if (map->units[x + map->width * y] != CWG_NO_UNIT)
-	return CWG_NO_UNIT;
-    if (! srctype->builds[utype])
-	return CWG_NO_UNIT;
-    if (src->moves < srctype->moves)
-	return CWG_NO_UNIT;
-    if (battle->resources[battle->side] < battle->utypes[utype]->cost)
-	return CWG_NO_UNIT;
-    if (map->distance (x, y, src->x, src->y, 0) > 1)
-	return CWG_NO_UNIT;
-    if (battle->terrain[map->terrain[x + map->width * y]]->moves[utype]
-	== 0)
+    /* validation */
+    if (! cancreate (battle, src, utype, x, y))
 	return CWG_NO_UNIT;
+    map = battle->map;
 
     /* ensure that there is room for one more unit */
-    for (c = 0; c < CWG_UNITS; ++c)
-	if (! battle->units[c])
-	    break;
-    if (c == CWG_UNITS)
+    if ((c = freeslot (battle)) == CWG_NO_UNIT)
 	return CWG_NO_UNIT;
 
     /* place the new unit - leave moves at 0 */
-    if (! (tgt = battle->units[c] = new_Unit ()))
+    if (! growslots (battle, c) || ! (tgt = newunit (battle)))
 	return CWG_NO_UNIT;
+    setslot (battle, c, tgt);
     tgt->side = battle->side;
     tgt->utype = utype;
     tgt->x = x;
     tgt->y = y;
     battle->map->units[x + map->width * y] = c;
+    ++battle->generation;
+    boardunit (battle, tgt->side, x + map->width * y, 1);
     tgt->hits = battle->utypes[utype]->hits;
+    hashunit (battle, tgt);
+    ++battle->unitcount[tgt->side];
+    battle->pointcount[tgt->side] += map->points[x + map->width * y] != 0;
 
     /* update the src unit and the resources */
+    hashunit (battle, src);
+    hashresources (battle);
     src->moves = 0;
     battle->resources[battle->side] -= battle->utypes[utype]->cost;
+    hashunit (battle, src);
+    hashresources (battle);
+    rosterunit (battle, c);
+    rosterunit (battle, map->units[src->x + map->width * src->y]);
 
     /* run hook at return */
     if (hook)
@@ -748,48 +1833,27 @@ static int restore (Battle *battle, Unit *builder, Unit *built,
     /* local variables */
     UnitType *srctype, /* unit type of the builder */
 	*tgttype; /* unit type of the unit to repair */
-    int sx, /* x coordinate of the builder */
-	sy, /* y coordinate of the builder */
-	tx, /* x coordinate of the target */
-	ty, /* y coordinate of the target */
-	distance; /* distance from source to target */
+    Map *map; /* the battlefield map */
 
     /* validation */
-    if (! battle->utypes)
-	return 0;
-    if (! battle->terrain)
+    if (! canrestore (battle, builder, built))
 	return 0;
-
-    /* initialisation */
     srctype = battle->utypes[builder->utype];
-    sx = builder->x;
-    sy = builder->y;
     tgttype = battle->utypes[built->utype];
-    tx = built->x;
-    ty = built->y;
-    distance = abs (sx - tx) > abs (sy - ty) ?
-	abs (sx - tx) : abs (sy - ty);
-
-    /* more validation */
-    if (distance != 1)
-	return 0;
-    if (! srctype->builds[built->utype])
-	return 0;
-    if (builder->moves < srctype->moves / 2)
-	return 0;
-    if (builder->side != battle->side)
-	return 0;
-    if (built->side != battle->side)
-	return 0;
-    if (battle->resources[battle->side] < tgttype->cost / 2)
-	return 0;
-    if (built->hits >= tgttype->hits)
-	return 0;
 
     /* do the repair */
+    hashunit (battle, built);
+    hashunit (battle, builder);
+    hashresources (battle);
     built->hits = tgttype->hits;
     builder->moves -= srctype->moves / 2;
     battle->resources[battle->side] -= tgttype->cost / 2;
+    hashunit (battle, built);
+    hashunit (battle, builder);
+    hashresources (battle);
+    map = battle->map;
+    rosterunit (battle, map->units[built->x + map->width * built->y]);
+    rosterunit (battle, map->units[builder->x + map->width * builder->y]);
 
     /* run the hook and return */
     if (hook)
@@ -804,33 +1868,19 @@ static int restore (Battle *battle, Unit *builder, Unit *built,
  */
 static int victory (Battle *battle)
 {
-    int l, /* location counter */
-	pointcount[3], /* count of victory points per side & total */
-	unitcount[2], /* count of units per side */
-	vp, /* flag for current location being victory point */
-	s; /* side counter */
-    Unit *unit; /* convenience pointer to current unit */
+    int s; /* side counter */
 
-    /* count units per side and victory points occupied */
-    pointcount[0] = pointcount[1] = pointcount[2] = 0;
-    unitcount[0] = unitcount[1] = 0;
-    for (l = 0; l < battle->map->width * battle->map->height; ++l) {
-	if ((vp = battle->map->points[l]))
-	    ++pointcount[2];
-	if (battle->map->units[l] != CWG_NO_UNIT) {
-	    unit = battle->units[battle->map->units[l]];
-	    if (unit->hits)
-		++unitcount[unit->side];
-	    if (vp)
-		++pointcount[unit->side];
-	}
-    }
+#ifdef CWG_DEBUG
+    scancounts (battle);
+    scanroster (battle);
+#endif
 
     /* does one side have all the victory points? */
     for (s = 0; s < 2; ++s)
-	if (pointcount[s] == pointcount[2] && pointcount[2])
+	if (battle->pointcount[s] == battle->pointcount[2] &&
+	    battle->pointcount[2])
 	    return s;
-	else if (unitcount[1 - s] == 0)
+	else if (battle->unitcount[1 - s] == 0)
 	    return s;
 
     /* if we reach this point, neither side has won yet */
@@ -845,8 +1895,12 @@ static int victory (Battle *battle)
 static int turn (Battle *battle)
 {
     /* local variables */
+    CwgRoster *roster; /* the units' fields, or NULL */
     Unit *unit; /* unit to be refreshed */
-    int c; /* unit counter */
+    unsigned long dead, /* slots holding dead units */
+	alive; /* slots holding live units */
+    int w, /* slot word counter */
+	c; /* unit counter */
 
     /* validation */
     if (! battle->utypes)
@@ -854,47 +1908,685 @@ static int turn (Battle *battle)
     if (! battle->terrain)
 	return 0;
 
-    /* switch side */
+    /* switch side and forget the actions that could be undone */
     battle->side = ! battle->side;
+    hashkey (battle, CWG_HASH_SIDE, 0);
+    if (battle->journal)
+	battle->journal->count = 0;
+
+    /* without memory for a roster, walk the units themselves */
+    if (! (roster = makeroster (battle))) {
+	for (c = 0; c < battle->unitcap; ++c)
+	    if ((unit = battle->units[c]) && unit->hits == 0) {
+		hashunit (battle, unit);
+		dropunit (battle, c);
+	    } else if (unit && unit->side == battle->side) {
+		hashunit (battle, unit);
+		unit->moves = battle->utypes[unit->utype]->moves;
+		hashunit (battle, unit);
+	    }
+	return 1;
+    }
 
-    /* remove dead units from the battle */
-    for (c = 0; c < CWG_UNITS; ++c)
-	if ((unit = battle->units[c]) &&
-	    unit->hits == 0) {
-	    unit->destroy (unit);
-	    battle->units[c] = NULL;
-	}
+    /* remove dead units from the battle, freeing their slots */
+    for (w = 0; 32 * w < battle->unitcap; ++w) {
+	dead = ~(battle->freeslots[w] | roster->alive[w]) & 0xffffffffUL;
+	for (c = 32 * w; dead && c < battle->unitcap; ++c, dead >>= 1)
+	    if (dead & 1) {
+		hashunit (battle, battle->units[c]);
+		dropunit (battle, c);
+	    }
+    }
 
     /* restore side's units' movement points */
-    for (c = 0; c < CWG_UNITS; ++c)
-	if ((unit = battle->units[c]) &&
-	    unit->hits &&
-	    unit->side == battle->side)
-	    unit->moves = battle->utypes[unit->utype]->moves;
+    for (w = 0; 32 * w < battle->unitcap; ++w) {
+	alive = roster->alive[w];
+	for (c = 32 * w; alive; ++c, alive >>= 1)
+	    if ((alive & 1) && roster->side[c] == battle->side) {
+		unit = battle->units[c];
+		hashunit (battle, unit);
+		unit->moves = battle->utypes[roster->utype[c]]->moves;
+		hashunit (battle, unit);
+		roster->moves[c] = (unsigned char) unit->moves;
+	    }
+    }
 
     /* return with success */
     return 1;
 }
 
+/**
+ * Find the squares a unit can reach with its remaining movement points.
+ * Squares occupied by other units can be neither entered nor crossed.
+ * @param battle is the battle to examine.
+ * @param unit is the unit to move.
+ * @param squares is filled with 1 for each square the unit can reach,
+ * including its own, and 0 for every other square.
+ * @return the number of squares the unit can reach.
+ */
+static int reachable (Battle *battle, Unit *unit, unsigned char *squares)
+{
+    /* local variables */
+    int *costs, /* travel costs from the unit */
+	count, /* number of squares reachable */
+	c; /* square counter */
+
+    /* clear the squares in case the search fails */
+    for (c = 0; c < battle->map->width * battle->map->height; ++c)
+	squares[c] = 0;
+    if (! battle->terrain)
+	return 0;
+
+    /* search outwards from the unit as far as its moves allow */
+    if (! (costs = searchcosts (battle, unit->utype, unit->x, unit->y,
+				1, unit->moves + 1)))
+	return 0;
+    count = 0;
+    for (c = 0; c < battle->map->width * battle->map->height; ++c)
+	if (costs[c]) {
+	    squares[c] = 1;
+	    ++count;
+	}
+    free (costs);
+
+    /* return the number of squares found */
+    return count;
+}
+
+/**
+ * Return the cost of travel between two squares for a unit type.
+ * Only the terrain is taken into account, not other units.
+ * @param battle is the battle to examine.
+ * @param utype is the unit type travelling.
+ * @param ox is the x coordinate of the origin.
+ * @param oy is the y coordinate of the origin.
+ * @param dx is the x coordinate of the destination.
+ * @param dy is the y coordinate of the destination.
+ * @return the movement points needed, or -1 if unreachable.
+ */
+static int pathdistance (Battle *battle, int utype, int ox, int oy,
+			 int dx, int dy)
+{
+    unsigned short *row; /* travel costs from the origin */
+    if (! battle->terrain)
+	return -1;
+    if (! (row = getdistances (battle, utype, ox, oy)))
+	return -1;
+    return row[dx + battle->map->width * dy] - 1;
+}
+
+/**
+ * Return a grid of travel costs from each square to a destination,
+ * as smart movement uses to choose a unit's path.
+ * @param battle is the battle to examine.
+ * @param unit is the unit to move.
+ * @param x is the x coordinate of the destination.
+ * @param y is the y coordinate of the destination.
+ * @return a new grid, which the caller must free, or NULL on failure.
+ */
+static int *pathcosts (Battle *battle, Unit *unit, int x, int y)
+{
+    if (! battle->terrain || ! battle->map)
+	return NULL;
+    return getpathcosts (battle, unit, x, y);
+}
+
 /**
  * Set the difficulty level for one side.
+ * @param battle The battle to affect.
  * @param side The side for which to set the difficulty.
  * @param level The difficulty level.
  */
-static void setlevel (int side, int level)
+static void setlevel (Battle *battle, int side, int level)
 {
-    levels[side] = level;
+    battle->levels[side] = level;
 }
 
 /**
  * Set the movement algorithm.
+ * @param battle The battle to affect.
  * @param algorithm The algorithm to use for movement:
  */
-static void setmovement (int algorithm)
+static void setmovement (Battle *battle, int algorithm)
+{
+    battle->movement = algorithm;
+}
+
+/**
+ * Seed the battle's random number generator.
+ * @param battle The battle to affect.
+ * @param number The seed, which may be any value.
+ */
+static void seed (Battle *battle, unsigned long number)
+{
+    /* the generator would stick at zero, so avoid it */
+    number &= 0xffffffffUL;
+    battle->rng = number ? number : 1;
+}
+
+/**
+ * Write the state of the battle's random number generator.
+ * @param battle The battle whose state to write.
+ * @param output The output stream.
+ * @return 1 on success, 0 on failure.
+ */
+static int writerandom (Battle *battle, Stream *output)
+{
+    /* local variables */
+    int c, /* bit counter */
+	s = 1, /* success flag */
+	value; /* byte of the random number state */
+    Cwg *cwg; /* pointer to cwg object */
+
+    /* write the state a byte at a time, lowest first */
+    cwg = get_Cwg ();
+    for (c = 0; c < 32; c += 8) {
+	value = (int) ((battle->rng >> c) & 0xff);
+	s &= cwg->writeint (&value, output);
+    }
+    return s;
+}
+
+/**
+ * Read the state of the battle's random number generator.
+ * @param battle The battle whose state to read.
+ * @param input The input stream.
+ * @return 1 on success, 0 on failure.
+ */
+static int readrandom (Battle *battle, Stream *input)
+{
+    /* local variables */
+    int c, /* bit counter */
+	s = 1, /* success flag */
+	value; /* byte of the random number state */
+    unsigned long rng; /* the state read */
+    Cwg *cwg; /* pointer to cwg object */
+
+    /* read the state a byte at a time, lowest first */
+    cwg = get_Cwg ();
+    for (rng = 0, c = 0; c < 32; c += 8) {
+	s &= cwg->readint (&value, input);
+	rng |= (unsigned long) value << c;
+    }
+
+    /* a zero state would stick, so reseed from it instead */
+    if (s)
+	seed (battle, rng);
+    return s;
+}
+
+/**
+ * Apply an action so that it can later be undone.
+ * @param battle The battle to affect.
+ * @param action The action to apply.
+ * @return 1 if successful, 0 if not.
+ */
+static int apply (Battle *battle, CwgAction *action)
+{
+    /* local variables */
+    CwgJournal *journal; /* the journal of actions */
+    CwgUndo *entry; /* the journal entry for this action */
+    Unit *unit, /* the unit acting */
+	*target; /* the unit attacked or repaired */
+    int created, /* ID of the unit created */
+	success; /* 1 if the action succeeded */
+
+    /* make sure the journal is ready and has room */
+    if (! battle->journal) {
+	if (! (battle->journal = malloc (sizeof (CwgJournal))))
+	    return 0;
+	battle->journal->count = 0;
+	battle->journal->sparecount = 0;
+    }
+    journal = battle->journal;
+    if (journal->count == CWG_JOURNAL)
+	return 0;
+
+    /* validate the units */
+    if (action->unit < 0 || action->unit >= battle->unitcap ||
+	! (unit = battle->units[action->unit]))
+	return 0;
+    target = NULL;
+    if (action->type == CWG_ACT_ATTACK ||
+	action->type == CWG_ACT_RESTORE) {
+	if (action->target < 0 || action->target >= battle->unitcap ||
+	    ! (target = battle->units[action->target]))
+	    return 0;
+    }
+
+    /* save the state that the action may change */
+    entry = &journal->entries[journal->count];
+    saveunit (battle, entry, 0, action->unit);
+    saveunit (battle, entry, 1, target ? action->target : CWG_NO_UNIT);
+    entry->created = CWG_NO_UNIT;
+    entry->resources[0] = battle->resources[0];
+    entry->resources[1] = battle->resources[1];
+    entry->rng = battle->rng;
+    entry->hash[0] = battle->hash[0];
+    entry->hash[1] = battle->hash[1];
+    entry->unitcount[0] = battle->unitcount[0];
+    entry->unitcount[1] = battle->unitcount[1];
+    entry->pointcount[0] = battle->pointcount[0];
+    entry->pointcount[1] = battle->pointcount[1];
+
+    /* carry out the action */
+    switch (action->type) {
+    case CWG_ACT_MOVE:
+	success = move (battle, unit, action->x, action->y, NULL);
+	break;
+    case CWG_ACT_ATTACK:
+	success = attack (battle, unit, target, NULL);
+	break;
+    case CWG_ACT_CREATE:
+	created = create (battle, unit, action->utype,
+			  action->x, action->y, NULL);
+	success = (created != CWG_NO_UNIT);
+	entry->created = created;
+	break;
+    case CWG_ACT_RESTORE:
+	success = restore (battle, unit, target, NULL);
+	break;
+    default:
+	success = 0;
+    }
+
+    /* record the action if it succeeded */
+    if (success)
+	++journal->count;
+    return success;
+}
+
+/**
+ * Undo the last action applied, restoring the battle exactly.
+ * @param battle The battle to affect.
+ * @return 1 if an action was undone, 0 if there was none.
+ */
+static int undo (Battle *battle)
+{
+    /* local variables */
+    CwgJournal *journal; /* the journal of actions */
+    CwgUndo *entry; /* the journal entry for the last action */
+    Map *map; /* the battlefield map */
+    Unit *unit; /* unit to restore */
+    int e; /* entry slot counter */
+
+    /* find the last action */
+    if (! (journal = battle->journal) || ! journal->count)
+	return 0;
+    entry = &journal->entries[--journal->count];
+    map = battle->map;
+
+    /* the unit grid will change, so cached paths are out of date */
+    ++battle->generation;
+
+    /* remove any unit created, keeping it for reuse */
+    if (entry->created != CWG_NO_UNIT) {
+	unit = battle->units[entry->created];
+	map->units[unit->x + map->width * unit->y] = CWG_NO_UNIT;
+	boardunit (battle, unit->side, unit->x + map->width * unit->y, 0);
+	dropunit (battle, entry->created);
+    }
+
+    /* lift the affected units from the map */
+    for (e = 0; e < 2; ++e)
+	if (entry->units[e] != CWG_NO_UNIT) {
+	    unit = battle->units[entry->units[e]];
+	    if (map->units[unit->x + map->width * unit->y]
+		== entry->units[e]) {
+		map->units[unit->x + map->width * unit->y] = CWG_NO_UNIT;
+		boardunit (battle, unit->side,
+			   unit->x + map->width * unit->y, 0);
+	    }
+	}
+
+    /* put them back as they were */
+    for (e = 0; e < 2; ++e)
+	if (entry->units[e] != CWG_NO_UNIT) {
+	    unit = battle->units[entry->units[e]];
+	    unit->x = entry->x[e];
+	    unit->y = entry->y[e];
+	    unit->hits = entry->hits[e];
+	    unit->moves = entry->moves[e];
+	    if (unit->hits) {
+		map->units[unit->x + map->width * unit->y]
+		    = entry->units[e];
+		boardunit (battle, unit->side,
+			   unit->x + map->width * unit->y, 1);
+	    }
+	    rosterunit (battle, entry->units[e]);
+	}
+
+    /* restore the resources, random numbers, hash and counts */
+    battle->resources[0] = entry->resources[0];
+    battle->resources[1] = entry->resources[1];
+    battle->rng = entry->rng;
+    battle->hash[0] = entry->hash[0];
+    battle->hash[1] = entry->hash[1];
+    battle->unitcount[0] = entry->unitcount[0];
+    battle->unitcount[1] = entry->unitcount[1];
+    battle->pointcount[0] = entry->pointcount[0];
+    battle->pointcount[1] = entry->pointcount[1];
+    return 1;
+}
+
+/**
+ * Recalculate the hash of the battle state, the counts of units and
+ * victory points, and the roster if there is one, from scratch.
+ * @param battle The battle to examine.
+ */
+static void rehash (Battle *battle)
+{
+    findslots (battle);
+    hashbattle (battle);
+    countbattle (battle);
+    if (battle->roster)
+	fillroster (battle);
+}
+
+/**
+ * List the legal actions for the side whose turn it is.
+ * @param battle The battle to examine.
+ * @param list The buffer to fill with actions.
+ * @param size The number of actions the buffer can hold.
+ * @return The number of legal actions, which may be more than size,
+ * or -1 if there is not enough memory.
+ */
+static int actions (Battle *battle, CwgAction *list, int size)
+{
+    /* local variables */
+    CwgAction action; /* an action to add to the list */
+    Map *map; /* the battlefield map */
+    Unit *unit, /* unit acting */
+	*target; /* unit attacked or repaired */
+    int *costs, /* travel costs from the acting unit */
+	count, /* number of actions found */
+	slot, /* free slot for a new unit */
+	u, /* acting unit counter */
+	t, /* target unit counter */
+	x, /* x coordinate counter */
+	y, /* y coordinate counter */
+	c; /* square or unit type counter */
+
+    /* validation */
+    if (! battle->utypes)
+	return 0;
+    if (! battle->terrain)
+	return 0;
+
+    /* initialise */
+    map = battle->map;
+    count = 0;
+    slot = freeslot (battle);
+
+    /* look at each of the side's units in turn */
+    for (u = 0; u < battle->unitcap; ++u) {
+	if (! (unit = battle->units[u]) || ! unit->hits ||
+	    unit->side != battle->side)
+	    continue;
+	action.unit = u;
+	action.target = CWG_NO_UNIT;
+	action.utype = -1;
+	action.x = unit->x;
+	action.y = unit->y;
+
+	/* moves to the squares the unit can reach */
+	if (unit->moves) {
+	    if (! (costs = searchcosts (battle, unit->utype, unit->x,
+					unit->y, 1, unit->moves + 1)))
+		return -1;
+	    action.type = CWG_ACT_MOVE;
+	    for (c = 0; c < map->width * map->height; ++c)
+		if (costs[c] && c != unit->x + map->width * unit->y) {
+		    action.x = c % map->width;
+		    action.y = c / map->width;
+		    count = listaction (list, size, count, &action);
+		}
+	    free (costs);
+	    action.x = unit->x;
+	    action.y = unit->y;
+	}
+
+	/* attacks on enemies and repairs to friends */
+	for (t = 0; t < battle->unitcap; ++t) {
+	    if (t == u || ! (target = battle->units[t]) || ! target->hits)
+		continue;
+	    action.target = t;
+	    if (canattack (battle, unit, target)) {
+		action.type = CWG_ACT_ATTACK;
+		count = listaction (list, size, count, &action);
+	    } else if (canrestore (battle, unit, target)) {
+		action.type = CWG_ACT_RESTORE;
+		count = listaction (list, size, count, &action);
+	    }
+	}
+	action.target = CWG_NO_UNIT;
+
+	/* builds on the squares around the unit */
+	if (slot == CWG_NO_UNIT)
+	    continue;
+	action.type = CWG_ACT_CREATE;
+	for (x = unit->x - 1; x <= unit->x + 1; ++x)
+	    for (y = unit->y - 1; y <= unit->y + 1; ++y) {
+		if (x < 0 || x >= map->width || y < 0 || y >= map->height)
+		    continue;
+		action.x = x;
+		action.y = y;
+		for (c = 0; c < CWG_UTYPES; ++c)
+		    if (battle->builds[c] &&
+			cancreate (battle, unit, c, x, y)) {
+			action.utype = c;
+			count = listaction (list, size, count, &action);
+		    }
+	    }
+    }
+
+    /* return the number of actions found */
+    return count;
+}
+
+/**
+ * Get bitboards of the map, building them if necessary.
+ * @param battle The battle to examine.
+ * @return The bitboards, or NULL if there is not enough memory.
+ */
+static CwgBoards *getboards (Battle *battle)
+{
+    /* local variables */
+    CwgBoards *boards; /* the bitboards */
+    Terrain *terrain; /* terrain of the current square */
+    int l, /* location counter */
+	u; /* unit type counter */
+
+    /* validation */
+    if (! battle->terrain || ! battle->map)
+	return NULL;
+
+    /* build the boards of things that never change */
+    if (! (boards = battle->boards)) {
+	if (! (boards = battle->boards = malloc (sizeof (CwgBoards))))
+	    return NULL;
+	memset (boards, 0, sizeof (CwgBoards));
+	for (l = 0; l < battle->map->width * battle->map->height; ++l) {
+	    if (battle->map->points[l])
+		boards->points.bits[l / 32] |= 1UL << (l % 32);
+	    boards->terrain[battle->map->terrain[l]].bits[l / 32]
+		|= 1UL << (l % 32);
+	    terrain = battle->terrain[battle->map->terrain[l]];
+	    for (u = 0; u < CWG_UTYPES; ++u)
+		if (terrain->moves[u])
+		    boards->passable[u].bits[l / 32] |= 1UL << (l % 32);
+	}
+	boardsides (battle);
+    }
+
+    /* rebuild the side boards if the units were changed directly */
+    if (boards->generation != battle->generation)
+	boardsides (battle);
+    return boards;
+}
+
+/**
+ * Get the terrain's movement costs and defence bonuses for each unit
+ * type and square, building them if necessary.
+ * @param battle The battle to examine.
+ * @return The planes, or NULL if there is not enough memory.
+ */
+static CwgPlanes *getplanes (Battle *battle)
+{
+    return makeplanes (battle);
+}
+
+/**
+ * Get the lists of squares around each square, building them if
+ * necessary.
+ * @param battle The battle to examine.
+ * @return The rings, or NULL if there is not enough memory.
+ */
+static CwgRings *getrings (Battle *battle)
+{
+    return makerings (battle);
+}
+
+/**
+ * Get the units' fields laid out in an array for each field, building
+ * them if necessary.
+ * @param battle The battle to examine.
+ * @return The roster, or NULL if there is not enough memory.
+ */
+static CwgRoster *getroster (Battle *battle)
+{
+    return makeroster (battle);
+}
+
+/**
+ * Put a unit into the lowest free slot.
+ * @param battle The battle to add the unit to.
+ * @param unit The unit to add.
+ * @return The unit's ID, or CWG_NO_UNIT if the battle is full.
+ */
+static int addunit (Battle *battle, Unit *unit)
+{
+    int c; /* the free slot */
+    if ((c = freeslot (battle)) == CWG_NO_UNIT)
+	return CWG_NO_UNIT;
+    if (! growslots (battle, c))
+	return CWG_NO_UNIT;
+    setslot (battle, c, unit);
+    return c;
+}
+
+/**
+ * Remove a unit and free its slot.
+ * @param battle The battle to remove the unit from.
+ * @param unitid The ID of the unit to remove.
+ */
+static void removeunit (Battle *battle, int unitid)
+{
+    if (unitid >= 0 && unitid < battle->unitcap && battle->units[unitid])
+	dropunit (battle, unitid);
+}
+
+/**
+ * Fill a bitboard with the squares within range of a square.
+ * @param battle The battle to examine.
+ * @param board The bitboard to fill.
+ * @param square The square at the centre.
+ * @param range The greatest distance from the centre.
+ */
+static void surround (Battle *battle, CwgBoard *board, int square,
+		      int range)
+{
+    int width, /* width of the map */
+	x0, /* left edge of the area */
+	x1, /* right edge of the area */
+	y0, /* top edge of the area */
+	y1, /* bottom edge of the area */
+	c; /* word or row counter */
+
+    /* clear the board */
+    for (c = 0; c < CWG_BOARDWORDS; ++c)
+	board->bits[c] = 0;
+
+    /* work out the area within the map */
+    width = battle->map->width;
+    x0 = square % width - range;
+    x1 = square % width + range;
+    y0 = square / width - range;
+    y1 = square / width + range;
+    x0 = x0 < 0 ? 0 : x0;
+    x1 = x1 >= width ? width - 1 : x1;
+    y0 = y0 < 0 ? 0 : y0;
+    y1 = y1 >= battle->map->height ? battle->map->height - 1 : y1;
+
+    /* set each row of the area */
+    for (c = y0; c <= y1; ++c)
+	setrun (board, x0 + width * c, x1 + width * c);
+}
+
+/**
+ * Find the next square set on a bitboard.
+ * @param board The bitboard to search.
+ * @param square The first square to look at.
+ * @return The first square set from that square on, or -1 if none.
+ */
+static int nextsquare (CwgBoard *board, int square)
 {
-    movement = algorithm;
+    int word; /* word counter */
+    unsigned long bits; /* bits of the current word */
+    if (square < 0)
+	square = 0;
+    for (word = square / 32; word < CWG_BOARDWORDS; ++word) {
+	bits = board->bits[word] & 0xffffffffUL;
+	if (word == square / 32)
+	    bits &= 0xffffffffUL << (square % 32);
+	if (bits) {
+	    square = 32 * word;
+	    for (; ! (bits & 1); bits >>= 1)
+		++square;
+	    return square;
+	}
+    }
+    return -1;
 }
 
+/*----------------------------------------------------------------------
+ * Method Table.
+ */
+
+/* the methods shared by all battles */
+static const BattleMethods methods = {
+    destroy,
+    clone,
+    write,
+    read,
+    move,
+    attack,
+    create,
+    restore,
+    victory,
+    turn,
+    reachable,
+    pathdistance,
+    pathcosts,
+    setlevel,
+    setmovement,
+    seed,
+    writerandom,
+    readrandom,
+    apply,
+    undo,
+    rehash,
+    actions,
+    getboards,
+    getplanes,
+    getrings,
+    getroster,
+    addunit,
+    removeunit,
+    surround,
+    nextsquare
+};
+
 /*----------------------------------------------------------------------
  * Constructor and any other class methods.
  */
@@ -920,25 +2612,37 @@ Battle *new_Battle (UnitType **utypes, Terrain **terrain)
     battle->resources[1] = 0;
     for (c = 0; c < CWG_UTYPES; ++c)
 	battle->builds[c] = 0;
+    battle->unitcap = CWG_UNITS;
+    if (! (battle->units = malloc (CWG_UNITS * sizeof (Unit *)))) {
+	free (battle);
+	return NULL;
+    }
     for (c = 0; c < CWG_UNITS; ++c)
 	battle->units[c] = NULL;
+    findslots (battle);
     battle->utypes = utypes;
     battle->terrain = terrain;
     battle->map = NULL;
+    battle->levels[0] = 0;
+    battle->levels[1] = 0;
+    battle->movement = CWG_MOVE_SMART;
+    battle->rng = 1;
+    battle->generation = 0;
+    for (c = 0; c < CWG_PATHCACHE; ++c)
+	battle->pathcache[c].costs = NULL;
+    battle->pathhits = 0;
+    battle->pathmisses = 0;
+    battle->distances = NULL;
+    battle->journal = NULL;
+    battle->boards = NULL;
+    battle->planes = NULL;
+    battle->rings = NULL;
+    battle->roster = NULL;
+    hashbattle (battle);
+    countbattle (battle);
 
     /* initialise methods */
-    battle->destroy = destroy;
-    battle->clone = clone;
-    battle->write = write;
-    battle->read = read;
-    battle->move = move;
-    battle->attack = attack;
-    battle->create = create;
-    battle->restore = restore;
-    battle->victory = victory;
-    battle->turn = turn;
-    battle->setlevel = setlevel;
-    battle->setmovement = setmovement;
+    battle->methods = &methods;
 
     /* return the new battle */
     return battle;
@@ -0,0 +1,287 @@
+/*======================================================================
+ * CWG: Cyningstan Wargame Engine.
+ * An engine for simple turn-based wargames.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Combat Table Module.
+ */
+
+/* standard C headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+/* project headers */
+#include "cwg.h"
+#include "combat.h"
+
+/*----------------------------------------------------------------------
+ * Private Level 1 Functions.
+ */
+
+/**
+ * Find the row of the tables for a shot, keeping the attack power,
+ * defence and level within the tables.
+ * @param combat is the combat tables.
+ * @param attack is the attack power, which is reduced if need be.
+ * @param defence is the defence of the target.
+ * @param level is the difficulty level of the side firing.
+ * @return the first entry of the row in the tables.
+ */
+static int findrow (Combat *combat, int *attack, int defence, int level)
+{
+    if (*attack < 0)
+	*attack = 0;
+    else if (*attack > combat->maxattack)
+	*attack = combat->maxattack;
+    if (defence < 0)
+	defence = 0;
+    else if (defence > combat->maxdefence)
+	defence = combat->maxdefence;
+    if (level < 0)
+	level = 0;
+    else if (level >= CWG_LEVELS)
+	level = CWG_LEVELS - 1;
+    return ((level * (combat->maxattack + 1) + *attack)
+	    * (combat->maxdefence + 1) + defence)
+	* (combat->maxattack + 1);
+}
+
+/**
+ * Fill in the rows of the tables for an attack power and defence.
+ * @param combat is the combat tables.
+ * @param attack is the attack power.
+ * @param defence is the defence.
+ * @param counts is working space for maxattack + 1 counts.
+ */
+static void fillrows (Combat *combat, int attack, int defence,
+		      long *counts)
+{
+    long rolls, /* number of ways one roll can go */
+	single, /* chance of one roll doing less than some damage */
+	all; /* chance of every roll doing less than that damage */
+    int row, /* first entry of the row for a level */
+	level, /* difficulty level */
+	a, /* attack roll */
+	d, /* defence roll */
+	r, /* roll counter */
+	h; /* damage or hits counter */
+
+    /* count the ways one roll does less than each amount of damage */
+    for (h = 0; h <= attack; ++h)
+	counts[h] = 0;
+    for (a = 0; a <= attack; ++a)
+	for (d = 0; d <= defence; ++d)
+	    for (h = (a - d < 0 ? 0 : a - d) + 1; h <= attack; ++h)
+		++counts[h];
+    rolls = (long) (attack + 1) * (defence + 1);
+
+    /* at each level, the damage is at least h unless every roll
+       does less than h */
+    for (level = 0; level < CWG_LEVELS; ++level) {
+	row = findrow (combat, &attack, defence, level);
+	combat->chances[row] = CWG_CERTAIN;
+	combat->expected[row] = 0;
+	for (h = 1; h <= attack; ++h) {
+	    single = (counts[h] * CWG_CERTAIN + rolls / 2) / rolls;
+	    for (all = CWG_CERTAIN, r = 0; r <= level; ++r)
+		all = (all * single + CWG_CERTAIN / 2) / CWG_CERTAIN;
+	    combat->chances[row + h] = (unsigned int) (CWG_CERTAIN - all);
+	    combat->expected[row + h]
+		= combat->expected[row + h - 1] + combat->chances[row + h];
+	}
+    }
+}
+
+/*----------------------------------------------------------------------
+ * Public Level Functions.
+ */
+
+/**
+ * Destroy the combat tables when they are no longer needed.
+ * @param combat is the combat tables to destroy.
+ */
+static void destroy (Combat *combat)
+{
+    if (combat) {
+	if (combat->chances)
+	    free (combat->chances);
+	if (combat->expected)
+	    free (combat->expected);
+	free (combat);
+    }
+}
+
+/**
+ * Return the chance of a shot doing an exact amount of damage.
+ * @param combat is the combat tables.
+ * @param attack is the attack power of the unit firing.
+ * @param defence is the target's armour plus its terrain defence.
+ * @param level is the difficulty level of the side firing.
+ * @param hits is the number of hits the target has left.
+ * @param damage is the damage to find the chance of.
+ * @return the chance out of CWG_CERTAIN.
+ */
+static unsigned int chance (Combat *combat, int attack, int defence,
+			    int level, int hits, int damage)
+{
+    int row; /* first entry of the row in the tables */
+    row = findrow (combat, &attack, defence, level);
+    if (hits > attack)
+	hits = attack;
+    if (hits < 0)
+	hits = 0;
+    if (damage < 0 || damage > hits)
+	return 0;
+    if (damage == hits)
+	return combat->chances[row + damage];
+    return combat->chances[row + damage] - combat->chances[row + damage + 1];
+}
+
+/**
+ * Return the damage a shot is expected to do.
+ * @param combat is the combat tables.
+ * @param attack is the attack power of the unit firing.
+ * @param defence is the target's armour plus its terrain defence.
+ * @param level is the difficulty level of the side firing.
+ * @param hits is the number of hits the target has left.
+ * @return the expected damage in CWG_CERTAIN-ths of a hit.
+ */
+static long damage (Combat *combat, int attack, int defence, int level,
+		    int hits)
+{
+    int row; /* first entry of the row in the tables */
+    row = findrow (combat, &attack, defence, level);
+    if (hits <= 0)
+	return 0;
+    if (hits > attack)
+	hits = attack;
+    return combat->expected[row + hits];
+}
+
+/**
+ * Return the chance of a shot destroying its target.
+ * @param combat is the combat tables.
+ * @param attack is the attack power of the unit firing.
+ * @param defence is the target's armour plus its terrain defence.
+ * @param level is the difficulty level of the side firing.
+ * @param hits is the number of hits the target has left.
+ * @return the chance out of CWG_CERTAIN.
+ */
+static unsigned int kill (Combat *combat, int attack, int defence,
+			  int level, int hits)
+{
+    int row; /* first entry of the row in the tables */
+    row = findrow (combat, &attack, defence, level);
+    if (hits <= 0)
+	return CWG_CERTAIN;
+    if (hits > attack)
+	return 0;
+    return combat->chances[row + hits];
+}
+
+/**
+ * Return the damage expected from return fire, which comes only
+ * if the target survives the shot.
+ * @param combat is the combat tables.
+ * @param attack is the attack power of the unit firing.
+ * @param defence is the target's armour plus its terrain defence.
+ * @param level is the difficulty level of the side firing.
+ * @param hits is the number of hits the target has left.
+ * @param rattack is the attack power of the target.
+ * @param rdefence is the firing unit's armour and terrain defence.
+ * @param rlevel is the difficulty level of the target's side.
+ * @param rhits is the number of hits the firing unit has left.
+ * @return the expected damage in CWG_CERTAIN-ths of a hit.
+ */
+static long returnfire (Combat *combat, int attack, int defence,
+			int level, int hits, int rattack, int rdefence,
+			int rlevel, int rhits)
+{
+    long survival, /* chance of the target surviving */
+	reply; /* damage expected from the target's reply */
+    survival = CWG_CERTAIN - kill (combat, attack, defence, level, hits);
+    reply = damage (combat, rattack, rdefence, rlevel, rhits);
+    return (reply / CWG_CERTAIN) * survival
+	+ (reply % CWG_CERTAIN) * survival / CWG_CERTAIN;
+}
+
+/*----------------------------------------------------------------------
+ * Method Tables.
+ */
+
+/* the methods of the combat tables */
+static const CombatMethods methods = {
+    destroy,
+    chance,
+    damage,
+    kill,
+    returnfire
+};
+
+/*----------------------------------------------------------------------
+ * Constructor Functions.
+ */
+
+/**
+ * Combat table constructor.
+ * @param utypes is the array of CWG_UTYPES unit types, some NULL.
+ * @param terrain is the array of CWG_TERRAIN terrain types, some NULL.
+ * @return the new combat tables, or NULL if there is not enough memory.
+ */
+Combat *new_Combat (UnitType **utypes, Terrain **terrain)
+{
+    /* local variables */
+    Combat *combat; /* the combat tables to return */
+    long entries, /* number of entries in each table */
+	*counts; /* working space for filling in the tables */
+    int u, /* unit type counter */
+	t, /* terrain counter */
+	bonus, /* best terrain defence bonus for a unit type */
+	attack, /* attack power counter */
+	defence; /* defence counter */
+
+    /* find the greatest attack power and defence */
+    if (! (combat = malloc (sizeof (Combat))))
+	return NULL;
+    combat->maxattack = combat->maxdefence = 0;
+    for (u = 0; u < CWG_UTYPES; ++u)
+	if (utypes[u]) {
+	    if (utypes[u]->power > combat->maxattack)
+		combat->maxattack = utypes[u]->power;
+	    for (bonus = 0, t = 0; t < CWG_TERRAIN; ++t)
+		if (terrain[t] && terrain[t]->defence[u] > bonus)
+		    bonus = terrain[t]->defence[u];
+	    if (utypes[u]->armour + bonus > combat->maxdefence)
+		combat->maxdefence = utypes[u]->armour + bonus;
+	}
+
+    /* reserve memory for the tables */
+    combat->chances = NULL;
+    combat->expected = NULL;
+    entries = (long) CWG_LEVELS * (combat->maxattack + 1)
+	* (combat->maxdefence + 1) * (combat->maxattack + 1);
+    if (entries * sizeof (long) > UINT_MAX ||
+	! (combat->chances = malloc ((unsigned int) entries
+				     * sizeof (unsigned int))) ||
+	! (combat->expected = malloc ((unsigned int) entries
+				      * sizeof (long))) ||
+	! (counts = malloc ((combat->maxattack + 1) * sizeof (long)))) {
+	destroy (combat);
+	return NULL;
+    }
+
+    /* fill in the tables */
+    for (attack = 0; attack <= combat->maxattack; ++attack)
+	for (defence = 0; defence <= combat->maxdefence; ++defence)
+	    fillrows (combat, attack, defence, counts);
+    free (counts);
+
+    /* initialise methods */
+    combat->methods = &methods;
+
+    /* return the new combat tables */
+    return combat;
+}
@@ -45,65 +45,65 @@ static void destroy (void)
 }
 
 /**
- * Write an integer as a byte to an already open output file.
+ * Write an integer as a byte to a stream.
  * @param  value  A pointer to the integer variable to write.
- * @param  output The output file handle.
+ * @param  output The output stream.
  * @return        1 if successful, 0 if not.
  */
-static int writeint (int *value, FILE *output)
+static int writeint (int *value, Stream *output)
 {
     unsigned char c; /* character to read */
     c = (char) (*value & 0xff);
-    return fwrite (&c, 1, 1, output);
+    return output->methods->write (output, &c, 1);
 }
 
 /**
- * Write a string to an already open output file.
+ * Write a string to a stream.
  * @param  value  A pointer to the string buffer to write.
- * @param  output The output file handle.
+ * @param  output The output stream.
  * @return        1 if successful, 0 if not.
  */
-static int writestring (char *value, FILE *output)
+static int writestring (char *value, Stream *output)
 {
     unsigned char length; /* length byte */
     length = (char) strlen (value);
-    if (! (fwrite (&length, 1, 1, output)))
+    if (! (output->methods->write (output, &length, 1)))
 	return 0;
     if (length)
-	return fwrite (value, (int) length, 1, output);
+	return output->methods->write (output, value, (int) length);
     return 1;
 }
 
 /**
- * Read a byte from an already open input file
+ * Read a byte from a stream
  * and store it in an integer variable.
  * @param  value A pointer to the integer variable to store into.
- * @param  input The input file handle.
+ * @param  input The input stream.
  * @return       1 if successful, 0 if not.
  */
-static int readint (int *value, FILE *input)
+static int readint (int *value, Stream *input)
 {
     unsigned char c; /* character to read */
-    if (! (fread (&c, 1, 1, input)))
+    if (! (input->methods->read (input, &c, 1)))
 	return 0;
     *value = (int) c;
     return 1;
 }
 
 /**
- * Read a string from an already open input file
+ * Read a string from a stream
  * and store it in a string buffer.
  * @param  value A pointer to the string buffer to store into.
- * @param  input The input file handle.
+ * @param  input The input stream.
  * @return       1 if successful, 0 if not.
  */
-static int readstring (char *value, FILE *input)
+static int readstring (char *value, Stream *input)
 {
     unsigned char length; /* length byte */
-    if (! (fread (&length, 1, 1, input)))
+    if (! (input->methods->read (input, &length, 1)))
 	return 0;
     if (length &&
-	! (fread (value, length, 1, input)))
+	! (input->methods->read (input, value, length)))
 	return 0;
     value[(int) length] = '\0';
     return 1;
@@ -148,7 +148,7 @@ static void initmap (void)
 {
     if (! (battle->map = new_Map ()))
 	fatal_error ("Cannot create map.");
-    if (! battle->map->size (battle->map, 20, 12))
+    if (! battle->map->methods->size (battle->map, 20, 12))
 	fatal_error ("Cannot initialise map.");
 }
 
@@ -263,6 +263,7 @@ static void addunitstomap (void)
     /* local variables */
     int s, /* side counter */
 	u, /* unit counter */
+	id, /* unit ID in the battle */
 	x, /* x coordinate for unit */
 	y; /* y coordinate for unit */
     Unit *unit; /* convenience variable */
@@ -276,7 +277,9 @@ static void addunitstomap (void)
 	for (u = 0; u < 16; ++u) {
 
 	    /* reserve memory and set unit type */
-	    unit = battle->units[u + 16 * s] = new_Unit ();
+	    if (! (unit = new_Unit ()))
+		fatal_error ("Cannot create unit.");
+	    id = battle->methods->addunit (battle, unit);
 	    unit->utype = u / 5;
 	    unit->side = s;
 
@@ -296,7 +299,7 @@ static void addunitstomap (void)
 		     map->terrain[x + map->width * y] != 0);
 	    unit->x = x;
 	    unit->y = y;
-	    map->units[x + map->width * y] = u + 16 * s;
+	    map->units[x + map->width * y] = id;
 	}
 }
 
@@ -514,7 +517,7 @@ static void moveunit (char *command)
     }
 
     /* move unit */
-    if (battle->move (battle, unit, x2, y2, NULL))
+    if (battle->methods->move (battle, unit, x2, y2, NULL))
 	showmap ();
 }
 
@@ -574,7 +577,7 @@ static void attackunit (char *command)
     /* check for target and attack if allowed */
     if ((targetid = map->units[x2 + map->width * y2]) != -1 &&
 	(target = battle->units[targetid]) &&
-	battle->attack (battle, unit, target, NULL)) {
+	battle->methods->attack (battle, unit, target, NULL)) {
 	if (target->hits == 0) {
 	    printf ("Unit %d,%d destroys unit %d,%d.\n",
 		    x1, y1, x2, y2);
@@ -583,8 +586,7 @@ static void attackunit (char *command)
 	    printf ("Unit %d,%d attacks unit %d,%d.\n", x1, y1, x2, y2);
 	    if (unit->hits == 0) {
 		printf ("Unit %d,%d is destroyed.\n", x1, y1);
-		unit->destroy (unit);
-		battle->units[targetid] = NULL;
+		battle->methods->removeunit (battle, unitid);
 	    }
 	}
 	return;
@@ -672,7 +674,7 @@ static void createunit (char *command)
     }
 
     /* create unit */
-    if ((tgt = battle->create (battle, src, tgttype, x2, y2, NULL))
+    if ((tgt = battle->methods->create (battle, src, tgttype, x2, y2, NULL))
 	== -1) {
 	printf ("Cannot create %s at %d,%d.\n", token, x2, y2);
 	return;
@@ -731,7 +733,7 @@ static void restoreunit (char *command)
     /* check for target and restore if allowed */
     if ((targetid = map->units[x2 + map->width * y2]) &&
 	(target = battle->units[targetid]) &&
-	battle->restore (battle, unit, target, NULL))
+	battle->methods->restore (battle, unit, target, NULL))
 	printf ("Unit %d,%d restores unit %d,%d.\n",
 		x1, y1, x2, y2);
     else
@@ -743,7 +745,7 @@ static void restoreunit (char *command)
  */
 static void endturn (void)
 {
-    battle->turn (battle);
+    battle->methods->turn (battle);
 }
 
 /**
@@ -839,11 +841,11 @@ static void cleanup (void)
     int ut, /* unit type count */
 	t; /* terrain count */
     for (ut = 0; ut < 4; ++ut)
-	battle->utypes[ut]->destroy (battle->utypes[ut]);
+	battle->utypes[ut]->methods->destroy (battle->utypes[ut]);
     for (t = 0; t < 4; ++t)
-	battle->terrain[t]->destroy (battle->terrain[t]);
-    battle->map->destroy (battle->map);
-    battle->destroy (battle);
+	battle->terrain[t]->methods->destroy (battle->terrain[t]);
+    battle->map->methods->destroy (battle->map);
+    battle->methods->destroy (battle);
     cwg->destroy ();
 }
 
@@ -17,6 +17,58 @@
 #include "cwg.h"
 #include "map.h"
 
+/*----------------------------------------------------------------------
+ * Private Data Definitions.
+ */
+
+/** @var methods are the methods of maps allocated by themselves. */
+static const MapMethods methods;
+
+/** @var placedmethods are the methods of maps in others' memory. */
+static const MapMethods placedmethods;
+
+/*----------------------------------------------------------------------
+ * Private Level 1 Functions.
+ */
+
+/**
+ * Let go of the terrain and points, freeing them if no other map
+ * shares them.
+ * @param map is the map whose grids are to be released.
+ */
+static void releasegrids (Map *map)
+{
+    if (map->users && ! --*map->users)
+	free (map->users);
+    map->users = NULL;
+    map->terrain = NULL;
+    map->points = NULL;
+}
+
+/**
+ * Destroy a map living in memory owned by something else. Only the
+ * shared terrain and points are let go of.
+ * @param map is the map to destroy.
+ */
+static void destroyplaced (Map *map)
+{
+    if (map)
+	releasegrids (map);
+}
+
+/**
+ * Refuse to resize a map living in memory owned by something else,
+ * as its grid of units cannot grow.
+ * @param map is the map to resize.
+ * @param width is the new width.
+ * @param height is the new height.
+ * @return 0 always.
+ */
+static int sizeplaced (Map *map, int width, int height)
+{
+    return 0;
+}
+
 /*----------------------------------------------------------------------
  * Public Methods.
  */
@@ -28,12 +80,9 @@
 static void destroy (Map *map)
 {
     if (map) {
-	if (map->terrain)
-	    free (map->terrain);
+	releasegrids (map);
 	if (map->units)
 	    free (map->units);
-	if (map->points)
-	    free (map->points);
 	free (map);
     }
 }
@@ -47,38 +96,57 @@ static Map *clone (Map *map)
 {
     /* local variables */
     Map *newmap; /* the new map to return */
-    int s; /* square counter for copying */
 
     /* reserve memory for the new map */
     if (! map)
 	return NULL;
     if (! (newmap = new_Map ()))
 	return NULL;
-
-    /* set the width and height */
-    if (! newmap->size (newmap, map->width, map->height)) {
+    if (! (newmap->units = malloc (map->width * map->height))) {
 	free (newmap);
 	return NULL;
     }
 
-    /* copy the map contents */
-    for (s = 0; s < newmap->width * newmap->height; ++s) {
-	newmap->terrain[s] = map->terrain[s];
-	newmap->units[s] = map->units[s];
-	newmap->points[s] = map->points[s];
-    }
+    /* share the terrain and points, and copy the units */
+    newmap->width = map->width;
+    newmap->height = map->height;
+    newmap->users = map->users;
+    newmap->terrain = map->terrain;
+    newmap->points = map->points;
+    ++*newmap->users;
+    memcpy (newmap->units, map->units, map->width * map->height);
 
     /* return the new map */
     return newmap;
 }
 
 /**
- * Write the map to an already open file.
+ * Clone the map into memory owned by something else.
+ * @param map is the map to clone.
+ * @param memory is where to put the clone, with room for its units.
+ * @return the cloned map.
+ */
+static Map *cloneinto (Map *map, Map *memory)
+{
+    /* share the terrain and points, and copy the units */
+    *memory = *map;
+    memory->units = (unsigned char *) (memory + 1);
+    memcpy (memory->units, map->units, map->width * map->height);
+    if (memory->users)
+	++*memory->users;
+
+    /* the clone cannot free or resize its memory */
+    memory->methods = &placedmethods;
+    return memory;
+}
+
+/**
+ * Write the map to a stream.
  * @param map is the map to write.
- * @param output is the output file.
+ * @param output is the output stream.
  * @return 1 on success, 0 on failure.
  */
-static int write (Map *map, FILE *output)
+static int write (Map *map, Stream *output)
 {
     int s = 1; /* success flat */
     Cwg *cwg; /* pointer to the Cwg object */
@@ -92,9 +160,12 @@ static int write (Map *map, FILE *output)
 
     /* write the terrain, units and points */
     if (map->width && map->height) {
-	s &= fwrite (map->terrain, map->width * map->height, 1, output);
-	s &= fwrite (map->units, map->width * map->height, 1, output);
-	s &= fwrite (map->points, map->width * map->height, 1, output);
+	s &= output->methods->write
+	    (output, map->terrain, map->width * map->height);
+	s &= output->methods->write
+	    (output, map->units, map->width * map->height);
+	s &= output->methods->write
+	    (output, map->points, map->width * map->height);
     }
 
     /* return */
@@ -102,12 +173,12 @@ static int write (Map *map, FILE *output)
 }
 
 /**
- * Read the map from an already open file.
+ * Read the map from a stream.
  * @param map is the map to read.
- * @param input is the input file.
+ * @param input is the input stream.
  * @return 1 on success, 0 on failure.
  */
-static int read (Map *map, FILE *input)
+static int read (Map *map, Stream *input)
 {
     int s = 1; /* success flag */
     Cwg *cwg; /* pointer to the Cwg object */
@@ -118,13 +189,17 @@ static int read (Map *map, FILE *input)
     /* read the map dimensions */
     s &= cwg->readint (&map->width, input);
     s &= cwg->readint (&map->height, input);
-    map->size (map, map->width, map->height);
+    if (! map->methods->size (map, map->width, map->height))
+	return 0;
 
     /* read the terrain, units and points */
     if (map->width && map->height) {
-	s &= fread (map->terrain, map->width * map->height, 1, input);
-	s &= fread (map->units, map->width * map->height, 1, input);
-	s &= fread (map->points, map->width * map->height, 1, input);
+	s &= input->methods->read
+	    (input, map->terrain, map->width * map->height);
+	s &= input->methods->read
+	    (input, map->units, map->width * map->height);
+	s &= input->methods->read
+	    (input, map->points, map->width * map->height);
     }
 
     /* return */
@@ -144,24 +219,23 @@ static int size (Map *map, int width, int height)
     int size, /* total size of the map */
 	s; /* square counter */
 
-    /* calculate and validate size */
-    size = width * height;
-    if (width < 9 || height < 9 || size > 256)
+    /* validate the sides before multiplying them */
+    if (width < 9 || height < 9 ||
+	width > CWG_MAPSIDE || height > CWG_MAPSIDE)
 	return 0;
+    size = width * height;
 
-    /* allocate memory */
-    if (map->terrain)
-	free (map->terrain);
-    if (! (map->terrain = calloc (width * height, 1)))
+    /* allocate memory, with the terrain and points in one block */
+    releasegrids (map);
+    if (! (map->users = calloc (sizeof (int) + 2 * size, 1)))
 	return 0;
+    *map->users = 1;
+    map->terrain = (unsigned char *) (map->users + 1);
+    map->points = map->terrain + size;
     if (map->units)
 	free (map->units);
     if (! (map->units = calloc (width * height, 1)))
 	return 0;
-    if (map->points)
-	free (map->points);
-    if (! (map->points = calloc (width * height, 1)))
-	return 0;
 
     /* initialise the arrays */
     for (s = 0; s < width * height; ++s) {
@@ -201,6 +275,32 @@ static int distance (int ox, int oy, int dx, int dy, int taxi)
 	return vd;
 }
 
+/*----------------------------------------------------------------------
+ * Method Tables.
+ */
+
+/* the methods of maps allocated by themselves */
+static const MapMethods methods = {
+    destroy,
+    clone,
+    cloneinto,
+    write,
+    read,
+    size,
+    distance
+};
+
+/* the methods of maps in memory owned by something else */
+static const MapMethods placedmethods = {
+    destroyplaced,
+    clone,
+    cloneinto,
+    write,
+    read,
+    sizeplaced,
+    distance
+};
+
 /*----------------------------------------------------------------------
  * Constructor and any other class methods.
  */
@@ -224,14 +324,10 @@ Map *new_Map (void)
     map->terrain = NULL;
     map->units = NULL;
     map->points = NULL;
+    map->users = NULL;
 
     /* initialise methods */
-    map->destroy = destroy;
-    map->clone = clone;
-    map->write = write;
-    map->read = read;
-    map->size = size;
-    map->distance = distance;
+    map->methods = &methods;
 
     /* return the new map */
     return map;
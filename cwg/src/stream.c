@@ -0,0 +1,334 @@
+/*======================================================================
+ * CWG: Cyningstan Wargame Engine.
+ * An engine for simple turn-based wargames.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Stream Module.
+ */
+
+/* standard C headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+/* project headers */
+#include "cwg.h"
+#include "stream.h"
+
+/*----------------------------------------------------------------------
+ * Private Level 1 Functions.
+ */
+
+/**
+ * Bring a file stream's file up to the point the stream has reached,
+ * writing out the bytes waiting to be written, or stepping back over
+ * the bytes read ahead but not yet used. The buffer is left empty.
+ * @param stream is the stream to synchronise.
+ * @return 1 on success, 0 on failure.
+ */
+static int syncfile (Stream *stream)
+{
+    int s = 1; /* success flag */
+    if (stream->writing) {
+	if (stream->position)
+	    s = fwrite (stream->buffer, stream->position, 1,
+			stream->file);
+    } else if (stream->position < stream->length)
+	s = ! fseek (stream->file,
+		     - (long) (stream->length - stream->position),
+		     SEEK_CUR);
+    stream->length = stream->position = 0;
+    return s;
+}
+
+/*----------------------------------------------------------------------
+ * Public Level Functions.
+ */
+
+/**
+ * Destroy a file stream, writing out any bytes still waiting.
+ * @param stream is the stream to destroy.
+ */
+static void filedestroy (Stream *stream)
+{
+    if (stream) {
+	syncfile (stream);
+	free (stream->buffer);
+	free (stream);
+    }
+}
+
+/**
+ * Write bytes to a file stream.
+ * @param stream is the stream to write to.
+ * @param data is the bytes to write.
+ * @param count is the number of bytes to write.
+ * @return 1 on success, 0 on failure.
+ */
+static int filewrite (Stream *stream, void *data, unsigned int count)
+{
+    /* stop reading and start writing if need be */
+    if (! stream->writing) {
+	if (! syncfile (stream))
+	    return 0;
+	stream->writing = 1;
+    }
+
+    /* bytes that fit in the buffer go there */
+    if (count <= stream->size - stream->position) {
+	memcpy (stream->buffer + stream->position, data, count);
+	stream->position += count;
+	return 1;
+    }
+
+    /* empty the buffer and write big blocks straight to the file */
+    if (! syncfile (stream))
+	return 0;
+    if (count >= stream->size)
+	return fwrite (data, count, 1, stream->file);
+
+    /* otherwise start the buffer afresh */
+    memcpy (stream->buffer, data, count);
+    stream->position = count;
+    return 1;
+}
+
+/**
+ * Read bytes from a file stream.
+ * @param stream is the stream to read from.
+ * @param data is where to put the bytes read.
+ * @param count is the number of bytes to read.
+ * @return 1 if all the bytes were read, 0 if not.
+ */
+static int fileread (Stream *stream, void *data, unsigned int count)
+{
+    unsigned char *bytes; /* where to put the bytes still to read */
+    unsigned int chunk; /* bytes to copy from the buffer at once */
+
+    /* stop writing and start reading if need be */
+    if (stream->writing) {
+	if (! syncfile (stream))
+	    return 0;
+	stream->writing = 0;
+    }
+
+    /* copy what the buffer has */
+    bytes = data;
+    chunk = stream->length - stream->position;
+    if (chunk > count)
+	chunk = count;
+    memcpy (bytes, stream->buffer + stream->position, chunk);
+    stream->position += chunk;
+    bytes += chunk;
+    count -= chunk;
+    if (! count)
+	return 1;
+
+    /* read big blocks straight from the file */
+    stream->length = stream->position = 0;
+    if (count >= stream->size)
+	return fread (bytes, count, 1, stream->file);
+
+    /* otherwise fill the buffer and copy from it */
+    stream->length = fread (stream->buffer, 1, stream->size,
+			    stream->file);
+    if (stream->length < count)
+	return 0;
+    memcpy (bytes, stream->buffer, count);
+    stream->position = count;
+    return 1;
+}
+
+/**
+ * Go back to the start of a file stream's file.
+ * @param stream is the stream to rewind.
+ */
+static void filerewind (Stream *stream)
+{
+    syncfile (stream);
+    stream->writing = 0;
+    rewind (stream->file);
+}
+
+/**
+ * Get the file behind a file stream, positioned where the stream has
+ * reached.
+ * @param stream is the stream to examine.
+ * @return the file.
+ */
+static FILE *filegetfile (Stream *stream)
+{
+    syncfile (stream);
+    return stream->file;
+}
+
+/**
+ * Destroy a memory stream and the bytes it holds.
+ * @param stream is the stream to destroy.
+ */
+static void memorydestroy (Stream *stream)
+{
+    if (stream) {
+	free (stream->buffer);
+	free (stream);
+    }
+}
+
+/**
+ * Write bytes to a memory stream, growing its buffer if need be.
+ * @param stream is the stream to write to.
+ * @param data is the bytes to write.
+ * @param count is the number of bytes to write.
+ * @return 1 on success, 0 if there is not enough memory.
+ */
+static int memorywrite (Stream *stream, void *data, unsigned int count)
+{
+    unsigned char *buffer; /* the grown buffer */
+    unsigned int size; /* the size of the grown buffer */
+
+    /* grow the buffer by doubling it until the bytes fit */
+    if (count > stream->size - stream->position) {
+	if (count > UINT_MAX - stream->position)
+	    return 0;
+	for (size = stream->size; count > size - stream->position;)
+	    size = size > UINT_MAX / 2 ? UINT_MAX : 2 * size;
+	if (! (buffer = realloc (stream->buffer, size)))
+	    return 0;
+	stream->buffer = buffer;
+	stream->size = size;
+    }
+
+    /* copy the bytes in */
+    memcpy (stream->buffer + stream->position, data, count);
+    stream->position += count;
+    if (stream->position > stream->length)
+	stream->length = stream->position;
+    return 1;
+}
+
+/**
+ * Read bytes from a memory stream.
+ * @param stream is the stream to read from.
+ * @param data is where to put the bytes read.
+ * @param count is the number of bytes to read.
+ * @return 1 if all the bytes were read, 0 if not.
+ */
+static int memoryread (Stream *stream, void *data, unsigned int count)
+{
+    if (count > stream->length - stream->position)
+	return 0;
+    memcpy (data, stream->buffer + stream->position, count);
+    stream->position += count;
+    return 1;
+}
+
+/**
+ * Go back to the start of a memory stream.
+ * @param stream is the stream to rewind.
+ */
+static void memoryrewind (Stream *stream)
+{
+    stream->position = 0;
+}
+
+/**
+ * A memory stream has no file.
+ * @param stream is the stream to examine.
+ * @return NULL.
+ */
+static FILE *memorygetfile (Stream *stream)
+{
+    return NULL;
+}
+
+/*----------------------------------------------------------------------
+ * Method Tables.
+ */
+
+/* the methods of streams that wrap a file */
+static const StreamMethods filemethods = {
+    filedestroy,
+    filewrite,
+    fileread,
+    filerewind,
+    filegetfile
+};
+
+/* the methods of streams held in memory */
+static const StreamMethods memorymethods = {
+    memorydestroy,
+    memorywrite,
+    memoryread,
+    memoryrewind,
+    memorygetfile
+};
+
+/*----------------------------------------------------------------------
+ * Constructor Functions.
+ */
+
+/**
+ * File stream constructor.
+ * @param file is an open file to read from or write to.
+ * @return the new stream, or NULL if there is not enough memory.
+ */
+Stream *new_FileStream (FILE *file)
+{
+    /* local variables */
+    Stream *stream; /* the stream to return */
+
+    /* reserve memory */
+    if (! (stream = malloc (sizeof (Stream))))
+	return NULL;
+    if (! (stream->buffer = malloc (CWG_STREAMBUF))) {
+	free (stream);
+	return NULL;
+    }
+
+    /* initialise attributes */
+    stream->file = file;
+    stream->size = CWG_STREAMBUF;
+    stream->length = 0;
+    stream->position = 0;
+    stream->writing = 0;
+
+    /* initialise methods */
+    stream->methods = &filemethods;
+
+    /* return the new stream */
+    return stream;
+}
+
+/**
+ * Memory stream constructor.
+ * @return the new, empty stream, or NULL if there is not enough memory.
+ */
+Stream *new_MemoryStream (void)
+{
+    /* local variables */
+    Stream *stream; /* the stream to return */
+
+    /* reserve memory */
+    if (! (stream = malloc (sizeof (Stream))))
+	return NULL;
+    if (! (stream->buffer = malloc (CWG_STREAMBUF))) {
+	free (stream);
+	return NULL;
+    }
+
+    /* initialise attributes */
+    stream->file = NULL;
+    stream->size = CWG_STREAMBUF;
+    stream->length = 0;
+    stream->position = 0;
+    stream->writing = 0;
+
+    /* initialise methods */
+    stream->methods = &memorymethods;
+
+    /* return the new stream */
+    return stream;
+}
@@ -33,12 +33,12 @@ static void destroy (Terrain *terrain)
 }
 
 /**
- * Write a terrain type to an already open file.
+ * Write a terrain type to a stream.
  * @param terrain is the terrain to write.
- * @param output is the file to write to.
+ * @param output is the stream to write to.
  * @return 1 on success, 0 on failure.
  */
-static int write (Terrain *terrain, FILE *output)
+static int write (Terrain *terrain, Stream *output)
 {
     /* local variables */
     int u, /* unit type counter */
@@ -60,12 +60,12 @@ static int write (Terrain *terrain, FILE *output)
 }
 
 /**
- * Read a terrain type from an already open file.
+ * Read a terrain type from a stream.
  * @param terrain is the terrain to read.
- * @param input is the file to read from.
+ * @param input is the stream to read from.
  * @return 1 on success, 0 on failure.
  */
-static int read (Terrain *terrain, FILE *input)
+static int read (Terrain *terrain, Stream *input)
 {
     /* local variables */
     int u, /* unit type counter */
@@ -86,6 +86,17 @@ static int read (Terrain *terrain, FILE *input)
     return s;
 }
 
+/*----------------------------------------------------------------------
+ * Method Table.
+ */
+
+/* the methods shared by all terrain types */
+static const TerrainMethods methods = {
+    destroy,
+    write,
+    read
+};
+
 /*----------------------------------------------------------------------
  * Constructor Function Prototypes.
  */
@@ -110,9 +121,7 @@ Terrain *new_Terrain (void)
 	terrain->moves[u] = terrain->defence[u] = 0;
 
     /* initialise methods */
-    terrain->destroy = destroy;
-    terrain->write = write;
-    terrain->read = read;
+    terrain->methods = &methods;
 
     /* return the new object */
     return terrain;
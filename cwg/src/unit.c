@@ -17,6 +17,29 @@
 #include "cwg.h"
 #include "unit.h"
 
+/*----------------------------------------------------------------------
+ * Private Data Definitions.
+ */
+
+/** @var methods are the methods of units allocated by themselves. */
+static const UnitMethods methods;
+
+/** @var placedmethods are the methods of units in others' memory. */
+static const UnitMethods placedmethods;
+
+/*----------------------------------------------------------------------
+ * Private Level 1 Functions.
+ */
+
+/**
+ * Destroy a unit living in memory owned by something else. The
+ * memory is left for its owner to free.
+ * @param unit is the unit to destroy.
+ */
+static void destroyplaced (Unit *unit)
+{
+}
+
 /*----------------------------------------------------------------------
  * Public Methods.
  */
@@ -61,59 +84,94 @@ static Unit *clone (Unit *unit)
 }
 
 /**
- * Write a unit to a file.
+ * Clone a unit into memory owned by something else.
+ * @param unit is the unit to clone.
+ * @param memory is where to put the clone.
+ * @return the new unit.
+ */
+static Unit *cloneinto (Unit *unit, Unit *memory)
+{
+    *memory = *unit;
+    memory->methods = &placedmethods;
+    return memory;
+}
+
+/**
+ * Write a unit to a stream.
  * @param unit is the unit to write.
- * @param output is the output file handle.
+ * @param output is the output stream.
  * @return 1 if successful, 0 if not.
  */
-static int write (Unit *unit, FILE *output)
+static int write (Unit *unit, Stream *output)
 {
     char c; /* character count */
 
     /* write the name */
     c = strlen (unit->name);
-    fwrite (&c, 1, 1, output);
-    fwrite (unit->name, c, 1, output);
+    output->methods->write (output, &c, 1);
+    output->methods->write (output, unit->name, c);
 
     /* write the numeric data */
-    fwrite (&unit->side, sizeof (int), 1, output);
-    fwrite (&unit->utype, sizeof (int), 1, output);
-    fwrite (&unit->x, sizeof (int), 1, output);
-    fwrite (&unit->y, sizeof (int), 1, output);
-    fwrite (&unit->hits, sizeof (int), 1, output);
-    fwrite (&unit->moves, sizeof (int), 1, output);
+    output->methods->write (output, &unit->side, sizeof (int));
+    output->methods->write (output, &unit->utype, sizeof (int));
+    output->methods->write (output, &unit->x, sizeof (int));
+    output->methods->write (output, &unit->y, sizeof (int));
+    output->methods->write (output, &unit->hits, sizeof (int));
+    output->methods->write (output, &unit->moves, sizeof (int));
 
     /* success */
     return 1;
 }
 
 /**
- * Read a unit from the file.
+ * Read a unit from a stream.
  * @param unit is the unit to read.
- * @param input is the input file handle.
+ * @param input is the input stream.
  * @return 1 if successful, 0 if not.
  */
-static int read (Unit *unit, FILE *input)
+static int read (Unit *unit, Stream *input)
 {
     unsigned char c; /* character count */
 
     /* read the name */
-    fread (&c, 1, 1, input);
-    fread (unit->name, c, 1, input);
+    input->methods->read (input, &c, 1);
+    input->methods->read (input, unit->name, c);
     unit->name[(int) c] = '\0';
 
     /* read the numeric data */
-    fread (&unit->side, sizeof (int), 1, input);
-    fread (&unit->utype, sizeof (int), 1, input);
-    fread (&unit->x, sizeof (int), 1, input);
-    fread (&unit->y, sizeof (int), 1, input);
-    fread (&unit->hits, sizeof (int), 1, input);
-    fread (&unit->moves, sizeof (int), 1, input);
+    input->methods->read (input, &unit->side, sizeof (int));
+    input->methods->read (input, &unit->utype, sizeof (int));
+    input->methods->read (input, &unit->x, sizeof (int));
+    input->methods->read (input, &unit->y, sizeof (int));
+    input->methods->read (input, &unit->hits, sizeof (int));
+    input->methods->read (input, &unit->moves, sizeof (int));
 
     /* success */
     return 1;
 }
 
+/*----------------------------------------------------------------------
+ * Method Tables.
+ */
+
+/* the methods of units allocated by themselves */
+static const UnitMethods methods = {
+    destroy,
+    clone,
+    cloneinto,
+    write,
+    read
+};
+
+/* the methods of units in memory owned by something else */
+static const UnitMethods placedmethods = {
+    destroyplaced,
+    clone,
+    cloneinto,
+    write,
+    read
+};
+
 /*----------------------------------------------------------------------
  * Constructor Function Prototypes.
  */
@@ -141,10 +199,7 @@ Unit *new_Unit (void)
     unit->moves = 0;
 
     /* initialise methods */
-    unit->destroy = destroy;
-    unit->clone = clone;
-    unit->write = write;
-    unit->read = read;
+    unit->methods = &methods;
 
     /* return the new unit */
     return unit;
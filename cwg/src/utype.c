@@ -36,12 +36,12 @@ static void destroy (UnitType *utype)
 }
 
 /**
- * Write the unit type to an already open file.
+ * Write the unit type to a stream.
  * @param utype is the unit type to write.
- * @param output is the output file.
+ * @param output is the output stream.
  * @return 1 on success, 0 on failure.
  */
-static int write (UnitType *utype, FILE *output)
+static int write (UnitType *utype, Stream *output)
 {
     /* local variables */
     int u, /* unit type counter */
@@ -69,12 +69,12 @@ static int write (UnitType *utype, FILE *output)
 }
 
 /**
- * Read the unit type from an already open file.
+ * Read the unit type from a stream.
  * @param utype is the unit type to read.
- * @param input is the input file.
+ * @param input is the input stream.
  * @return 1 on success, 0 on failure.
  */
-static int read (UnitType *utype, FILE *input)
+static int read (UnitType *utype, Stream *input)
 {
     /* local variables */
     int u, /* unit type counter */
@@ -101,6 +101,17 @@ static int read (UnitType *utype, FILE *input)
     return s;
 }
 
+/*----------------------------------------------------------------------
+ * Method Table.
+ */
+
+/* the methods shared by all unit types */
+static const UnitTypeMethods methods = {
+    destroy,
+    write,
+    read
+};
+
 /*----------------------------------------------------------------------
  * Public Constructors and Other Class Functions.
  */
@@ -131,9 +142,7 @@ UnitType *new_UnitType (void)
 	utype->builds[u] = 0;
 
     /* initialise methods */
-    utype->destroy = destroy;
-    utype->write = write;
-    utype->read = read;
+    utype->methods = &methods;
 
     /* return the new object */
     return utype;
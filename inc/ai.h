@@ -50,6 +50,20 @@ struct ai {
      */
     void (*turn) (void);
 
+    /**
+     * Set how long a tree search player may think on each turn.
+     * @param side         The side that the budget applies to.
+     * @param milliseconds The time allowed for each turn's search.
+     */
+    void (*setbudget) (int side, long milliseconds);
+
+    /**
+     * Get the work done by tree search players since the AI was made.
+     * @param nodes        Set to the number of nodes searched.
+     * @param milliseconds Set to the time spent searching them.
+     */
+    void (*searchstats) (long *nodes, long *milliseconds);
+
 };
 
 /* display hooks */
@@ -19,6 +19,7 @@ typedef struct campaign Campaign;
 #include "cgalib.h"
 #include "utype.h"
 #include "terrain.h"
+#include "combat.h"
 #include "scenario.h"
 
 /*----------------------------------------------------------------------
@@ -72,6 +73,9 @@ struct campaign {
     /** @var resource The terrain square that provides resources. */
     int resource;
 
+    /** @var combat The combat tables for the unit and terrain types. */
+    Combat *combat;
+
     /** @var terrainbitmaps A array of bitmaps for terrain. */
     Bitmap *terrainbitmaps[16 * CWG_TERRAIN];
 
@@ -98,21 +102,23 @@ struct campaign {
     void (*clear) (Campaign *campaign);
 
     /**
-     * Save a campaign to an already-open file.
+     * Save a campaign to a file stream. The bitmaps are written
+     * straight to the file, so a memory stream will not do.
      * @param campaign is the campaign to save.
-     * @param output is the already-open output file.
+     * @param output is the output stream.
      * @return 1 if successful, 0 if not.
      */
-    int (*write) (Campaign *campaign, FILE *output);
+    int (*write) (Campaign *campaign, Stream *output);
 
     /**
-     * Load a campaign from an already-open file.
+     * Load a campaign from a file stream. The bitmaps are read
+     * straight from the file, so a memory stream will not do.
      * @param campaign The campaign to load.
      * @param summary  0 to load full campaign, 1 for summary only.
-     * @param input    The already-open input file.
+     * @param input    The input stream.
      * @return         1 if successful, 0 if not.
      */
-    int (*read) (Campaign *campaign, int summary, FILE *input);
+    int (*read) (Campaign *campaign, int summary, Stream *input);
 
     /**
      * Load a campaign file. The filename attribute is used.
@@ -26,6 +26,7 @@ enum player_type {
     PLAYER_FAIR, /* computer player, fair level */
     PLAYER_HARD, /* computer player, hard level */
     PLAYER_PBM, /* PBM player */
+    PLAYER_SEARCH, /* computer player, tree search level */
     PLAYER_LAST /* placeholder */
 };
 
@@ -42,6 +43,9 @@ struct config {
     /** @var gamefile The filename for the game in play. */
     char gamefile[13];
 
+    /** @var searchtime Seconds a tree search player thinks per turn. */
+    int searchtime;
+
     /*
      * Public Method Declarations.
      */
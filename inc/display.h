@@ -125,7 +125,8 @@ struct display {
 		       int y);
 
     /**
-     * Prepare a battle map.
+     * Prepare a battle map. Squares are drawn from the battle as
+     * they come into view, so it must last as long as it is shown.
      * @param campaign The campaign containing the bitmaps.
      * @param battle   The battle to display.
      */
@@ -158,6 +159,16 @@ struct display {
     void (*hidemapcursor) (int xcursor, int ycursor, int xview,
 			   int yview);
 
+    /**
+     * Mark the squares in view that the selected unit can reach.
+     * @param squares The reachable flag for each map square.
+     * @param width   The width of the map.
+     * @param xview   The x coordinate of the map view.
+     * @param yview   The y coordinate of the map view.
+     */
+    void (*showmapreach) (unsigned char *squares, int width, int xview,
+			  int yview);
+
     /**
      * Show information on empty terrain.
      * @param terrainid The ID of the terrain to show.
@@ -34,6 +34,25 @@ typedef enum {
     ACTION_REPAIR /* repair a unit */
 } ReportAction;
 
+/**
+ * @enum ReportFormat
+ * The formats of report entries in saved files.
+ */
+typedef enum {
+    REPORT_PACKED, /* one long per entry, with 8-bit positions */
+    REPORT_WIDE /* three 16-bit words per entry */
+} ReportFormat;
+
+/**
+ * @struct ReportEntry
+ * A single action in a turn report.
+ */
+typedef struct {
+    unsigned short code; /* action, unit type and target type */
+    unsigned short origin; /* origin position */
+    unsigned short target; /* target position */
+} ReportEntry;
+
 /**
  * @struct report
  * The turn report structure.
@@ -47,7 +66,7 @@ struct report {
     Battle *battle;
 
     /** @var entries is the list of entries in the report. */
-    long int *entries;
+    ReportEntry *entries;
 
     /**
      * Destroy a report when it is no longer needed.
@@ -63,20 +82,21 @@ struct report {
     Report *(*clone) (Report *report);
 
     /**
-     * Write a report to an open file.
+     * Write a report to a stream, in the REPORT_WIDE format.
      * @param  report The report to write.
-     * @param  output The output file handle.
+     * @param  output The output stream.
      * @return        1 if successful, 0 on failure.
      */
-    int (*write) (Report *report, FILE *output);
+    int (*write) (Report *report, Stream *output);
 
     /**
-     * Read a report from an open file.
+     * Read a report from a stream.
      * @param  report The report to read.
-     * @param  input  The input file handle.
+     * @param  input  The input stream.
+     * @param  format The ReportFormat of the entries in the file.
      * @return        1 if successful, 0 on failure.
      */
-    int (*read) (Report *report, FILE *input);
+    int (*read) (Report *report, Stream *input, int format);
 
     /**
      * Clear the entries from a report.
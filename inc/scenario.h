@@ -63,20 +63,20 @@ struct scenario {
     void (*destroy) (Scenario *scenario);
 
     /**
-     * Write scenario details to an already open file.
+     * Write scenario details to a stream.
      * @param scenario is the scenario to save.
-     * @param output is the output file.
+     * @param output is the output stream.
      * @return 1 for success, 0 for failure.
      */
-    int (*write) (Scenario *scenario, FILE *output);
+    int (*write) (Scenario *scenario, Stream *output);
 
     /**
-     * Read scenario details from an already open file.
+     * Read scenario details from a stream.
      * @param scenario is the scenario to load.
-     * @param input is the input file.
+     * @param input is the input stream.
      * @return 1 for success, 0 for failure.
      */
-    int (*read) (Scenario *scenario, FILE *input);
+    int (*read) (Scenario *scenario, Stream *input);
 
 };
 
@@ -14,6 +14,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __unix__
+#include <time.h>
+#else
+#include <sys/timeb.h>
+#endif
 
 /* project-specific headers */
 #include "ai.h"
@@ -24,6 +29,49 @@
 #include "fatal.h"
 #include "cwg.h"
 
+/*----------------------------------------------------------------------
+ * Constants.
+ */
+
+/** @const TARGETROOM is the room for targets made on the first turn */
+#define TARGETROOM 64
+
+/** @const BUDGET is the default milliseconds for a turn's search */
+#define BUDGET 2000L
+
+/** @const SEARCHNODES is the most nodes the search tree will hold */
+#define SEARCHNODES 1024
+
+/** @const SEARCHCHILDREN is the most actions tried from each node */
+#define SEARCHCHILDREN 16
+
+/** @const SEARCHACTIONS is the room first made for a node's actions */
+#define SEARCHACTIONS 256
+
+/** @const MAXACTIONS is the most legal actions a node will list */
+#define MAXACTIONS 4096
+
+/** @const SEARCHDEPTH is the most actions searched ahead in a turn */
+#define SEARCHDEPTH 8
+
+/** @const SEARCHPLIES is the number of turns each rollout plays */
+#define SEARCHPLIES 2
+
+/** @const SEARCHWIN is the reward for a rollout that wins the battle */
+#define SEARCHWIN 1000L
+
+/** @const SEARCHEXPLORE weighs trying new actions against rewards */
+#define SEARCHEXPLORE 250L
+
+/** @const SEARCHCOMMIT is the visits an action needs to be played */
+#define SEARCHCOMMIT 4
+
+/** @const SEARCHSTOP marks the action that leaves the turn to plan */
+#define SEARCHSTOP -1
+
+/** @const SEARCHSALT spreads the pass numbers that reseed the search */
+#define SEARCHSALT 2654435761UL
+
 /*----------------------------------------------------------------------
  * Data Definitions.
  */
@@ -92,12 +140,6 @@ struct target {
      */
     int allocation;
 
-    /**
-     * @var next
-     * A pointer to the next target in the list.
-     */
-    Target *next;
-
 };
 
 /**
@@ -107,13 +149,6 @@ struct target {
 typedef struct agent Agent;
 struct agent {
 
-    /**
-     * @var count
-     * A counter of the number of agents in the list.
-     * Only the counter of the first node is valid.
-     */
-    int count;
-
     /**
      * @var unit
      * The unit number of the agent.
@@ -144,14 +179,55 @@ struct agent {
      */
     Target *target;
 
-    /**
-     * @var next
-     * A pointer to the next agent in the list.
-     */
-    Agent *next;
-
 };
 
+/**
+ * @struct influence
+ * The influence of both sides over a square, worked out at the start
+ * of each turn and kept up to date as units move, fight and are built.
+ */
+typedef struct influence {
+
+    /** @var cover Firepower our units can bring to bear on the square. */
+    int cover;
+
+    /** @var threat Firepower the enemy can bring to bear next turn. */
+    int threat;
+
+    /** @var power Total attack power of the enemies able to fire. */
+    int power;
+
+    /** @var attackers Number of enemies able to fire on the square. */
+    int attackers;
+
+} Influence;
+
+/**
+ * @struct searchnode
+ * A node in the search tree: the sequence of actions leading to it
+ * from the start of the turn, and the rewards of the rollouts played
+ * after it. The tree is held in one array, each node's children
+ * linked through their siblings.
+ */
+typedef struct searchnode {
+
+    /** @var action The last action in the sequence, or SEARCHSTOP. */
+    CwgAction action;
+
+    /** @var child The first child, or -1 if not yet expanded. */
+    int child;
+
+    /** @var sibling The next child of the same parent, or -1. */
+    int sibling;
+
+    /** @var visits The number of rollouts played through the node. */
+    long visits;
+
+    /** @var reward The total reward of those rollouts. */
+    long reward;
+
+} SearchNode;
+
 /**
  * @struct aidata
  * Private data for the AI.
@@ -193,6 +269,90 @@ struct aidata {
      */
     int points;
 
+    /**
+     * @var targets
+     * The targets identified this turn. The array is kept from turn
+     * to turn, and grown when a turn finds more targets than it has
+     * room for.
+     */
+    Target *targets;
+
+    /** @var targetcount The number of targets identified this turn. */
+    int targetcount;
+
+    /** @var targetroom The number of targets there is room for. */
+    int targetroom;
+
+    /**
+     * @var targetindex
+     * The targets in descending order of importance.
+     */
+    Target **targetindex;
+
+    /** @var targetscratch Working space for sorting the targets. */
+    Target **targetscratch;
+
+    /** @var agents The friendly units available this turn. */
+    Agent agents[CWG_MAXUNITS];
+
+    /** @var agentcount The number of agents this turn. */
+    int agentcount;
+
+    /** @var agentindex The agents in order of suitability. */
+    Agent *agentindex[CWG_MAXUNITS];
+
+    /** @var agentscratch Working space for sorting the agents. */
+    Agent *agentscratch[CWG_MAXUNITS];
+
+    /**
+     * @var influence
+     * The influence of both sides over each square of the map. Our
+     * units cover the squares within range of where they stand; the
+     * enemy threatens the squares within range of anywhere it could
+     * move to on its next turn.
+     */
+    Influence *influence;
+
+    /** @var influenceroom The number of squares there is room for. */
+    int influenceroom;
+
+    /** @var marks The last stamp given to each square while spreading. */
+    unsigned int *marks;
+
+    /** @var stamp The stamp for the unit currently being spread. */
+    unsigned int stamp;
+
+    /**
+     * @var reach
+     * The squares an agent can reach this turn, found afresh for
+     * each agent that needs them. Grown along with the influence.
+     */
+    unsigned char *reach;
+
+    /** @var nodes The search tree, made when first needed. */
+    SearchNode *nodes;
+
+    /** @var nodecount The number of nodes in the search tree. */
+    int nodecount;
+
+    /** @var actionlist Room to list the legal actions at a node. */
+    CwgAction *actionlist;
+
+    /** @var actionroom The number of actions there is room for. */
+    int actionroom;
+
+    /** @var budgets Milliseconds each side may search on a turn. */
+    long budgets[2];
+
+    /** @var searched Nodes searched since the AI was made. */
+    long searched;
+
+    /** @var searchtime Milliseconds spent searching them. */
+    long searchtime;
+
+    /** @var rollout 1 in a worker's data, so no rollout is reported. */
+    int rollout;
+
     /** @var prompthook Pointer to an external prompt function. */
     PromptHook prompthook;
 
@@ -201,11 +361,144 @@ struct aidata {
 };
 
 /**
- * @var ai
- * The single AI instance.
+ * @struct worker
+ * A context to play rollouts in. The worker has its own copy of the
+ * battle being searched, and its own copy of the AI, the planner's
+ * data and the game, which the rollout sees in place of the
+ * originals, so that a rollout leaves the real game untouched.
+ */
+typedef struct worker Worker;
+struct worker {
+
+    /** @var ai The worker's copy of the AI, pointing to its data. */
+    AI ai;
+
+    /** @var data The planner's data, with buffers of its own. */
+    AIData data;
+
+    /** @var game The worker's copy of the game, with its battle. */
+    Game game;
+
+    /** @var search The worker's copy of the battle being searched. */
+    Battle *search;
+
+    /** @var battle The copy of the search battle being played out. */
+    Battle *battle;
+
+    /** @var side The side searching. */
+    int side;
+
+    /** @var path The nodes followed on the worker's pass. */
+    int path[SEARCHDEPTH + 1];
+
+    /** @var depth The number of nodes followed after the root. */
+    int depth;
+
+    /** @var applied The number of actions applied to the search copy. */
+    int applied;
+
+    /** @var reward The reward of the worker's rollout. */
+    long reward;
+
+};
+
+/**
+ * A point in time, for measuring how long a search has taken. The
+ * host build uses the monotonic clock; DOS has only ftime ().
  */
+#ifdef __unix__
+typedef struct timespec Moment;
+#else
+typedef struct timeb Moment;
+#endif
+
+/** @var ai The single AI instance. */
 static AI *ai = NULL;
 
+/*----------------------------------------------------------------------
+ * Influence Map Functions.
+ */
+
+/**
+ * Add a unit's influence to the squares it can fire on, or take it
+ * away. Our units fire from where they stand. Enemy units fire from
+ * any square they can move to, by the terrain alone, next turn.
+ * @param unit     The unit whose influence is spread.
+ * @param location The square the unit occupies, or occupied.
+ * @param sign     1 to add the influence, -1 to take it away.
+ */
+static void spreadinfluence (Unit *unit, int location, int sign)
+{
+    Battle *battle; /* pointer to the battle */
+    Map *map; /* pointer to the battle map */
+    UnitType *utype; /* the unit's type */
+    Influence *square; /* influence over a square fired upon */
+    int enemy, /* 1 if the unit is an enemy */
+	moves, /* moves the unit can make before firing */
+	firepower, /* the unit's power * range */
+	ox, /* x coordinate of the unit */
+	oy, /* y coordinate of the unit */
+	fx, /* x coordinate of a square to fire from */
+	fy, /* y coordinate of a square to fire from */
+	tx, /* x coordinate of a square fired upon */
+	ty, /* y coordinate of a square fired upon */
+	cost, /* movement cost to the square to fire from */
+	l; /* location of the square fired upon */
+
+    /* ignore units that cannot fire */
+    battle = ai->data->game->battle;
+    map = battle->map;
+    utype = ai->data->game->campaign->unittypes[unit->utype];
+    if (! ai->data->influence || ! utype->power)
+	return;
+    enemy = unit->side != battle->side;
+    moves = (enemy && ai->data->unitcats[unit->utype].mobile)
+	? utype->moves
+	: 0;
+    firepower = sign * utype->power * utype->range;
+
+    /* a moving unit takes a fresh stamp so no square is counted twice */
+    if (moves && ! ++ai->data->stamp) {
+	memset (ai->data->marks, 0,
+		map->width * map->height * sizeof (unsigned int));
+	ai->data->stamp = 1;
+    }
+
+    /* mark the squares in range of each square the unit can reach */
+    ox = location % map->width;
+    oy = location / map->width;
+    for (fy = oy - moves; fy <= oy + moves; ++fy)
+	for (fx = ox - moves; fx <= ox + moves; ++fx) {
+	    if (fx < 0 || fx >= map->width || fy < 0 || fy >= map->height)
+		continue;
+	    if (moves) {
+		cost = battle->methods->pathdistance
+		    (battle, unit->utype, ox, oy, fx, fy);
+		if (cost < 0 || cost > moves)
+		    continue;
+	    }
+	    for (ty = fy - utype->range; ty <= fy + utype->range; ++ty)
+		for (tx = fx - utype->range; tx <= fx + utype->range; ++tx) {
+		    if (tx < 0 || tx >= map->width ||
+			ty < 0 || ty >= map->height)
+			continue;
+		    l = tx + map->width * ty;
+		    if (moves) {
+			if (ai->data->marks[l] == ai->data->stamp)
+			    continue;
+			ai->data->marks[l] = ai->data->stamp;
+		    }
+		    square = &ai->data->influence[l];
+		    if (enemy) {
+			square->threat += firepower;
+			square->power += sign * utype->power;
+			square->attackers += sign;
+		    } else
+			square->cover += firepower;
+		}
+	}
+}
+
 /*----------------------------------------------------------------------
  * CWG Display Hooks.
  */
@@ -222,8 +515,11 @@ static void movehook (Unit *unit, int x, int y)
     int width; /* width of battle map */
     game = ai->data->game;
     width = game->battle->map->width;
-    game->report->add (game->report, ACTION_MOVE, unit->utype, 0,
-		       x + width * y, unit->x + width * unit->y);
+    if (! ai->data->rollout)
+	game->report->add (game->report, ACTION_MOVE, unit->utype, 0,
+			   x + width * y, unit->x + width * unit->y);
+    spreadinfluence (unit, x + width * y, -1);
+    spreadinfluence (unit, unit->x + width * unit->y, 1);
 }
 
 /**
@@ -238,10 +534,15 @@ static void attackhook (Unit *attacker, Unit *defender,
     int width; /* width of the battle map */
     game = ai->data->game;
     width = game->battle->map->width;
-    game->report->add (game->report, ACTION_ATTACK + result,
-		       attacker->utype, defender->utype,
-		       attacker->x + width * attacker->y,
-		       defender->x + width * defender->y); 
+    if (! ai->data->rollout)
+	game->report->add (game->report, ACTION_ATTACK + result,
+			   attacker->utype, defender->utype,
+			   attacker->x + width * attacker->y,
+			   defender->x + width * defender->y);
+    if (! defender->hits)
+	spreadinfluence (defender, defender->x + width * defender->y, -1);
+    if (! attacker->hits)
+	spreadinfluence (attacker, attacker->x + width * attacker->y, -1);
 }
 
 /**
@@ -255,11 +556,13 @@ static void buildhook (Unit *builder, Unit *built)
     int width; /* width of the battle map */
     game = ai->data->game;
     width = game->battle->map->width;
-    game->report->add (game->report, ACTION_BUILD,
-		       builder->utype, built->utype,
-		       builder->x + width * builder->y,
-		       built->x + width * built->y);
+    if (! ai->data->rollout)
+	game->report->add (game->report, ACTION_BUILD,
+			   builder->utype, built->utype,
+			   builder->x + width * builder->y,
+			   built->x + width * built->y);
     strcpy (built->name, game->campaign->unittypes[built->utype]->name);
+    spreadinfluence (built, built->x + width * built->y, 1);
 }
 
 /**
@@ -273,10 +576,11 @@ static void repairhook (Unit *builder, Unit *built)
     int width; /* width of the battle map */
     game = ai->data->game;
     width = game->battle->map->width;
-    game->report->add (game->report, ACTION_REPAIR,
-		       builder->utype, built->utype,
-		       builder->x + width * builder->y,
-		       built->x + width * built->y);
+    if (! ai->data->rollout)
+	game->report->add (game->report, ACTION_REPAIR,
+			   builder->utype, built->utype,
+			   builder->x + width * builder->y,
+			   built->x + width * built->y);
 }
 
 /*----------------------------------------------------------------------
@@ -300,6 +604,102 @@ static int proximityfactor (int first, int second)
     return ai->data->maxdist - (x + y);
 }
 
+/**
+ * Calculate nearness of one square to another for a mobile unit type,
+ * by the cost of travelling between them through the terrain.
+ * @param  utype  The unit type travelling.
+ * @param  first  The square travelled from.
+ * @param  second The square travelled to.
+ * @return        The importance factor 0..maxdist.
+ */
+static int travelfactor (int utype, int first, int second)
+{
+    Battle *battle; /* pointer to the battle */
+    int width, /* width of the map */
+	cost; /* movement points needed to travel */
+    battle = ai->data->game->battle;
+    width = battle->map->width;
+    cost = battle->methods->pathdistance (battle, utype,
+					  first % width, first / width,
+					  second % width, second / width);
+    if (cost < 0 || cost >= ai->data->maxdist)
+	return 0;
+    return ai->data->maxdist - cost;
+}
+
+/**
+ * Estimate the danger from enemy fire next turn to a unit on a square,
+ * as an importance factor. On average each enemy able to fire on the
+ * square does half of its power, less the unit's defence, in damage.
+ * @param  utypeid  The unit type on the square.
+ * @param  location The square.
+ * @return          The importance factor 0..maxdist.
+ */
+static int dangerfactor (int utypeid, int location)
+{
+    Battle *battle; /* pointer to the battle */
+    UnitType *utype; /* the unit type */
+    CwgPlanes *planes; /* flat terrain planes */
+    Influence *square; /* influence over the square */
+    int damage; /* expected damage to the unit */
+
+    /* initialise convenience variables */
+    battle = ai->data->game->battle;
+    utype = ai->data->game->campaign->unittypes[utypeid];
+    if (! ai->data->influence || ! utype->hits)
+	return 0;
+    if (! (planes = battle->methods->getplanes (battle)))
+	fatalerror (FATAL_MEMORY);
+
+    /* work out the damage expected, up to the unit's hits */
+    square = &ai->data->influence[location];
+    damage = square->power - square->attackers
+	* (utype->armour + planes->defence[utypeid * planes->size + location]);
+    damage /= 2;
+    if (damage <= 0)
+	return 0;
+    if (damage > utype->hits)
+	damage = utype->hits;
+    return (int) ((long) damage * ai->data->maxdist / utype->hits);
+}
+
+/**
+ * Return the order in which a scan of the map, column by column,
+ * reaches a square. Used to break ties between equally good squares
+ * the same way whatever order they were examined in.
+ * @param  location The square.
+ * @return          Its position in the scan.
+ */
+static int columnorder (int location)
+{
+    Map *map; /* pointer to the battle map */
+    map = ai->data->game->battle->map;
+    return (location % map->width) * map->height + location / map->width;
+}
+
+/**
+ * Find a square in the list of those around another.
+ * @param  rings  The rings of squares from the battle.
+ * @param  centre The square at the centre of the list.
+ * @param  c      The entry in the list.
+ * @return        The square, or -1 if the entry lies off the map.
+ */
+static int ringsquare (CwgRings *rings, int centre, int c)
+{
+    Map *map; /* pointer to the battle map */
+    int x, /* x coordinate of the centre */
+	location; /* the square to return */
+    map = ai->data->game->battle->map;
+    x = centre % map->width;
+    c += rings->stride * ((x >= map->width / 2)
+			  + 2 * (centre / map->width >= map->height / 2));
+    location = centre + rings->offsets[c];
+    if (x + rings->xoffsets[c] < 0 || x + rings->xoffsets[c] >= map->width
+	|| location < 0 || location >= map->width * map->height)
+	return -1;
+    return location;
+}
+
 /*----------------------------------------------------------------------
  * Level 4 Private Function Definitions.
  */
@@ -330,58 +730,64 @@ static int scale (int factor, int max)
 static int nearby (int uloc, int target, int direction, int range,
 		   int utype)
 {
-    int width, /* width of the map */
-	height, /* height of the map */
-	bestscore, /* best location score so far */
+    int bestscore, /* best location score so far */
 	bestlocation, /* best location so far */
-	x, /* x coordinate of location being considered */
-	y, /* y coordinate of location being considered */
 	location, /* location being considered */
-	score; /* score for the current location */
-    Terrain *terrain; /* terrain of location being considered */
-    Campaign *campaign; /* pointer to the campaign */
-    Map *map; /* pointer to the map */
+	score, /* score for the current location */
+	ends, /* end of the squares in range of the target */
+	better, /* 1 if the current location beats the best so far */
+	c; /* counter for squares in range */
+    unsigned char *defence, /* defence bonuses for the unit type */
+	*moves; /* movement costs for the unit type */
+    Battle *battle; /* pointer to the battle */
+    Map *map; /* pointer to the battle map */
+    CwgPlanes *planes; /* flat terrain planes */
+    CwgRings *rings; /* squares around each square */
 
     /* initialise some variables */
-    campaign = ai->data->game->campaign;
-    map = ai->data->game->battle->map;
-    width = map->width;
-    height = map->height;
+    battle = ai->data->game->battle;
+    map = battle->map;
     bestscore = 0;
     bestlocation = direction;
+    if (! (planes = battle->methods->getplanes (battle)))
+	fatalerror (FATAL_MEMORY);
+    if (! (rings = battle->methods->getrings (battle)))
+	fatalerror (FATAL_MEMORY);
+    defence = planes->defence + utype * planes->size;
+    moves = planes->moves + utype * planes->size;
+
+    /* work out the area in range of the target */
+    if (range > rings->radius)
+	range = rings->radius;
+    ends = rings->ends[range];
+
+    /* look at each empty location in range that the unit can enter */
+    for (c = 0; c < ends; ++c) {
+	if ((location = ringsquare (rings, target, c)) == -1 ||
+	    location == target)
+	    continue;
+	if (location != uloc && map->units[location] != CWG_NO_UNIT)
+	    continue;
+	if (ai->data->unitcats[utype].mobile && ! moves[location])
+	    continue;
 
-    /* look at each location in range of the target */
-    for (x = (target % width) - range; 
-	 x <= (target % width) + range;
-	 ++x) {
-	for (y = (target / width) - range;
-	     y <= (target / width) + range;
-	     ++y) {
-
-	    /* reject invalid locations */
-	    if (x < 0 || x >= width || y < 0 || y >= height)
-		continue; /* off the map */
-	    location = x + width * y;
-	    if (location == target)
-		continue; /* right on the target */
-	    if (map->units[location] != CWG_NO_UNIT &&
-		location != uloc)
-		continue; /* location occupied */
-	    terrain = campaign->terrain[map->terrain[location]];
-	    if (ai->data->unitcats[utype].mobile &&
-		! terrain->moves[utype])
-		continue; /* inaccessible to the unit */
-
-	    /* score the location */
-	    score = terrain->defence[utype] +
-		proximityfactor (location, direction);
-	    if (score > bestscore) {
-		bestscore = score;
-		bestlocation = location;
-	    } else if (score >= bestscore && location == uloc) {
-		bestscore = score;
-		bestlocation = location;
-	    }
+	/* score the location, preferring squares safe from enemy fire */
+	score = defence[location] +
+	    (ai->data->unitcats[utype].mobile
+	     ? travelfactor (utype, direction, location)
+	     : proximityfactor (location, direction)) +
+	    (ai->data->maxdist - dangerfactor (utype, location)) / 2;
+
+	/* the unit's own square wins ties, then the first in a scan */
+	if (score > bestscore || (score == bestscore && location == uloc))
+	    better = 1;
+	else if (score == bestscore && score > 0 && bestlocation != uloc)
+	    better = columnorder (location) < columnorder (bestlocation);
+	else
+	    better = 0;
+	if (better) {
+	    bestscore = score;
+	    bestlocation = location;
 	}
     }
 
@@ -396,11 +802,13 @@ static Report *initreport (void)
 {
     Game *game; /* pointer to the game */
     game = ai->data->game;
+    if (ai->data->rollout)
+	return game->report;
     if (! game->report) {
 	game->report = new_Report ();
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
     } else if (! game->report->battle)
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
     return game->report;
 }
 
@@ -460,6 +868,26 @@ static int pointfactor (int square)
     return scale (point, 1);
 }
 
+/**
+ * Return as a factor how far the enemy's firepower over a square
+ * outweighs our own.
+ * @param  square The square to examine.
+ * @return        The importance factor 0..maxdist, 0 if uncontested.
+ */
+static int controlfactor (int square)
+{
+    Influence *influence; /* influence over the square */
+    if (! ai->data->influence)
+	return 0;
+    influence = &ai->data->influence[square];
+    if (influence->threat <= 0)
+	return 0;
+    return scale (influence->threat,
+		  influence->cover > 0
+		  ? influence->cover + influence->threat
+		  : influence->threat);
+}
+
 /**
  * Return a unit's damage as an importance factor.
  * @param  unit The damaged unit.
@@ -483,41 +911,94 @@ static int staticfactor (int utype)
 }
 
 /**
- * Create a sortable index of agents.
- * @param  agents A linked list of agents.
- * @return        An array of pointers to agents.
+ * Fill the sortable index of agents, in the order of the agent list.
+ * @return The index of agents.
  */
-static Agent **indexagents (Agent *agents)
+static Agent **indexagents (void)
 {
-    Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
-    if (! (index = malloc (agents->count * sizeof (Agent *))))
-	fatalerror (FATAL_MEMORY);
-    for (agent = agents; agent; agent = agent->next)
-	index[agents->count - agent->count] = agent;
-    return index;
+    int a; /* agent counter */
+    for (a = 0; a < ai->data->agentcount; ++a)
+	ai->data->agentindex[a] = &ai->data->agents[a];
+    return ai->data->agentindex;
 }
 
 /**
- * Sort the index of agents by suitability.
+ * Sort an index of agents by descending suitability. This is a
+ * merge sort, so agents of equal suitability keep their order.
  * @param count The number of agents.
  * @param index The index of agents.
  */
 static void sortagents (int count, Agent **index)
 {
-    Agent *agent; /* temporary swap value */
-    int sorted, /* 1 if the index is sorted */
-	i; /* index counter */
-    do {
-	sorted = 1;
-	for (i = 0; i < count - 1; ++i)
-	    if (index[i]->suitability < index[i + 1]->suitability) {
-		agent = index[i];
-		index[i] = index[i + 1];
-		index[i + 1] = agent;
-		sorted = 0;
-	    }
-    } while (! sorted);
+    Agent **scratch; /* working space for merging */
+    int half, /* number of agents in the first half */
+	a, /* position in the first half */
+	b, /* position in the second half */
+	i; /* position in the merged index */
+
+    /* sort each half of the index */
+    if (count < 2)
+	return;
+    half = count / 2;
+    sortagents (half, index);
+    sortagents (count - half, index + half);
+
+    /* merge the halves, taking from the first on a tie */
+    scratch = ai->data->agentscratch;
+    for (a = 0, b = half, i = 0; i < count; ++i)
+	if (b == count ||
+	    (a < half && index[a]->suitability >= index[b]->suitability))
+	    scratch[i] = index[a++];
+	else
+	    scratch[i] = index[b++];
+    memcpy (index, scratch, count * sizeof (Agent *));
+}
+
+/**
+ * Work out how much an agent adds to a target's allocation.
+ * Repairers and units rallying to a repair unit add nothing, so a
+ * damaged unit or a repair unit takes every suitable agent.
+ * @param  target The target.
+ * @param  agent  The agent allocated to it.
+ * @return        The amount added to the target's allocation.
+ */
+static int contribution (Target *target, Agent *agent)
+{
+    Battle *battle; /* pointer to the battle */
+    UnitType *utype; /* pointer to the agent's unit type */
+    switch (target->type) {
+    case TARGET_ATTACK:
+	battle = ai->data->game->battle;
+	utype = ai->data->game->campaign->unittypes
+	    [battle->units[agent->unit]->utype];
+	return utype->power * utype->range;
+    case TARGET_OCCUPATION:
+	return target->requirements;
+    case TARGET_REPAIR:
+    case TARGET_RALLY:
+	return 0;
+    default:
+	return 1;
+    }
+}
+
+/**
+ * Take the most suitable agents for a target until its requirements
+ * are met.
+ * @param target The target to take agents for.
+ * @param index  The agents in descending order of suitability.
+ */
+static void takeagents (Target *target, Agent **index)
+{
+    int i; /* counter for index */
+    for (i = 0;
+	 i < ai->data->agentcount &&
+	     index[i]->suitability &&
+	     target->allocation < target->requirements;
+	 ++i) {
+	target->allocation += contribution (target, index[i]);
+	index[i]->target = target;
+    }
 }
 
 /**
@@ -543,17 +1024,81 @@ static int rangefactor (Unit *unit, int location)
 {
     Map *map; /* pointer to the battle map */
     UnitType *utype; /* the unit's type */
-    int x, /* longitudinal distance */
-	y, /* latitudinal distance */
-	dist, /* calculated distance */
-	size; /* largest dimension of the map */
     map = ai->data->game->battle->map;
     utype = ai->data->game->campaign->unittypes[unit->utype];
-    size = (map->width > map->height) ? map->width : map->height;
-    y = abs (unit->y - (location / map->width));
-    x = abs (unit->x - (location % map->width));
-    dist = ((x > y) ? x : y);
-    return ai->data->maxdist * (dist <= utype->range);
+    return ai->data->maxdist *
+	(map->methods->distance (unit->x, unit->y, location % map->width,
+				 location / map->width, 0) <= utype->range);
+}
+
+/**
+ * Return the worth of one unit firing on another as an importance
+ * factor, from the combat tables: the damage expected as a share of
+ * the enemy's hits and the chance of destroying it, less the return
+ * fire expected as a share of the unit's own hits. The unit fires
+ * from no further than its range, so an enemy of equal or longer
+ * range is assumed able to reply.
+ * @param  unit     The unit firing.
+ * @param  enemy    The enemy unit fired upon.
+ * @param  location The square the unit is on now.
+ * @return          The importance factor 0..maxdist.
+ */
+static int attackfactor (Unit *unit, Unit *enemy, int location)
+{
+    Battle *battle; /* pointer to the battle */
+    Combat *combat; /* the campaign's combat tables */
+    CwgPlanes *planes; /* flat terrain planes */
+    UnitType *utype, /* the unit's type */
+	*etype; /* the enemy's type */
+    long gain, /* damage expected as a factor */
+	kill, /* chance of destroying the enemy as a factor */
+	loss; /* return fire expected as a factor */
+    int elocation, /* the enemy's square */
+	defence, /* the enemy's defence */
+	rdefence, /* the unit's defence against return fire */
+	range; /* the distance the unit fires from */
+
+    /* initialise convenience variables */
+    battle = ai->data->game->battle;
+    combat = ai->data->game->campaign->combat;
+    utype = ai->data->game->campaign->unittypes[unit->utype];
+    etype = ai->data->game->campaign->unittypes[enemy->utype];
+    elocation = enemy->x + battle->map->width * enemy->y;
+    if (! enemy->hits || ! unit->hits)
+	return 0;
+    if (! (planes = battle->methods->getplanes (battle)))
+	fatalerror (FATAL_MEMORY);
+
+    /* look up the damage and the chance of a kill */
+    defence = etype->armour
+	+ planes->defence[enemy->utype * planes->size + elocation];
+    gain = combat->methods->damage
+	(combat, utype->power, defence, battle->levels[battle->side],
+	 enemy->hits)
+	* ai->data->maxdist / ((long) CWG_CERTAIN * enemy->hits);
+    kill = (long) combat->methods->kill
+	(combat, utype->power, defence, battle->levels[battle->side],
+	 enemy->hits)
+	* ai->data->maxdist / CWG_CERTAIN;
+
+    /* look up the return fire, if the enemy can reply */
+    range = battle->map->methods->distance
+	(unit->x, unit->y, enemy->x, enemy->y, 0);
+    if (range > utype->range)
+	range = utype->range;
+    loss = 0;
+    if (enemy->moves && etype->range >= range) {
+	rdefence = utype->armour
+	    + planes->defence[unit->utype * planes->size + location];
+	loss = combat->methods->returnfire
+	    (combat, utype->power, defence, battle->levels[battle->side],
+	     enemy->hits, etype->power, rdefence,
+	     battle->levels[! battle->side], unit->hits)
+	    * ai->data->maxdist / ((long) CWG_CERTAIN * unit->hits);
+    }
+
+    /* return the net worth of the attack */
+    return (int) ((gain + kill + ai->data->maxdist - loss) / 3);
 }
 
 /**
@@ -730,78 +1275,79 @@ static void bestbuildpositions (Agent *agent, int utypeid,
  */
 static int bestattackposition (Agent *agent, Target *target)
 {
+    Battle *battle; /* the battle */
     Map *map; /* the battle map */
     Unit *unit; /* the agent unit */
     UnitType *utype; /* the agent unit type */
-    Terrain *terrain; /* terrain on square being scanned */
-    int x1, /* top left square x coordinate to scan */
-	y1, /* top left square y coordinate to scan */
-	x2, /* bottom right square x coordinate to scan */
-	y2, /* bottom right square y coordinate to scan */
-	x, /* x coordinate being scanned */
+    CwgPlanes *planes; /* flat terrain planes */
+    CwgRings *rings; /* squares around each square */
+    int x, /* x coordinate being scanned */
 	y, /* y coordinate being scanned */
 	dist, /* distance from target of square being scanned */
+	range, /* furthest distance to scan */
 	score, /* score for square being scanned */
 	best, /* best score scanned */
-	bx, /* x coordinate of best square scanned */
-	by, /* y coordinate of best square scanned */
-	tx, /* target's x coordinate */
-	ty; /* target's y coordinate */
+	bestlocation, /* best square scanned */
+	location, /* square being scanned */
+	c; /* counter for squares around the target */
     int pfactor, /* proximity factor */
 	rfactor, /* range factor */
-	afactor; /* armour factor */
+	afactor, /* armour factor */
+	dfactor, /* danger factor */
+	l; /* location in the unit type's planes */
+    unsigned char *reach; /* squares the agent can reach */
 
-    /* get target coordinates */
-    map = ai->data->game->battle->map;
-    tx = target->location % map->width;
-    ty = target->location / map->width;
+    /* find out where the agent can get to this turn */
+    battle = ai->data->game->battle;
+    map = battle->map;
+    unit = battle->units[agent->unit];
+    reach = ai->data->reach;
+    if (! battle->methods->reachable (battle, unit, reach))
+	fatalerror (FATAL_MEMORY);
+    if (! (planes = battle->methods->getplanes (battle)))
+	fatalerror (FATAL_MEMORY);
+    if (! (rings = battle->methods->getrings (battle)))
+	fatalerror (FATAL_MEMORY);
 
-    /* get coordinates to scan */
-    unit = ai->data->game->battle->units[agent->unit];
+    /* get the rings of squares to scan */
     utype = ai->data->game->campaign->unittypes[unit->utype];
-    x1 = tx - utype->range;
-    y1 = ty - utype->range;
-    x2 = tx + utype->range;
-    y2 = ty + utype->range;
-    if (x1 < 0)
-	x1 = 0;
-    if (y1 < 0)
-	y1 = 0;
-    if (x2 >= map->width)
-	x2 = map->width - 1;
-    if (y2 >= map->height)
-	y2 = map->height - 1;
+    range = utype->range < rings->radius ? utype->range : rings->radius;
 
     /* start gathering information about the best square */
     best = 0;
-    bx = tx;
-    by = ty;
-    for (x = x1; x <= x2; ++x)
-	for (y = y1; y <= y2; ++y) {
-	    if (map->units[x + map->width * y] != CWG_NO_UNIT &&
+    bestlocation = target->location;
+    for (c = 0, dist = 0; dist <= range; ++dist)
+	for (; c < rings->ends[dist]; ++c) {
+	    if ((location = ringsquare (rings, target->location, c)) == -1)
+		continue;
+	    x = location % map->width;
+	    y = location / map->width;
+	    if (map->units[location] != CWG_NO_UNIT &&
 		x != unit->x && y != unit->y)
 		continue;
-	    dist = (abs (x - tx) > abs (y - ty))
-		? abs (x - tx)
-		: abs (y - ty);
-	    terrain = ai->data->game->campaign->terrain
-		[map->terrain[x + map->width * y]];
-	    if (! terrain->moves[unit->utype])
+	    if (! reach[location])
+		continue;
+	    l = unit->utype * planes->size + location;
+	    if (! planes->moves[l])
 		continue;
-	    pfactor = proximityfactor
-		(agent->location, x + map->width * y);
+	    pfactor = ai->data->unitcats[unit->utype].mobile
+		? travelfactor (unit->utype, agent->location, location)
+		: proximityfactor (agent->location, location);
 	    rfactor = 2 * dist;
-	    afactor = terrain->defence[unit->utype];
-	    score = pfactor + rfactor + afactor;
-	    if (score > best) {
+	    afactor = planes->defence[l];
+	    dfactor = dangerfactor (unit->utype, location);
+	    score = pfactor + rfactor + afactor
+		+ (ai->data->maxdist - dfactor) / 2;
+	    if (score > best ||
+		(score == best && best > 0 &&
+		 columnorder (location) < columnorder (bestlocation))) {
 		best = score;
-		bx = x;
-		by = y;
+		bestlocation = location;
 	    }
 	}
 
     /* return the best square found */
-    return bx + map->width * by;
+    return bestlocation;
 }
 
 /**
@@ -816,61 +1362,58 @@ static int bestdefenceposition (Agent *agent, Target *target)
     Map *map; /* the battle map */
     Unit *unit; /* the agent unit */
     UnitType *utype; /* the agent unit type */
-    int x1, /* top left square x coordinate to scan */
-	y1, /* top left square y coordinate to scan */
-	x2, /* bottom right square x coordinate to scan */
-	y2, /* bottom right square y coordinate to scan */
-	x, /* x coordinate being scanned */
+    CwgRings *rings; /* squares around each square */
+    int x, /* x coordinate being scanned */
 	y, /* y coordinate being scanned */
+	range, /* furthest distance to scan */
 	score, /* score for square being scanned */
 	best, /* best score scanned */
-	bx, /* x coordinate of best square scanned */
-	by, /* y coordinate of best square scanned */
-	tx, /* target's x coordinate */
-	ty; /* target's y coordinate */
+	bestlocation, /* best square scanned */
+	location, /* square being scanned */
+	ends, /* end of the squares in range of the target */
+	c; /* counter for squares around the target */
+    unsigned char *reach; /* squares the agent can reach */
 
-    /* get target coordinates */
+    /* find out where the agent can get to this turn */
     battle = ai->data->game->battle;
     map = battle->map;
-    tx = target->location % map->width;
-    ty = target->location / map->width;
+    unit = battle->units[agent->unit];
+    reach = ai->data->reach;
+    if (! battle->methods->reachable (battle, unit, reach))
+	fatalerror (FATAL_MEMORY);
+    if (! (rings = battle->methods->getrings (battle)))
+	fatalerror (FATAL_MEMORY);
 
-    /* get coordinates to scan */
-    unit = ai->data->game->battle->units[agent->unit];
+    /* get the squares to scan */
     utype = ai->data->game->campaign->unittypes[unit->utype];
-    x1 = tx - utype->range;
-    y1 = ty - utype->range;
-    x2 = tx + utype->range;
-    y2 = ty + utype->range;
-    if (x1 < 0)
-	x1 = 0;
-    if (y1 < 0)
-	y1 = 0;
-    if (x2 >= map->width)
-	x2 = map->width - 1;
-    if (y2 >= map->height)
-	y2 = map->height - 1;
+    range = utype->range < rings->radius ? utype->range : rings->radius;
+    ends = rings->ends[range];
 
     /* start gathering information about the best square */
     best = 0;
-    bx = tx;
-    by = ty;
-    for (x = x1; x <= x2; ++x)
-	for (y = y1; y <= y2; ++y) {
-	    if (map->units[x + map->width * y] != CWG_NO_UNIT &&
-		x != unit->x && y != unit->y)
-		continue;
-	    score = proximityfactor
-		(ai->data->theircentre, x + map->width * y);
-	    if (score > best) {
-		best = score;
-		bx = x;
-		by = y;
-	    }
+    bestlocation = target->location;
+    for (c = 0; c < ends; ++c) {
+	if ((location = ringsquare (rings, target->location, c)) == -1)
+	    continue;
+	x = location % map->width;
+	y = location / map->width;
+	if (map->units[location] != CWG_NO_UNIT &&
+	    x != unit->x && y != unit->y)
+	    continue;
+	if (! reach[location])
+	    continue;
+	score = proximityfactor (ai->data->theircentre, location)
+	    + (ai->data->maxdist - dangerfactor (unit->utype, location)) / 2;
+	if (score > best ||
+	    (score == best && best > 0 &&
+	     columnorder (location) < columnorder (bestlocation))) {
+	    best = score;
+	    bestlocation = location;
 	}
+    }
 
     /* return the best square found */
-    return bx + map->width * by;
+    return bestlocation;
 }
 
 /**
@@ -890,13 +1433,47 @@ static int distance (Unit *first, Unit *second)
  * Level 2 Private Function Definitions.
  */
 
+/**
+ * Make room for a new target at the end of the target array,
+ * growing the array and its indexes if they are full.
+ * @return A pointer to the new target.
+ */
+static Target *newtarget (void)
+{
+    Target *targets, /* the grown target array */
+	**index, /* the grown target index */
+	**scratch; /* the grown working space */
+    int room; /* the number of targets there will be room for */
+
+    /* grow the arrays if they are full */
+    if (ai->data->targetcount == ai->data->targetroom) {
+	room = ai->data->targetroom
+	    ? 2 * ai->data->targetroom
+	    : TARGETROOM;
+	if (! (targets = realloc (ai->data->targets,
+				  room * sizeof (Target))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->targets = targets;
+	if (! (index = realloc (ai->data->targetindex,
+				room * sizeof (Target *))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->targetindex = index;
+	if (! (scratch = realloc (ai->data->targetscratch,
+				  room * sizeof (Target *))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->targetscratch = scratch;
+	ai->data->targetroom = room;
+    }
+
+    /* return the next free target */
+    return &ai->data->targets[ai->data->targetcount++];
+}
+
 /**
  * Target an enemy-controlled square for attack.
- * @param  targets The linked list of targets.
- * @param  square  The square to target.
- * @return         The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetattack (Target *targets, int square)
+static void targetattack (int square)
 {
     Target *target; /* new target */
     Battle *battle; /* the battle */
@@ -904,8 +1481,7 @@ static Target *targetattack (Target *targets, int square)
     int utypeid; /* unit type ID */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* get information about the target unit */
     battle = ai->data->game->battle;
@@ -929,26 +1505,19 @@ static Target *targetattack (Target *targets, int square)
 	+ utype->range * utype->power
 	+ utype->armour;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
  * Target a resource square for gathering.
- * @param  targets The linked list of targets.
- * @param  square  The square to target.
- * @return         The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetgathering (Target *targets, int square)
+static void targetgathering (int square)
 {
     Target *target; /* new target */
     Game *game; /* pointer to the game */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* target the resource */
     game = ai->data->game;
@@ -960,27 +1529,20 @@ static Target *targetgathering (Target *targets, int square)
     target->utype = ai->data->game->campaign->gatherer;
     target->requirements = 1;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
  * Target a victory point square for occupation.
- * @param targets The linked list of targets.
- * @param square  The square to target.
- * @return        The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetpoint (Target *targets, int square)
+static void targetpoint (int square)
 {
     Target *target; /* new target */
     UnitType **unittypes; /* pointer to unit types */
     int ut; /* unit type counter */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* initialise convenience variables */
     unittypes = ai->data->game->campaign->unittypes;
@@ -997,19 +1559,13 @@ static Target *targetpoint (Target *targets, int square)
 	    target->utype = ut;
     target->requirements = ai->data->maxdist;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
  * Target a damaged friendly unit for repair.
- * @param  targets The linked list of targets.
- * @param  square  The square to target.
- * @return         The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetrepair (Target *targets, int square)
+static void targetrepair (int square)
 {
     Target *target; /* new target */
     Battle *battle; /* the battle */
@@ -1018,8 +1574,7 @@ static Target *targetrepair (Target *targets, int square)
     int utypeid; /* unit type ID */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* get information about the target unit */
     battle = ai->data->game->battle;
@@ -1035,19 +1590,13 @@ static Target *targetrepair (Target *targets, int square)
 	+ proximityfactor (square, ai->data->ourcentre);
     target->requirements = ai->data->maxdist;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
  * Target a friendly repair unit for rallying damaged units.
- * @param  targets The linked list of targets.
- * @param  square  The square to target.
- * @return         The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetrally (Target *targets, int square)
+static void targetrally (int square)
 {
     Target *target; /* new target */
     Battle *battle; /* the battle */
@@ -1056,8 +1605,7 @@ static Target *targetrally (Target *targets, int square)
     int utypeid; /* unit type ID */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* get information about the target unit */
     battle = ai->data->game->battle;
@@ -1072,19 +1620,13 @@ static Target *targetrally (Target *targets, int square)
 	= 2 * proximityfactor (square, ai->data->ourcentre);
     target->requirements = 2;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
  * Target a static non-combatant friendly unit for defence.
- * @param  targets The linked list of targets.
- * @param  square  The square to target.
- * @return         The updated linked list of targets.
+ * @param square The square to target.
  */
-static Target *targetdefence (Target *targets, int square)
+static void targetdefence (int square)
 {
     Target *target; /* new target */
     Battle *battle; /* the battle */
@@ -1094,8 +1636,7 @@ static Target *targetdefence (Target *targets, int square)
 	ut; /* unit type counter */
 
     /* create new target */
-    if (! (target = malloc (sizeof (Target))))
-	fatalerror (FATAL_MEMORY);
+    target = newtarget ();
 
     /* get information about the target unit */
     unittypes = ai->data->game->campaign->unittypes;
@@ -1112,84 +1653,66 @@ static Target *targetdefence (Target *targets, int square)
 	+ pointfactor (square);
     target->importance /= 3;
     target->importance
-	+= proximityfactor (square, ai->data->theircentre);
+	+= proximityfactor (square, ai->data->theircentre)
+	+ controlfactor (square) / 2;
     target->utype = 0;
     for (ut = 0; ut < CWG_UTYPES; ++ut)
 	if (unittypes[ut]->power > unittypes[target->utype]->power)
 	    target->utype = ut;
     target->requirements = 1;
     target->allocation = 0;
-    target->next = targets;
-
-    /* return the updated target list */
-    return target;
 }
 
 /**
- * Sort the targets by descending order of importance.
- * @param  targets The linked list of targets to sort.
- * @return         The sorted linked list of targets.
+ * Sort an index of targets by descending importance. This is a
+ * merge sort, so targets of equal importance keep their order.
+ * @param count The number of targets.
+ * @param index The index of targets.
  */
-static Target *sorttargets (Target *targets)
+static void sorttargets (int count, Target **index)
 {
-    Target *prev, /* previous node */
-	*curr, /* current node */
-	*next; /* next node */
-    int sorted = 0; /* 1 when sorted */
-
-    /* main sorting loop */
-    do {
-
-	/* initialise iteration */
-	sorted = 1;
-	curr = targets;
-	prev = NULL;
-
-	/* compare each consecutive list pair */
-	while (curr && curr->next) {
-	    next = curr->next;
-
-	    /* compare and swap if necessary */
-	    if (curr->importance < next->importance) {
-		curr->next = next->next;
-		next->next = curr;
-		if (prev)
-		    prev->next = next;
-		else
-		    targets = next;
-		sorted = 0;
-	    }
-
-	    /* move to next list pair */
-	    prev = curr;
-	    curr = curr->next;
-	}
-    } while (! sorted);
-
-    /* return the sorted list */
-    return targets;
+    Target **scratch; /* working space for merging */
+    int half, /* number of targets in the first half */
+	a, /* position in the first half */
+	b, /* position in the second half */
+	i; /* position in the merged index */
+
+    /* sort each half of the index */
+    if (count < 2)
+	return;
+    half = count / 2;
+    sorttargets (half, index);
+    sorttargets (count - half, index + half);
+
+    /* merge the halves, taking from the first on a tie */
+    scratch = ai->data->targetscratch;
+    for (a = 0, b = half, i = 0; i < count; ++i)
+	if (b == count ||
+	    (a < half && index[a]->importance >= index[b]->importance))
+	    scratch[i] = index[a++];
+	else
+	    scratch[i] = index[b++];
+    memcpy (index, scratch, count * sizeof (Target *));
 }
 
 /**
- * Get a list of potential agents.
- * @return A linked list of agents.
+ * Get the list of potential agents, from the last square of the map
+ * to the first.
  */
-static Agent *getagents (void)
+static void getagents (void)
 {
-    Agent *agents = NULL, /* the list of agents to return */
-	*agent; /* an agent to add to the list */
+    Agent *agent; /* an agent to add to the list */
     Battle *battle; /* pointer to the battle */
     Map *map; /* pointer to the battle map */
     Unit *unit; /* pointer to a unit on the map */
-    int s, /* map square counter */
-	count = 0; /* agent counter */
+    int s; /* map square counter */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     map = battle->map;
 
     /* look at all of the squares on the map */
-    for (s = 0; s < map->width * map->height; ++s) {
+    for (s = map->width * map->height - 1; s >= 0; --s) {
 
 	/* identify any unit on the map */
 	unit = (map->units[s] == CWG_NO_UNIT)
@@ -1198,46 +1721,37 @@ static Agent *getagents (void)
 
 	/* if a friendly unit, add it to the agent list */
 	if (unit && unit->side == battle->side) {
-	    if (! (agent = malloc (sizeof (Agent))))
-		fatalerror (FATAL_MEMORY);
-	    agent->count = ++count;
+	    agent = &ai->data->agents[ai->data->agentcount++];
 	    agent->unit = map->units[s];
 	    agent->location = s;
 	    agent->suitability = 0;
 	    agent->building = 0;
 	    agent->target = NULL;
-	    agent->next = agents;
-	    agents = agent;
 	}
     }
-
-    /* return the agent list */
-    return agents;
 }
 
 /**
- * Allocate an attacker to an attack target.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the agents as attackers of an enemy unit.
+ * @param target A pointer to the target.
  */
-static Target *allocateattacker (Target *target, Agent *agents)
+static void scoreattackers (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
-    Unit *unit; /* pointer to current unit */
+    Unit *unit, /* pointer to current unit */
+	*enemy; /* pointer to the enemy unit targeted */
     UnitCategory *unitcats; /* pointer to unit category data */
-    UnitType *utype; /* pointer to current unit's type */
-    int i; /* counter for index */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
+    last = ai->data->agents + ai->data->agentcount;
+    enemy = battle->units[battle->map->units[target->location]];
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next)
+    for (agent = ai->data->agents; agent < last; ++agent)
 
 	/* agent already has a target - skip it */
 	if (agent->target)
@@ -1254,10 +1768,10 @@ static Target *allocateattacker (Target *target, Agent *agents)
 		agent->building = 1;
 	    }
 
-	    /* score firepower for combatants */
+	    /* score the worth of the attack for combatants */
 	    else {
 		agent->suitability
-		    = powerfactor (unit->utype)
+		    = attackfactor (unit, enemy, agent->location)
 		    + ai->data->maxdist - damagefactor (unit);
 		agent->suitability /= 2;
 		agent->building = 0;
@@ -1278,54 +1792,31 @@ static Target *allocateattacker (Target *target, Agent *agents)
 	    else if (! unitcats[unit->utype].builder)
 		agent->suitability = 0;
 	}
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count &&
-	     index[i]->suitability &&
-	     target->allocation < target->requirements;
-	 ++i) {
-	index[i]->target = target;
-	unit = battle->units[index[i]->unit];
-	utype = ai->data->game->campaign->unittypes[unit->utype];
-	target->allocation
-	    += utype->power * utype->range;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
- * Allocate a gatherer to a resource unit.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the agents as gatherers of a resource.
+ * @param target A pointer to the target.
  */
-static Target *allocategatherer (Target *target, Agent *agents)
+static void scoregatherers (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
     Unit *unit; /* pointer to current unit */
     UnitType *utype; /* pointer to the current unit's type */
     UnitCategory *unitcats; /* pointer to unit category data */
     Terrain *terrain; /* terrain of target square */
-    int i; /* counter for index */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
+    last = ai->data->agents + ai->data->agentcount;
     terrain = ai->data->game->campaign->terrain
 	[battle->map->terrain[target->location]];
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next) {
+    for (agent = ai->data->agents; agent < last; ++agent) {
 
 	/* get agent unit information */
 	unit = battle->units[agent->unit];
@@ -1360,50 +1851,30 @@ static Target *allocategatherer (Target *target, Agent *agents)
 	}
 
     }
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count &&
-	     index[i]->suitability &&
-	     target->allocation < target->requirements;
-	 ++i) {
-	index[i]->target = target;
-	target->allocation = 1;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
- * Allocate an occupier to a victory point.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the agents as occupiers of a victory point.
+ * @param target A pointer to the target.
  */
-static Target *allocateoccupier (Target *target, Agent *agents)
+static void scoreoccupiers (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
     Unit *unit; /* pointer to current unit */
     UnitCategory *unitcats; /* pointer to unit category data */
     Terrain *terrain; /* terrain of target square */
-    int i; /* counter for index */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
+    last = ai->data->agents + ai->data->agentcount;
     terrain = ai->data->game->campaign->terrain
 	[battle->map->terrain[target->location]];
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next)
+    for (agent = ai->data->agents; agent < last; ++agent)
 
 	/* agent already has a target - skip it */
 	if (agent->target)
@@ -1439,35 +1910,16 @@ static Target *allocateoccupier (Target *target, Agent *agents)
 		agent->suitability = 0;
 
 	}
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count &&
-	     index[i]->suitability &&
-	     target->allocation < target->requirements;
-	 ++i) {
-	index[i]->target = target;
-	target->allocation = target->requirements;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
- * Allocate a repair unit to a damaged colleague.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the agents as repairers of a damaged colleague.
+ * @param target A pointer to the target.
  */
-static Target *allocaterepairer (Target *target, Agent *agents)
+static void scorerepairers (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
     Unit *unit, /* pointer to current unit */
 	*targetunit; /* pointer to the target unit */
@@ -1475,19 +1927,18 @@ static Target *allocaterepairer (Target *target, Agent *agents)
 	*btype; /* pointer to a potential repairer's unit type */
     UnitCategory *unitcats; /* pointer to unit category data */
     Terrain *terrain; /* terrain of target square */
-    int i, /* counter for index */
-	u; /* counter for potential repairer unit types */
+    int u; /* counter for potential repairer unit types */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
+    last = ai->data->agents + ai->data->agentcount;
     terrain = ai->data->game->campaign->terrain
 	[battle->map->terrain[target->location]];
     targetunit = battle->units[battle->map->units[target->location]];
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next) {
+    for (agent = ai->data->agents; agent < last; ++agent) {
 
 	/* get agent unit information */
 	unit = battle->units[agent->unit];
@@ -1529,35 +1980,16 @@ static Target *allocaterepairer (Target *target, Agent *agents)
 	    }
 	}
     }
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count &&
-	     index[i]->suitability &&
-	     target->allocation < target->requirements;
-	 ++i) {
-	index[i]->target = target;
-	target->allocation = 1;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
- * Allocate a damaged unit to a repair unit.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the damaged agents for rallying to a repair unit.
+ * @param target A pointer to the target.
  */
-static Target *allocatedamagedunit (Target *target, Agent *agents)
+static void scoredamagedunits (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
     Unit *unit, /* pointer to current unit */
 	*targetunit; /* pointer to the target unit */
@@ -1565,24 +1997,26 @@ static Target *allocatedamagedunit (Target *target, Agent *agents)
 	*targettype; /* pointer to target's unit type */
     UnitCategory *unitcats; /* pointer to unit category data */
     Terrain *terrain; /* terrain of target square */
-    int i; /* counter for index */
 
     /* don't repair if we have no resources */
     battle = ai->data->game->battle;
+    last = ai->data->agents + ai->data->agentcount;
     if (battle->resources[battle->side] == 0 ||
-	ai->data->gatherers == 0)
-	return target->next;
+	ai->data->gatherers == 0) {
+	for (agent = ai->data->agents; agent < last; ++agent)
+	    agent->suitability = 0;
+	return;
+    }
 
     /* initialise convenience variables */
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
     terrain = ai->data->game->campaign->terrain
 	[battle->map->terrain[target->location]];
     targetunit = battle->units[battle->map->units[target->location]];
     targettype = ai->data->game->campaign->unittypes[targetunit->utype];
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next) {
+    for (agent = ai->data->agents; agent < last; ++agent) {
 
 	/* get agent unit information */
 	unit = battle->units[agent->unit];
@@ -1616,47 +2050,27 @@ static Target *allocatedamagedunit (Target *target, Agent *agents)
 	    agent->building = 0;
 	}
     }
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count && index[i]->suitability;
-	 ++i) {
-	unit = battle->units[index[i]->unit];
-	index[i]->target = target;
-	++target->allocation;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
- * Allocate a defender to a vulnerable unit.
- * @param  target A pointer to the attack target in a linked list.
- * @param  agents A pointer to the linked list of agents.
- * @return        A pointer to the target to allocate against next.
+ * Score the agents as defenders of a vulnerable unit.
+ * @param target A pointer to the target.
  */
-static Target *allocatedefender (Target *target, Agent *agents)
+static void scoredefenders (Target *target)
 {
     Agent *agent, /* pointer to current agent */
-	**index; /* index of agents */
+	*last; /* pointer past the last agent */
     Battle *battle; /* pointer to the battle */
     Unit *unit; /* pointer to current unit */
     UnitCategory *unitcats; /* pointer to unit category data */
-    UnitType *utype; /* pointer to current unit's type */
-    int i; /* counter for index */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unitcats = ai->data->unitcats;
-    index = indexagents (agents);
+    last = ai->data->agents + ai->data->agentcount;
 
     /* score all the agents for suitability */
-    for (agent = agents; agent; agent = agent->next)
+    for (agent = ai->data->agents; agent < last; ++agent)
 
 	/* agent already has a target - skip it */
 	if (agent->target)
@@ -1701,25 +2115,6 @@ static Target *allocatedefender (Target *target, Agent *agents)
 	    else if (! unitcats[unit->utype].builder)
 		agent->suitability = 0;
 	}
-
-    /* rank agents according to suitability */
-    sortagents (agents->count, index);
-
-    /* allocate agents */
-    for (i = 0;
-	 i < agents->count &&
-	     index[i]->suitability &&
-	     target->allocation < target->requirements;
-	 ++i) {
-	index[i]->target = target;
-	unit = battle->units[index[i]->unit];
-	utype = ai->data->game->campaign->unittypes[unit->utype];
-	++target->allocation;
-    }
-
-    /* next target */
-    free (index);
-    return target->next;
 }
 
 /**
@@ -1756,8 +2151,8 @@ static void buildaction (Agent *agent)
     /* attempt to build the unit */
     initreport ();
     unit = battle->units[agent->unit];
-    battle->move (battle, unit, fpx, fpy, movehook);
-    battle->create (battle, unit, utypeid, bpx, bpy, buildhook);
+    battle->methods->move (battle, unit, fpx, fpy, movehook);
+    battle->methods->create (battle, unit, utypeid, bpx, bpy, buildhook);
 }
 
 /**
@@ -1783,8 +2178,8 @@ static void attackaction (Agent *agent)
     initreport ();
     unit = battle->units[agent->unit];
     target = battle->units[battle->map->units[agent->target->location]];
-    battle->move (battle, unit, apx, apy, movehook);
-    battle->attack (battle, unit, target, attackhook);
+    battle->methods->move (battle, unit, apx, apy, movehook);
+    battle->methods->attack (battle, unit, target, attackhook);
 }
 
 /**
@@ -1806,7 +2201,7 @@ static void gatheringaction (Agent *agent)
     /* move to resource location */
     initreport ();
     unit = battle->units[agent->unit];
-    battle->move (battle, unit, x, y, movehook);
+    battle->methods->move (battle, unit, x, y, movehook);
 }
 
 /**
@@ -1828,7 +2223,7 @@ static void occupationaction (Agent *agent)
     /* move to occupation location */
     initreport ();
     unit = battle->units[agent->unit];
-    battle->move (battle, unit, x, y, movehook);
+    battle->methods->move (battle, unit, x, y, movehook);
 }
 
 /**
@@ -1850,9 +2245,9 @@ static void repairaction (Agent *agent)
     /* move towards target unit */
     initreport ();
     if (distance (agentunit, targetunit) > 1)
-	battle->move (battle, agentunit, targetunit->x, targetunit->y,
-		      movehook);
-    battle->restore (battle, agentunit, targetunit, repairhook);
+	battle->methods->move (battle, agentunit, targetunit->x, targetunit->y,
+			       movehook);
+    battle->methods->restore (battle, agentunit, targetunit, repairhook);
 }
 
 /**
@@ -1874,8 +2269,8 @@ static void rallyaction (Agent *agent)
     /* move towards target unit */
     initreport ();
     if (distance (agentunit, targetunit) > 1)
-	battle->move (battle, agentunit, targetunit->x, targetunit->y,
-		      movehook);
+	battle->methods->move (battle, agentunit, targetunit->x, targetunit->y,
+			       movehook);
 }
 
 /**
@@ -1901,26 +2296,28 @@ static void defenceaction (Agent *agent)
     initreport ();
     unit = battle->units[agent->unit];
     target = battle->units[battle->map->units[agent->target->location]];
-    battle->move (battle, unit, apx, apy, movehook);
+    battle->methods->move (battle, unit, apx, apy, movehook);
 }
 
 /**
  * Repair any adjacent unit that is damaged.
  * @param agent The agent to act.
  */
-static void opportunityrepair (Agent *agent, Target *targets)
+static void opportunityrepair (Agent *agent)
 {
     Battle *battle; /* pointer to the battle */
     Unit *agentunit, /* the agent unit */
 	*targetunit; /* the target unit */
     Target *target; /* pointer to target under examination */
+    int t; /* target counter */
     battle = ai->data->game->battle;
     agentunit = battle->units[agent->unit];
-    for (target = targets; target; target = target->next)
-	if (target->type == TARGET_REPAIR) {
+    for (t = 0; t < ai->data->targetcount; ++t)
+	if ((target = ai->data->targetindex[t])->type == TARGET_REPAIR) {
 	    targetunit
 		= battle->units[battle->map->units[target->location]];
-	    battle->restore (battle, agentunit, targetunit, repairhook);
+	    battle->methods->restore (battle, agentunit, targetunit,
+				      repairhook);
 	}
 }
 
@@ -1931,10 +2328,17 @@ static void opportunityrepair (Agent *agent, Target *targets)
 static void opportunityfire (Agent *agent)
 {
     Battle *battle; /* pointer to the battle object */
-    Unit *aunit, /* pointer to the agent unit */
-	*tunit; /* pointer to the target unit */
+    Unit *aunit; /* pointer to the agent unit */
     UnitType *atype; /* pointer to agent unit's type */
-    int u; /* unit counter */
+    CwgBoards *boards; /* bitboards of the map */
+    CwgRoster *roster; /* the units' fields */
+    CwgBoard inrange; /* squares of enemies in range */
+    int u, /* unit counter */
+	w, /* bitboard word counter */
+	location, /* location of a target unit */
+	value, /* worth of attacking a target unit */
+	best, /* worth of the best target so far */
+	chosen; /* the best target unit so far */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
@@ -1945,29 +2349,52 @@ static void opportunityfire (Agent *agent)
     if (! aunit->hits || ! aunit->moves)
 	return;
 
-    /* look for a target */
-    for (u = 0; u < CWG_UNITS; ++u)
-	if ((tunit = ai->data->game->battle->units[u]) &&
-	    tunit->hits &&
-	    tunit->side != battle->side &&
-	    distance (aunit, tunit) <= atype->range)
-	{
-	    initreport ();
-	    battle->attack (battle, aunit, tunit, attackhook);
+    /* find the enemies within range */
+    if (! (boards = battle->methods->getboards (battle)))
+	fatalerror (FATAL_MEMORY);
+    battle->methods->surround (battle, &inrange,
+			       aunit->x + battle->map->width * aunit->y,
+			       atype->range);
+    for (w = 0; w < CWG_BOARDWORDS; ++w)
+	inrange.bits[w] &= boards->sides[! battle->side].bits[w];
+
+    /* look for the target most worth attacking */
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
+    chosen = -1;
+    best = -1;
+    for (u = 0; u < battle->unitcap; ++u)
+	if (((roster->alive[u / 32] >> (u % 32)) & 1) &&
+	    roster->side[u] != battle->side) {
+	    location = roster->x[u] + battle->map->width * roster->y[u];
+	    if (((inrange.bits[location / 32] >> (location % 32)) & 1) &&
+		(value = attackfactor (aunit, battle->units[u],
+				       aunit->x + battle->map->width
+				       * aunit->y)) > best) {
+		best = value;
+		chosen = u;
+	    }
 	}
+
+    /* attack it */
+    if (chosen != -1) {
+	initreport ();
+	battle->methods->attack (battle, aunit, battle->units[chosen],
+				 attackhook);
+    }
 }
 
 /**
  * Target the nearest enemy for attack.
- * @param agent   The agent to act.
- * @param targets A list of targets.
+ * @param agent The agent to act.
  */
-static void opportunitytarget (Agent *agent, Target *targets)
+static void opportunitytarget (Agent *agent)
 {
     Target *target, /* pointer to target */
 	*nearest; /* pointer to nearest target */
     int best = 0,
-	score; /* distance to nearest target */
+	score, /* distance to nearest target */
+	t; /* target counter */
     Unit *unit; /* pointer to the target unit */
     Battle *battle; /* pointer to the battle */
 
@@ -1975,7 +2402,8 @@ static void opportunitytarget (Agent *agent, Target *targets)
     battle = ai->data->game->battle;
 
     /* find the nearest enemy */
-    for (target = targets; target; target = target->next) {
+    for (t = 0; t < ai->data->targetcount; ++t) {
+	target = ai->data->targetindex[t];
 	if (target->type != TARGET_ATTACK)
 	    continue;
 	unit = battle->units[battle->map->units[target->location]];
@@ -2056,18 +2484,21 @@ static int maxpower (void)
     Battle *battle; /* pointer to battle */
     UnitType *utype, /* pointer to a unit's type */
 	**unittypes; /* pointer to the campaign's unit type list */
+    CwgRoster *roster; /* the units' fields */
     int u, /* unit counter */
 	max; /* accumulated maximum */
 
     /* initialise convenience variables */
     battle = ai->data->game->battle;
     unittypes = ai->data->game->campaign->unittypes;
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
 
     /* find the most powerful unit on the battlefield ... */
     max = 0;
-    for (u = 0; u < CWG_UNITS; ++u)
-	if (battle->units[u] &&
-	    (utype = unittypes[battle->units[u]->utype]) &&
+    for (u = 0; u < battle->unitcap; ++u)
+	if (! ((battle->freeslots[u / 32] >> (u % 32)) & 1) &&
+	    (utype = unittypes[roster->utype[u]]) &&
 	    utype->hits &&
 	    utype->power * utype->range > max)
 	    max = utype->power * utype->range;
@@ -2083,13 +2514,16 @@ static int maxpower (void)
 static int countgatherers (void)
 {
     int u; /* unit counter */
-    Unit *unit; /* pointer to a unit in the battle */
+    Battle *battle; /* pointer to the battle */
+    CwgRoster *roster; /* the units' fields */
+    battle = ai->data->game->battle;
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
     ai->data->gatherers = 0;
-    for (u = 0; u < CWG_UNITS; ++u)
-	if ((unit = ai->data->game->battle->units[u]) &&
-	    unit->side == ai->data->game->battle->side &&
-	    unit->hits &&
-	    ai->data->unitcats[unit->utype].gatherer)
+    for (u = 0; u < battle->unitcap; ++u)
+	if (((roster->alive[u / 32] >> (u % 32)) & 1) &&
+	    roster->side[u] == battle->side &&
+	    ai->data->unitcats[roster->utype[u]].gatherer)
 	    ++ai->data->gatherers;
     return ai->data->gatherers;
 }
@@ -2121,20 +2555,64 @@ static int checkpoints (void)
 }
 
 /**
- * Determine targets
- * @return A linked list of targets.
+ * Map the influence of both sides over the squares of the map.
+ */
+static void mapinfluence (void)
+{
+    Battle *battle; /* pointer to the battle */
+    Influence *influence; /* the grown influence array */
+    unsigned int *marks; /* the grown mark array */
+    unsigned char *reach; /* the grown reach array */
+    CwgRoster *roster; /* the units' fields */
+    int squares, /* number of squares on the map */
+	u; /* unit counter */
+
+    /* make room for every square on the map */
+    battle = ai->data->game->battle;
+    squares = battle->map->width * battle->map->height;
+    if (squares > ai->data->influenceroom) {
+	if (! (influence = realloc (ai->data->influence,
+				    squares * sizeof (Influence))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->influence = influence;
+	if (! (marks = realloc (ai->data->marks,
+				squares * sizeof (unsigned int))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->marks = marks;
+	if (! (reach = realloc (ai->data->reach, squares)))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->reach = reach;
+	ai->data->influenceroom = squares;
+    }
+    memset (ai->data->influence, 0, squares * sizeof (Influence));
+    memset (ai->data->marks, 0, squares * sizeof (unsigned int));
+    ai->data->stamp = 0;
+
+    /* spread the influence of every live unit */
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
+    for (u = 0; u < battle->unitcap; ++u)
+	if ((roster->alive[u / 32] >> (u % 32)) & 1)
+	    spreadinfluence (battle->units[u], roster->x[u]
+			     + battle->map->width * roster->y[u], 1);
+}
+
+/**
+ * Determine targets, and index them in order of importance.
  */
-static Target *gettargets (void)
+static void gettargets (void)
 {
-    Target *targets = NULL; /* the list of targets to return */
     UnitCategory *unitcats; /* pointer to unit category array */
     Campaign *campaign; /* pointer to campaign object */
     Battle *battle; /* pointer to the battle */
     Map *map; /* pointer to the battle map */
     Unit *unit; /* pointer to a unit on the map */
     UnitType *utype; /* pointer to unit's type */
-    Terrain *terrain; /* pointer to terrain definition */
-    int s; /* map square counter */
+    CwgBoards *boards; /* bitboards of the map */
+    CwgBoard interesting; /* squares that might be targets */
+    int s, /* map square counter */
+	w, /* bitboard word counter */
+	t; /* target counter */
 
     /* initialise convenience variables */
     unitcats = ai->data->unitcats;
@@ -2142,16 +2620,30 @@ static Target *gettargets (void)
     battle = ai->data->game->battle;
     map = battle->map;
 
-    /* look at all of the squares on the map */
-    for (s = 0; s < map->width * map->height; ++s) {
+    /* only squares with units, resources or victory points matter */
+    if (! (boards = battle->methods->getboards (battle)))
+	fatalerror (FATAL_MEMORY);
+    for (w = 0; w < CWG_BOARDWORDS; ++w) {
+	interesting.bits[w] = boards->sides[0].bits[w] |
+	    boards->sides[1].bits[w];
+	if (campaign->resource >= 0 && campaign->resource < CWG_TERRAIN)
+	    interesting.bits[w] |=
+		boards->terrain[campaign->resource].bits[w];
+	if (ai->data->points)
+	    interesting.bits[w] |= boards->points.bits[w];
+    }
+
+    /* look at each of those squares */
+    for (s = battle->methods->nextsquare (&interesting, 0);
+	 s != -1;
+	 s = battle->methods->nextsquare (&interesting, s + 1)) {
 
 	/* prompt */
 	ai->data->prompthook
 	    ("Identifying targets",
-	     100 * s / (map->width * map->height - 1));
+	     (int) (100L * s / (map->width * map->height - 1)));
 
-	/* identify terrain and unit */
-	terrain = campaign->terrain[map->terrain[s]];
+	/* identify unit */
 	unit = (map->units[s] == CWG_NO_UNIT)
 	    ? NULL
 	    : battle->units[map->units[s]];
@@ -2161,25 +2653,25 @@ static Target *gettargets (void)
 
 	/* is this an enemy? */
 	if (unit && unit->side != battle->side)
-	    targets = targetattack (targets, s);
+	    targetattack (s);
 
 	/* is this a resource square? */
 	if (map->terrain[s] == campaign->resource)
-	    targets = targetgathering (targets, s);
+	    targetgathering (s);
 
 	/* is this a victory point? */
 	if (map->points[s] && ai->data->points)
-	    targets = targetpoint (targets, s);
+	    targetpoint (s);
 
 	/* is this a damaged friendly unit? */
 	if (unit && unit->side == battle->side &&
 	    unit->hits < utype->hits)
-	    targets = targetrepair (targets, s);
+	    targetrepair (s);
 
 	/* is this a friendly builder? */
 	if (unit && unit->side == battle->side &&
 	    unitcats[unit->utype].builder)
-	    targets = targetrally (targets, s);
+	    targetrally (s);
 
 	/* is this a friendly unit that requires defence? */
 	if (unit && unit->side == battle->side &&
@@ -2187,66 +2679,76 @@ static Target *gettargets (void)
 	     ! unitcats[unit->utype].mobile) ||
 	    map->terrain[s] == campaign->resource ||
 	    map->points[s]))
-	    targets = targetdefence (targets, s);
+	    targetdefence (s);
 
     }
 
-    /* sort and return the list of targets */
-    targets = sorttargets (targets);
+    /* index the targets, the last found first among equals */
+    for (t = 0; t < ai->data->targetcount; ++t)
+	ai->data->targetindex[t]
+	    = &ai->data->targets[ai->data->targetcount - 1 - t];
+    sorttargets (ai->data->targetcount, ai->data->targetindex);
     ai->data->loghook ("Targets identified.");
-    return targets;
 }
 
 /**
- * Allocate agents to targets
- * @param  target Pointer into a linked list of identified targets
- * @return        A linked list of agents.
+ * Allocate agents to targets. The agents are scored for each target
+ * in order of importance, and each target takes its pick in turn.
  */
-static Agent *allocate (Target *target)
+static void allocate (void)
 {
-    Agent *agents = NULL; /* linked list of agents */
+    Target *target; /* pointer to the target to allocate against */
+    Agent **index; /* index of agents */
+    int t; /* target counter */
 
-    /* find and count the agents */
-    agents = getagents ();
+    /* find the agents */
+    getagents ();
 
     /* loop through targets */
-    while (target) {
+    for (t = 0; t < ai->data->targetcount; ++t) {
 	ai->data->prompthook ("Issuing orders", 0);
+	target = ai->data->targetindex[t];
+
+	/* score the agents for the target */
 	switch (target->type) {
 	case TARGET_ATTACK:
-	    target = allocateattacker (target, agents);
+	    scoreattackers (target);
 	    break;
 	case TARGET_GATHERING:
-	    target = allocategatherer (target, agents);
+	    scoregatherers (target);
 	    break;
 	case TARGET_OCCUPATION:
-	    target = allocateoccupier (target, agents);
+	    scoreoccupiers (target);
 	    break;
 	case TARGET_REPAIR:
-	    target = allocaterepairer (target, agents);
+	    scorerepairers (target);
 	    break;
 	case TARGET_RALLY:
-	    target = allocatedamagedunit (target, agents);
+	    scoredamagedunits (target);
 	    break;
 	case TARGET_DEFENCE:
-	    target = allocatedefender (target, agents);
+	    scoredefenders (target);
 	    break;
 	}
+
+	/* give the target the most suitable agents */
+	index = indexagents ();
+	sortagents (ai->data->agentcount, index);
+	takeagents (target, index);
     }
 
-    /* return the agent list */
+    /* report completion */
     ai->data->loghook ("Orders issued");
-    return agents;
 }
 
 /**
  * Take action with agents
- * @param agents A linked list of allocated agents.
  */
-static void action (Agent *agents, Target *targets)
+static void action (void)
 {
     Agent **index, /* index of agents */
-	*agent; /* pointer to an individual agent */
+	*agent, /* pointer to an individual agent */
+	*last; /* pointer past the last agent */
     Unit *unit, /* the agent unit */
 	*tunit; /* the target unit */
     UnitType *utype; /* pointer to agent unit type */
@@ -2261,24 +2763,25 @@ static void action (Agent *agents, Target *targets)
     battle = ai->data->game->battle;
     
     /* index agents and set suitability by proximity to target */
-    index = indexagents (agents);
-    for (agent = agents; agent; agent = agent->next)
+    index = indexagents ();
+    last = ai->data->agents + ai->data->agentcount;
+    for (agent = ai->data->agents; agent < last; ++agent)
 	if (agent->target)
 	    agent->suitability
 		= proximityfactor (agent->location,
 				   ai->data->theircentre);
 	else
 	    agent->suitability = 0;
-    sortagents (agents->count, index);
+    sortagents (ai->data->agentcount, index);
 
     /* process agent actions in order of proximity to enemy */
-    for (i = 0; agents && i < agents->count; ++i) {
+    for (i = 0; i < ai->data->agentcount; ++i) {
 
 	/* display progress */
 	ai->data->prompthook
 	    ("Mobilising units",
-	     agents->count - 1
-	     ? i * 100 / (agents->count - 1)
+	     ai->data->agentcount - 1
+	     ? i * 100 / (ai->data->agentcount - 1)
 	     : 100);
 
 	/* try to build unit to act against target */
@@ -2305,17 +2808,17 @@ static void action (Agent *agents, Target *targets)
     }
 
     /* opportunity actions for agents with movement remaining */
-    for (agent = agents; agent; agent = agent->next) {
+    for (agent = ai->data->agents; agent < last; ++agent) {
 	if (! (unit = battle->units[agent->unit]))
 	    continue;
 	if (! unit->moves)
 	    continue;
-	opportunityrepair (agent, targets);
+	opportunityrepair (agent);
 	opportunityfire (agent);
     }
 
     /* pursuit for agents that haven't moved at all */
-    for (agent = agents; agent; agent = agent->next) {
+    for (agent = ai->data->agents; agent < last; ++agent) {
 
 	/* skip nonexistent or dead agents */
 	if (! (unit = battle->units[agent->unit]))
@@ -2340,7 +2843,7 @@ static void action (Agent *agents, Target *targets)
 	    stay = 1;
 
 	/* agents guarding resources may build but not pursue */
-	opportunitytarget (agent, targets);
+	opportunitytarget (agent);
 	buildaction (agent);
 	if (stay ||
 	    pointfactor (agent->location) ||
@@ -2350,38 +2853,663 @@ static void action (Agent *agents, Target *targets)
 
     }
 
-    /* clean up */
+    /* report completion */
     ai->data->loghook ("Units mobilised");
-    free (index);
 }
 
 /**
- * Destroy the targets when finished playing a turn.
- * @param targets The linked list of targets to destroy.
+ * Empty the target and agent lists when finished playing a turn.
+ * Their arrays are kept for the next turn.
+ */
+static void clearlists (void)
+{
+    ai->data->targetcount = 0;
+    ai->data->agentcount = 0;
+}
+
+/*----------------------------------------------------------------------
+ * Tree Search Function Definitions.
+ */
+
+/**
+ * Ignore the planner's progress prompts during a rollout.
+ * @param message The prompt message.
+ * @param percent The progress made.
+ */
+static void quietprompt (char *message, int percent)
+{
+}
+
+/**
+ * Ignore the planner's log messages during a rollout.
+ * @param message The log message.
+ */
+static void quietlog (char *message)
+{
+}
+
+/**
+ * Note the time now.
+ * @param moment The moment to fill in.
+ */
+static void clocktime (Moment *moment)
+{
+#ifdef __unix__
+    clock_gettime (CLOCK_MONOTONIC, moment);
+#else
+    ftime (moment);
+#endif
+}
+
+/**
+ * Return the milliseconds elapsed since a given time.
+ * @param  start The time to measure from.
+ * @return       The milliseconds elapsed.
  */
-static void destroytargets (Target *targets)
+static long elapsed (Moment *start)
 {
-    Target *target; /* pointer to current target */
-    while (targets) {
-	target = targets->next;
-	free (targets);
-	targets = target;
+    Moment now; /* the time now */
+    clocktime (&now);
+#ifdef __unix__
+    return 1000L * (now.tv_sec - start->tv_sec)
+	+ (now.tv_nsec - start->tv_nsec) / 1000000L;
+#else
+    return 1000L * (now.time - start->time)
+	+ now.millitm - start->millitm;
+#endif
+}
+
+/**
+ * Return the square root of a number, rounded down.
+ * @param  number The number, which must be below 2^30.
+ * @return        The square root.
+ */
+static long squareroot (long number)
+{
+    long root, /* the root found so far */
+	bit; /* the bit of the root being tried */
+    root = 0;
+    for (bit = 1L << 14; bit; bit >>= 1)
+	if ((root + bit) * (root + bit) <= number)
+	    root += bit;
+    return root;
+}
+
+/**
+ * Return the base 2 logarithm of a number, rounded down.
+ * @param  number The number.
+ * @return        The logarithm, or 0 for numbers below 2.
+ */
+static int logtwo (long number)
+{
+    int bits; /* the bits counted */
+    for (bits = 0; number > 1; number >>= 1)
+	++bits;
+    return bits;
+}
+
+/**
+ * Return the difficulty level of a side's gunnery, from its player
+ * type. A tree search player fires as well as a hard one.
+ * @param  side The side.
+ * @return      The difficulty level.
+ */
+static int playerlevel (int side)
+{
+    int type; /* the side's player type */
+    type = ai->data->game->playertypes[side];
+    if (type == PLAYER_SEARCH)
+	return PLAYER_HARD - PLAYER_COMPUTER;
+    else if (type >= PLAYER_COMPUTER && type <= PLAYER_HARD)
+	return type - PLAYER_COMPUTER;
+    else
+	return 0;
+}
+
+/**
+ * Set the difficulty levels for the side to move and its enemy.
+ */
+static void setlevels (void)
+{
+    Battle *battle; /* pointer to the battle */
+    battle = ai->data->game->battle;
+    battle->methods->setlevel (battle, battle->side,
+			       playerlevel (battle->side));
+    battle->methods->setlevel (battle, 1 - battle->side, 0);
+}
+
+/**
+ * Plan and carry out a turn, or the rest of one, by heuristics. This
+ * plays the turns of the easy to hard computer players, finishes the
+ * turns of the tree search player, and plays both sides in rollouts.
+ */
+static void plan (void)
+{
+    Game *game; /* pointer ot the game */
+
+    /* initialise */
+    game = ai->data->game;
+    ai->data->ourcentre = game->centre (game, game->battle->side);
+    ai->data->theircentre = game->centre (game, ! game->battle->side);
+    ai->data->maxpower = maxpower ();
+    ai->data->gatherers = countgatherers ();
+    ai->data->points = checkpoints ();
+    mapinfluence ();
+    setlevels ();
+
+    /* turn phases */
+    gettargets ();
+    allocate ();
+    action ();
+
+    /* clean up */
+    clearlists ();
+}
+
+/**
+ * Score a battle for a side at the end of a rollout. A battle won or
+ * lost scores SEARCHWIN or 0. Otherwise the score is the side's share
+ * of what both sides are worth: each unit its cost in proportion to
+ * the hits it has left, and each resource point one.
+ * @param  battle The battle to score.
+ * @param  side   The side to score it for.
+ * @return        The score, 0..SEARCHWIN.
+ */
+static long evaluate (Battle *battle, int side)
+{
+    UnitType *utype; /* pointer to a unit's type */
+    CwgRoster *roster; /* the units' fields */
+    long worth[2]; /* the worth of each side in 16ths */
+    int victor, /* the side that has won, if any */
+	u; /* unit counter */
+
+    /* a battle won or lost needs no further scoring */
+    if ((victor = battle->methods->victory (battle)) != -1)
+	return (victor == side) ? SEARCHWIN : 0;
+
+    /* add up what each side is worth */
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
+    worth[0] = 16L * battle->resources[0];
+    worth[1] = 16L * battle->resources[1];
+    for (u = 0; u < battle->unitcap; ++u)
+	if ((roster->alive[u / 32] >> (u % 32)) & 1) {
+	    utype = ai->data->game->campaign->unittypes[roster->utype[u]];
+	    worth[roster->side[u]] += 16L * (utype->cost + 1)
+		* roster->hits[u] / utype->hits;
+	}
+
+    /* return the side's share */
+    if (! (worth[0] + worth[1]))
+	return SEARCHWIN / 2;
+    return SEARCHWIN * worth[side] / (worth[0] + worth[1]);
+}
+
+/**
+ * Free the buffers in the AI's data, or a worker's copy of it.
+ * @param data The data.
+ */
+static void freedata (AIData *data)
+{
+    if (data->targets)
+	free (data->targets);
+    if (data->targetindex)
+	free (data->targetindex);
+    if (data->targetscratch)
+	free (data->targetscratch);
+    if (data->influence)
+	free (data->influence);
+    if (data->marks)
+	free (data->marks);
+    if (data->reach)
+	free (data->reach);
+    if (data->nodes)
+	free (data->nodes);
+    if (data->actionlist)
+	free (data->actionlist);
+}
+
+/**
+ * Make the worker that plays the rollouts for a search.
+ * @param  real The battle being played.
+ * @return      The worker.
+ */
+static Worker *makeworker (Battle *real)
+{
+    Worker *worker; /* the worker */
+    AIData *data; /* pointer to the worker's data */
+
+    /* copy the AI, the planner's data and the game */
+    if (! (worker = malloc (sizeof (Worker))))
+	fatalerror (FATAL_MEMORY);
+    data = &worker->data;
+    worker->ai = *ai;
+    worker->ai.data = data;
+    worker->game = *ai->data->game;
+    *data = *ai->data;
+    data->game = &worker->game;
+
+    /* give the worker buffers of its own, and keep it quiet */
+    data->targets = NULL;
+    data->targetcount = 0;
+    data->targetroom = 0;
+    data->targetindex = NULL;
+    data->targetscratch = NULL;
+    data->agentcount = 0;
+    data->influence = NULL;
+    data->influenceroom = 0;
+    data->marks = NULL;
+    data->reach = NULL;
+    data->stamp = 0;
+    data->nodes = NULL;
+    data->nodecount = 0;
+    data->actionlist = NULL;
+    data->actionroom = 0;
+    data->rollout = 1;
+    data->prompthook = quietprompt;
+    data->loghook = quietlog;
+
+    /* give the worker its copy of the battle to search */
+    if (! (worker->search = real->methods->clone (real)))
+	fatalerror (FATAL_MEMORY);
+    worker->battle = NULL;
+    worker->side = real->side;
+
+    /* return the worker */
+    return worker;
+}
+
+/**
+ * Destroy the worker at the end of a search.
+ * @param worker The worker.
+ */
+static void freeworker (Worker *worker)
+{
+    worker->search->methods->destroy (worker->search);
+    freedata (&worker->data);
+    free (worker);
+}
+
+/**
+ * Play out the rest of the turn and the enemy's reply by heuristics,
+ * on the worker's copy of the search battle, and score the result.
+ * The planner sees the worker's copy of the AI while it plays.
+ * @param worker The worker, with the battle to play out.
+ */
+static void rollout (Worker *worker)
+{
+    AI *searcher; /* the AI to see again afterwards */
+    Battle *battle; /* the battle played out */
+    int p; /* turn counter */
+
+    /* play with the worker's copies */
+    searcher = ai;
+    ai = &worker->ai;
+    battle = worker->battle;
+
+    /* play out the turns and score them */
+    for (p = 0;
+	 p < SEARCHPLIES && battle->methods->victory (battle) == -1;
+	 ++p) {
+	plan ();
+	battle->methods->turn (battle);
     }
+    worker->reward = evaluate (battle, worker->side);
+
+    /* put the AI back */
+    ai = searcher;
+}
+
+/**
+ * Add a node to the search tree.
+ * @param  action The action leading to the node, or NULL for a node
+ *                that leaves the rest of the turn to the planner.
+ * @return        The new node.
+ */
+static int newnode (CwgAction *action)
+{
+    SearchNode *node; /* the new node */
+    node = &ai->data->nodes[ai->data->nodecount];
+    if (action)
+	node->action = *action;
+    else
+	node->action.type = SEARCHSTOP;
+    node->child = node->sibling = -1;
+    node->visits = node->reward = 0;
+    return ai->data->nodecount++;
+}
+
+/**
+ * Decide whether an action is worth searching. Attacks, builds and
+ * repairs are, and so are moves that bring an enemy within range.
+ * @param  battle The search battle.
+ * @param  action The action.
+ * @return        1 if the action is worth searching, 0 if not.
+ */
+static int candidate (Battle *battle, CwgAction *action)
+{
+    UnitType *utype; /* the moving unit's type */
+    CwgBoards *boards; /* bitboards of the map */
+    CwgBoard inrange; /* squares in range of the destination */
+    int w; /* bitboard word counter */
+
+    /* actions other than moves are always worth searching */
+    if (action->type != CWG_ACT_MOVE)
+	return 1;
+
+    /* moves are worth searching if they bring an enemy within range */
+    utype = ai->data->game->campaign->unittypes
+	[battle->units[action->unit]->utype];
+    if (! utype->power)
+	return 0;
+    if (! (boards = battle->methods->getboards (battle)))
+	fatalerror (FATAL_MEMORY);
+    battle->methods->surround (battle, &inrange,
+			       action->x + battle->map->width * action->y,
+			       utype->range);
+    for (w = 0; w < CWG_BOARDWORDS; ++w)
+	if (inrange.bits[w] & boards->sides[! battle->side].bits[w])
+	    return 1;
+    return 0;
 }
 
 /**
- * Destroy the agents when finished playing a turn.
- * @param agents The linked list of agents to destroy.
+ * List the legal actions in a search battle. The battle lists each
+ * unit's moves before its other actions, so if the list is too small
+ * it is grown and filled again, lest later units' attacks, builds and
+ * repairs be left out.
+ * @param  battle The search battle.
+ * @return        The number of actions, or -1 if there are too many.
  */
-static void destroyagents (Agent *agents)
+static int listactions (Battle *battle)
 {
-    Agent *agent; /* pointer to current agent */
-    agent = agents;
-    while (agents) {
-	agent = agents->next;
-	free (agents);
-	agents = agent;
+    CwgAction *list; /* the grown action list */
+    int count; /* the number of legal actions */
+
+    /* list the actions into the room there is */
+    if ((count = battle->methods->actions
+	 (battle, ai->data->actionlist, ai->data->actionroom)) == -1)
+	fatalerror (FATAL_MEMORY);
+    if (count <= ai->data->actionroom)
+	return count;
+    if (count > MAXACTIONS)
+	return -1;
+
+    /* grow the list to hold them all and list them again */
+    if (! (list = realloc (ai->data->actionlist,
+			   count * sizeof (CwgAction))))
+	fatalerror (FATAL_MEMORY);
+    ai->data->actionlist = list;
+    ai->data->actionroom = count;
+    if (battle->methods->actions (battle, list, count) == -1)
+	fatalerror (FATAL_MEMORY);
+    return count;
+}
+
+/**
+ * Give a search node its children: first one that leaves the rest of
+ * the turn to the planner, then up to SEARCHCHILDREN - 1 actions worth
+ * searching, with attacks, builds and repairs before moves.
+ * @param battle The search battle, with the node's actions applied.
+ * @param n      The node to expand.
+ */
+static void expand (Battle *battle, int n)
+{
+    CwgAction *action; /* pointer to a legal action */
+    int count, /* the number of legal actions */
+	children, /* the number of children added */
+	last, /* the last child added */
+	pass, /* 0 for moves, 1 for other actions */
+	c; /* action counter */
+
+    /* list the legal actions, if the tree and the list have room */
+    if (ai->data->nodecount + SEARCHCHILDREN > SEARCHNODES)
+	return;
+    if ((count = listactions (battle)) == -1)
+	return;
+
+    /* add the children */
+    ai->data->nodes[n].child = last = newnode (NULL);
+    children = 1;
+    for (pass = 0; pass < 2; ++pass)
+	for (c = 0; c < count && children < SEARCHCHILDREN; ++c) {
+	    action = &ai->data->actionlist[c];
+	    if ((action->type == CWG_ACT_MOVE) != pass ||
+		! candidate (battle, action))
+		continue;
+	    last = ai->data->nodes[last].sibling = newnode (action);
+	    ++children;
+	}
+}
+
+/**
+ * Choose the child of a search node to follow: any child not yet
+ * tried, or else the one whose mean reward, plus a bonus for having
+ * been tried less often than its siblings, is highest.
+ * @param  n The node.
+ * @return   The chosen child.
+ */
+static int bestchild (int n)
+{
+    SearchNode *child; /* pointer to a child */
+    long logvisits, /* log of the node's visits, in 1024ths */
+	score, /* a child's score */
+	best; /* the best score so far */
+    int c, /* child counter */
+	chosen; /* the best child so far */
+
+    /* score each child in turn */
+    logvisits = 1024L * logtwo (ai->data->nodes[n].visits);
+    best = -1;
+    chosen = -1;
+    for (c = ai->data->nodes[n].child; c != -1; c = child->sibling) {
+	child = &ai->data->nodes[c];
+	if (! child->visits)
+	    return c;
+	score = child->reward / child->visits
+	    + SEARCHEXPLORE * squareroot (logvisits / child->visits) / 32;
+	if (score > best) {
+	    best = score;
+	    chosen = c;
+	}
+    }
+
+    /* return the best */
+    return chosen;
+}
+
+/**
+ * Follow the search tree from its root for the worker, growing it
+ * where it ends, and apply the actions followed to the worker's copy
+ * of the battle.
+ * @param worker The worker.
+ * @param pass   The number of the pass, which reseeds the copy.
+ */
+static void descend (Worker *worker, long pass)
+{
+    Battle *search; /* the worker's copy of the battle */
+    CwgAction *action; /* the action of a node followed */
+    SearchNode *node; /* pointer to a node followed */
+    int d, /* depth counter */
+	n; /* node counter */
+
+    /* reseed the worker's copy for the pass */
+    search = worker->search;
+    search->methods->seed (search, ai->data->game->battle->hash[0]
+			   ^ (pass + 1) * SEARCHSALT);
+
+    /* follow the tree to its end, growing it if need be */
+    n = worker->path[0] = worker->depth = worker->applied = 0;
+    for (;;) {
+	node = &ai->data->nodes[n];
+	if (node->child == -1 &&
+	    (worker->depth == SEARCHDEPTH || (n && ! node->visits)))
+	    break;
+	if (node->child == -1)
+	    expand (search, n);
+	if (node->child == -1)
+	    break;
+	worker->path[++worker->depth] = n = bestchild (n);
+	action = &ai->data->nodes[n].action;
+	if (action->type == SEARCHSTOP ||
+	    ! search->methods->apply (search, action))
+	    break;
+	++worker->applied;
     }
+
+    /* count the visits, and copy the battle to play out */
+    for (d = 0; d <= worker->depth; ++d)
+	++ai->data->nodes[worker->path[d]].visits;
+    if (! (worker->battle = search->methods->clone (search)))
+	fatalerror (FATAL_MEMORY);
+    worker->game.battle = worker->battle;
+}
+
+/**
+ * Pass the worker's reward back up the path it followed, undo the
+ * actions it applied and discard the battle it played out.
+ * @param worker The worker.
+ */
+static void backup (Worker *worker)
+{
+    int d; /* depth counter */
+    for (d = 0; d <= worker->depth; ++d)
+	ai->data->nodes[worker->path[d]].reward += worker->reward;
+    while (worker->applied--)
+	worker->search->methods->undo (worker->search);
+    worker->battle->methods->destroy (worker->battle);
+    worker->battle = NULL;
+}
+
+/**
+ * Find the child of a search node that was tried most often.
+ * @param  n The node.
+ * @return   The child, or -1 if the node has no children.
+ */
+static int mostvisited (int n)
+{
+    long best; /* the most visits so far */
+    int c, /* child counter */
+	chosen; /* the child most visited so far */
+    best = -1;
+    chosen = -1;
+    for (c = ai->data->nodes[n].child; c != -1;
+	 c = ai->data->nodes[c].sibling)
+	if (ai->data->nodes[c].visits > best) {
+	    best = ai->data->nodes[c].visits;
+	    chosen = c;
+	}
+    return chosen;
+}
+
+/**
+ * Carry out an action chosen by the search on the battle being
+ * played, and report it.
+ * @param  action The action.
+ * @return        1 if successful, 0 if not.
+ */
+static int perform (CwgAction *action)
+{
+    Battle *battle; /* pointer to the battle */
+    Unit *unit, /* the unit acting */
+	*target; /* the unit attacked or repaired */
+
+    /* check the units are still there */
+    battle = ai->data->game->battle;
+    if (! (unit = battle->units[action->unit]) || ! unit->hits)
+	return 0;
+    target = NULL;
+    if ((action->type == CWG_ACT_ATTACK ||
+	 action->type == CWG_ACT_RESTORE) &&
+	(! (target = battle->units[action->target]) || ! target->hits))
+	return 0;
+
+    /* carry out the action */
+    initreport ();
+    switch (action->type) {
+    case CWG_ACT_MOVE:
+	return battle->methods->move (battle, unit, action->x, action->y,
+				      movehook);
+    case CWG_ACT_ATTACK:
+	return battle->methods->attack (battle, unit, target, attackhook);
+    case CWG_ACT_CREATE:
+	return battle->methods->create (battle, unit, action->utype,
+					action->x, action->y, buildhook) != -1;
+    case CWG_ACT_RESTORE:
+	return battle->methods->restore (battle, unit, target, repairhook);
+    }
+    return 0;
+}
+
+/**
+ * Search the sequences of actions open to the side to move for the
+ * rest of its time budget, and carry out the most promising. Each
+ * pass follows the tree by the rewards found so far, adds children
+ * to a node where the tree ends, and plays a rollout to score the
+ * result in a worker of its own. Actions are applied to the worker's
+ * copy of the battle and undone afterwards; the copy is reseeded on
+ * each pass, so the passes share out the luck of combat between them.
+ */
+static void search (void)
+{
+    Battle *real; /* the battle being played */
+    Worker *worker; /* the worker playing the rollouts */
+    Moment start; /* the time the search started */
+    char message[96]; /* a message to log, with room for 64-bit longs */
+    long budget, /* the milliseconds to search for */
+	spent, /* the milliseconds searched so far */
+	passes; /* the number of passes made */
+    int n; /* node counter */
+
+    /* set up the tree and the worker */
+    clocktime (&start);
+    if (! ai->data->nodes &&
+	! (ai->data->nodes = malloc (SEARCHNODES * sizeof (SearchNode))))
+	fatalerror (FATAL_MEMORY);
+    if (! ai->data->actionlist) {
+	if (! (ai->data->actionlist
+	       = malloc (SEARCHACTIONS * sizeof (CwgAction))))
+	    fatalerror (FATAL_MEMORY);
+	ai->data->actionroom = SEARCHACTIONS;
+    }
+    real = ai->data->game->battle;
+    budget = ai->data->budgets[real->side];
+    setlevels ();
+    worker = makeworker (real);
+    ai->data->nodecount = 0;
+    newnode (NULL);
+
+    /* make passes through the tree until the time is up */
+    passes = 0;
+    do {
+
+	/* follow the tree, play out the result and pass it back */
+	descend (worker, passes);
+	rollout (worker);
+	backup (worker);
+	++passes;
+
+	/* show progress */
+	spent = elapsed (&start);
+	ai->data->prompthook
+	    ("Searching",
+	     spent < budget ? (int) (spent * 100 / budget) : 100);
+    } while (spent < budget);
+    freeworker (worker);
+
+    /* report the speed of the search */
+    ai->data->searched += passes;
+    ai->data->searchtime += spent;
+    sprintf (message, "Searched %ld nodes in %ld ms, %ld per second",
+	     passes, spent, spent ? passes * 1000 / spent : passes);
+    ai->data->loghook (message);
+
+    /* carry out the actions tried most often */
+    n = 0;
+    while ((n = mostvisited (n)) != -1 &&
+	   ai->data->nodes[n].action.type != SEARCHSTOP &&
+	   ai->data->nodes[n].visits >= SEARCHCOMMIT &&
+	   perform (&ai->data->nodes[n].action));
 }
 
 /*----------------------------------------------------------------------
@@ -2395,44 +3523,47 @@ static void destroyagents (Agent *agents)
 static void destroy (void)
 {
     if (ai) {
-	if (ai->data)
+	if (ai->data) {
+	    freedata (ai->data);
 	    free (ai->data);
+	}
 	free (ai);
 	ai = NULL;
     }
 }
 
 /**
- * Play a computer turn.
+ * Play a computer turn. A tree search player searches for the best
+ * actions to start its turn with, and leaves the rest to the planner.
  */
 static void turn (void)
 {
     Game *game; /* pointer ot the game */
-    Target *targets; /* a linked list of identified targets */
-    Agent *agents; /* a linked list of allocated agents */
-
-    /* initialise */
     game = ai->data->game;
-    ai->data->ourcentre = game->centre (game, game->battle->side);
-    ai->data->theircentre = game->centre (game, ! game->battle->side);
-    ai->data->maxpower = maxpower ();
-    ai->data->gatherers = countgatherers ();
-    ai->data->points = checkpoints ();
-
-    /* set difficulty levels */
-    game->battle->setlevel
-	(game->battle->side,
-	 game->playertypes[game->battle->side] - PLAYER_COMPUTER);
-    game->battle->setlevel (1 - game->battle->side, 0);
+    if (game->playertypes[game->battle->side] == PLAYER_SEARCH)
+	search ();
+    plan ();
+}
 
-    /* turn phases */
-    targets = gettargets ();
-    agents = allocate (targets);
-    action (agents, targets);
+/**
+ * Set how long a tree search player may think on each turn.
+ * @param side         The side that the budget applies to.
+ * @param milliseconds The time allowed for each turn's search.
+ */
+static void setbudget (int side, long milliseconds)
+{
+    ai->data->budgets[side] = milliseconds;
+}
 
-    /* clean up */
-    destroytargets (targets);
-    destroyagents (agents);
+/**
+ * Get the work done by tree search players since the AI was made.
+ * @param nodes        Set to the number of nodes searched.
+ * @param milliseconds Set to the time spent searching them.
+ */
+static void searchstats (long *nodes, long *milliseconds)
+{
+    *nodes = ai->data->searched;
+    *milliseconds = ai->data->searchtime;
 }
 
 /*----------------------------------------------------------------------
@@ -2461,6 +3592,8 @@ AI *get_AI (Game *game, PromptHook prompthook, LogHook loghook)
     /* initialise methods */
     ai->destroy = destroy;
     ai->turn = turn;
+    ai->setbudget = setbudget;
+    ai->searchstats = searchstats;
 
     /* initialise simple attributes */
     ai->data->game = game;
@@ -2471,6 +3604,28 @@ AI *get_AI (Game *game, PromptHook prompthook, LogHook loghook)
     ai->data->prompthook = prompthook;
     ai->data->loghook = loghook;
 
+    /* initialise the target and agent lists */
+    ai->data->targets = NULL;
+    ai->data->targetcount = 0;
+    ai->data->targetroom = 0;
+    ai->data->targetindex = NULL;
+    ai->data->targetscratch = NULL;
+    ai->data->agentcount = 0;
+    ai->data->influence = NULL;
+    ai->data->influenceroom = 0;
+    ai->data->marks = NULL;
+    ai->data->reach = NULL;
+    ai->data->stamp = 0;
+    ai->data->nodes = NULL;
+    ai->data->nodecount = 0;
+    ai->data->actionlist = NULL;
+    ai->data->actionroom = 0;
+    ai->data->budgets[0] = BUDGET;
+    ai->data->budgets[1] = BUDGET;
+    ai->data->searched = 0;
+    ai->data->searchtime = 0;
+    ai->data->rollout = 0;
+
     /* initialise other AI aspects */
     categorise ();
 
@@ -23,6 +23,7 @@
 #include "battle.h"
 #include "utype.h"
 #include "terrain.h"
+#include "combat.h"
 #include "map.h"
 #include "unit.h"
 #include "campaign.h"
@@ -49,16 +50,18 @@ static void destroyobjects (Campaign *campaign)
 
     for (c = 0; c < CWG_UTYPES; ++c)
 	if (campaign->unittypes[c])
-	    campaign->unittypes[c]->destroy (campaign->unittypes[c]);
+	    campaign->unittypes[c]->methods->destroy (campaign->unittypes[c]);
     for (c = 0; c < 4 * CWG_UTYPES; ++c)
 	if (campaign->unitbitmaps[c])
 	    bit_destroy (campaign->unitbitmaps[c]);
     for (c = 0; c < CWG_TERRAIN; ++c)
 	if (campaign->terrain[c])
-	    campaign->terrain[c]->destroy (campaign->terrain[c]);
+	    campaign->terrain[c]->methods->destroy (campaign->terrain[c]);
     for (c = 0; c < 16 * CWG_TERRAIN; ++c)
 	if (campaign->terrainbitmaps[c])
 	    bit_destroy (campaign->terrainbitmaps[c]);
+    if (campaign->combat)
+	campaign->combat->methods->destroy (campaign->combat);
     for (c = 0; c < BARREN_SCENARIOS; ++c)
 	if (campaign->scenarios[c])
 	    campaign->scenarios[c]->destroy (campaign->scenarios[c]);
@@ -84,6 +87,7 @@ static void initialiseattributes (Campaign *campaign)
 	campaign->terrain[c] = NULL;
     for (c = 0; c < 16 * CWG_TERRAIN; ++c)
 	campaign->terrainbitmaps[c] = NULL;
+    campaign->combat = NULL;
     for (c = 0; c < BARREN_SCENARIOS; ++c)
 	campaign->scenarios[c] = NULL;
     campaign->gatherer = -1;
@@ -118,12 +122,13 @@ static void clear (Campaign *campaign)
 }
 
 /**
- * Save a campaign to an already-open file.
+ * Save a campaign to a file stream. The bitmaps are written
+ * straight to the file, so a memory stream will not do.
  * @param campaign is the campaign to save.
- * @param output is the already-open output file.
+ * @param output is the output stream.
  * @return 1 if successful, 0 if not.
  */
-static int write (Campaign *campaign, FILE *output)
+static int write (Campaign *campaign, Stream *output)
 {
     /* local variables */
     int r = 1, /* return code from trivial write */
@@ -136,6 +141,10 @@ static int write (Campaign *campaign, FILE *output)
     Bitmap *bitmap; /* pointer to bitmaps */
     Scenario *scenario; /* pointer to scenarios */
 
+    /* the bitmaps need a file behind the stream */
+    if (! output->methods->getfile (output))
+	return 0;
+
     /* write the campaign name */
     if (campaign->name)
 	r &= cwg->writestring (campaign->name, output);
@@ -152,10 +161,10 @@ static int write (Campaign *campaign, FILE *output)
 	if (campaign->unittypes[u]) {
 	    r &= cwg->writeint (&u, output);
 	    unittype = campaign->unittypes[u];
-	    r &= unittype->write (unittype, output);
+	    r &= unittype->methods->write (unittype, output);
 	    for (b = 0; b < 4; ++b) {
 		bitmap = campaign->unitbitmaps[b + 4 * u];
-		bit_write (bitmap, output);
+		bit_write (bitmap, output->methods->getfile (output));
 	    }
 	}
     r &= cwg->writeint (&u, output);
@@ -168,10 +177,10 @@ static int write (Campaign *campaign, FILE *output)
 	if (campaign->terrain[t]) {
 	    cwg->writeint (&t, output);
 	    terrain = campaign->terrain[t];
-	    r &= terrain->write (terrain, output);
+	    r &= terrain->methods->write (terrain, output);
 	    for (b = 0; b < 16; ++b) {
 		bitmap = campaign->terrainbitmaps[b + 16 * t];
-		bit_write (bitmap, output);
+		bit_write (bitmap, output->methods->getfile (output));
 	    }
 	}
     r &= cwg->writeint (&t, output);
@@ -180,8 +189,8 @@ static int write (Campaign *campaign, FILE *output)
     r &= cwg->writeint (&campaign->resource, output);
 
     /* write the corporate logos */
-    bit_write (campaign->corpbitmaps[0], output);
-    bit_write (campaign->corpbitmaps[1], output);
+    bit_write (campaign->corpbitmaps[0], output->methods->getfile (output));
+    bit_write (campaign->corpbitmaps[1], output->methods->getfile (output));
 
     /* write the scenarios */
     for (s = 0; s < BARREN_SCENARIOS; ++s)
@@ -197,13 +206,14 @@ static int write (Campaign *campaign, FILE *output)
 }
     
 /**
- * Load a campaign from an already-open file.
+ * Load a campaign from a file stream. The bitmaps are read
+ * straight from the file, so a memory stream will not do.
  * @param campaign The campaign to load.
  * @param summary  0 to load full campaign, 1 for summary only.
- * @param input    The already-open input file.
+ * @param input    The input stream.
  * @return         1 if successful, 0 if not.
  */
-static int read (Campaign *campaign, int summary, FILE *input)
+static int read (Campaign *campaign, int summary, Stream *input)
 {
     int r = 1, /* return value */
 	u, /* unit counter */
@@ -214,6 +224,10 @@ static int read (Campaign *campaign, int summary, FILE *input)
     Terrain *terrain; /* terrain type loaded */
     Scenario *scenario; /* scenario loaded */
 
+    /* the bitmaps need a file behind the stream */
+    if (! input->methods->getfile (input))
+	return 0;
+
     /* read the campaign name and corporation details */
     if (! cwg->readstring (campaign->name, input))
 	return 0;
@@ -231,16 +245,17 @@ static int read (Campaign *campaign, int summary, FILE *input)
     /* read unit types and their graphics */
     for (u = 0; u < CWG_UTYPES; ++u)
 	if ((unittype = campaign->unittypes[u])) {
-	    unittype->destroy (unittype);
+	    unittype->methods->destroy (unittype);
 	    campaign->unittypes[u] = NULL;
 	}
     for (cwg->readint (&u, input);
 	 u != CWG_UTYPES;
 	 cwg->readint (&u, input)) {
 	unittype = campaign->unittypes[u] = new_UnitType ();
-	r &= unittype->read (unittype, input);
+	r &= unittype->methods->read (unittype, input);
 	for (b = 0; b < 4; ++b)
-	    campaign->unitbitmaps[b + 4 * u] = bit_read (input);
+	    campaign->unitbitmaps[b + 4 * u] =
+		bit_read (input->methods->getfile (input));
     }
 
     /* read the gatherer unit type id */
@@ -249,24 +264,32 @@ static int read (Campaign *campaign, int summary, FILE *input)
     /* read terrain types */
     for (t = 0; t < CWG_TERRAIN; ++t)
 	if ((terrain = campaign->terrain[t])) {
-	    terrain->destroy (terrain);
+	    terrain->methods->destroy (terrain);
 	    campaign->terrain[t] = NULL;
 	}
     for (cwg->readint (&t, input);
 	 t != CWG_TERRAIN;
 	 cwg->readint (&t, input)) {
 	terrain = campaign->terrain[t] = new_Terrain ();
-	r &= terrain->read (terrain, input);
+	r &= terrain->methods->read (terrain, input);
 	for (b = 0; b < 16; ++b)
-	    campaign->terrainbitmaps[b + 16 * t] = bit_read (input);
+	    campaign->terrainbitmaps[b + 16 * t] =
+		bit_read (input->methods->getfile (input));
     }
 
     /* read the resource terrain type id */
     r &= cwg->readint (&campaign->resource, input);
 
+    /* work out the combat tables for these unit and terrain types */
+    if (campaign->combat)
+	campaign->combat->methods->destroy (campaign->combat);
+    if (! (campaign->combat = new_Combat
+	   (campaign->unittypes, campaign->terrain)))
+	r = 0;
+
     /* read the corporate logos */
-    campaign->corpbitmaps[0] = bit_read (input);
-    campaign->corpbitmaps[1] = bit_read (input);
+    campaign->corpbitmaps[0] = bit_read (input->methods->getfile (input));
+    campaign->corpbitmaps[1] = bit_read (input->methods->getfile (input));
 
     /* read scenarios */
     for (s = 0; s < BARREN_SCENARIOS; ++s)
@@ -295,7 +318,9 @@ static int read (Campaign *campaign, int summary, FILE *input)
 static int load (Campaign *campaign, int summary)
 {
     FILE *input; /* the input file handle */
+    Stream *stream; /* the stream reading the file */
     char header[8]; /* header read in from file */
+    int r; /* return value */
 
     /* open the file */
     if (! *campaign->filename)
@@ -305,7 +330,8 @@ static int load (Campaign *campaign, int summary)
 
     /* read the header */
     if (! fread (header, 8, 1, input) ||
-	(strcmp (header, "BAR102C") &&
+	(strcmp (header, "BAR103C") &&
+	 strcmp (header, "BAR102C") &&
 	 strcmp (header, "BAR101C") &&
 	 strcmp (header, "BAR100C"))) {
 	fclose (input);
@@ -313,14 +339,16 @@ static int load (Campaign *campaign, int summary)
     }
 
     /* read the rest of the campaign file */
-    if (! campaign->read (campaign, summary, input)) {
+    if (! (stream = new_FileStream (input))) {
 	fclose (input);
 	return 0;
     }
+    r = campaign->read (campaign, summary, stream);
 
     /* close the file and return */
+    stream->methods->destroy (stream);
     fclose (input);
-    return 1;
+    return r;
 }
 
 /*----------------------------------------------------------------------
@@ -55,28 +55,35 @@ static void load (void)
 {
     /* local variables */
     FILE *input; /* init file handle */
+    Stream *stream; /* buffered stream on the init file */
     char header[8]; /* header read from init file */
 
     /* if there's an input file, load the values from it */
     if ((input = fopen ("barren.ini", "rb"))) {
+	if (! (stream = new_FileStream (input)))
+	    fatalerror (FATAL_MEMORY);
 
         /* read and verify header */
-        if (! fread (header, 8, 1, input))
+        if (! stream->methods->read (stream, header, 8))
             fatalerror (FATAL_INVALIDINIT);
-        if (strcmp (header, "BAR100I"))
+        if (strcmp (header, "BAR101I") && strcmp (header, "BAR100I"))
             fatalerror (FATAL_INVALIDINIT);
 
         /* read the data proper */
-        if (! cwg->readstring (config->campaignfile, input))
+        if (! cwg->readstring (config->campaignfile, stream))
             fatalerror (FATAL_INVALIDINIT);
-        if (! cwg->readint (&config->playertypes[0], input))
+        if (! cwg->readint (&config->playertypes[0], stream))
             fatalerror (FATAL_INVALIDINIT);
-        if (! cwg->readint (&config->playertypes[1], input))
+        if (! cwg->readint (&config->playertypes[1], stream))
             fatalerror (FATAL_INVALIDINIT);
-	if (! cwg->readstring (config->gamefile, input))
+	if (! cwg->readstring (config->gamefile, stream))
+	    fatalerror (FATAL_INVALIDINIT);
+	if (! strcmp (header, "BAR101I") &&
+	    ! cwg->readint (&config->searchtime, stream))
 	    fatalerror (FATAL_INVALIDINIT);
 
         /* close the file */
+	stream->methods->destroy (stream);
         fclose (input);
     }
 }
@@ -88,20 +95,25 @@ static void save (void)
 {
     /* local variables */
     FILE *output; /* init file handle */
+    Stream *stream; /* buffered stream on the init file */
 
     /* attempt to open the output file */
     if ((output = fopen ("barren.ini", "wb"))) {
+	if (! (stream = new_FileStream (output)))
+	    fatalerror (FATAL_MEMORY);
 
 	/* write header */
-	fwrite ("BAR100I", 8, 1, output);
+	stream->methods->write (stream, "BAR101I", 8);
 
 	/* write the data proper */
-	cwg->writestring (config->campaignfile, output);
-	cwg->writeint (&config->playertypes[0], output);
-	cwg->writeint (&config->playertypes[1], output);
-	cwg->writestring (config->gamefile, output);
+	cwg->writestring (config->campaignfile, stream);
+	cwg->writeint (&config->playertypes[0], stream);
+	cwg->writeint (&config->playertypes[1], stream);
+	cwg->writestring (config->gamefile, stream);
+	cwg->writeint (&config->searchtime, stream);
 
 	/* close the file */
+	stream->methods->destroy (stream);
 	fclose (output);
     }
 }
@@ -132,6 +144,7 @@ Config *new_Config (void)
     config->playertypes[0] = PLAYER_HUMAN;
     config->playertypes[1] = PLAYER_COMPUTER;
     *config->gamefile = '\0';
+    config->searchtime = 2;
 
     /* get Cwg object (for I/O) */
     cwg = get_Cwg ();
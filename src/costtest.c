@@ -0,0 +1,326 @@
+/*======================================================================
+ * Barren Planet
+ * A turn-based strategy game.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Path Cost Test Program.
+ * Checks the travel cost grids that smart movement uses against the
+ * original sweep algorithm, for every unit type and destination on
+ * every scenario in a campaign.
+ */
+
+/*----------------------------------------------------------------------
+ * Headers
+ */
+
+/* ANSI C headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project-specific headers */
+#include "barren.h"
+#include "cwg.h"
+#include "fatal.h"
+#include "campaign.h"
+#include "scenario.h"
+
+/*----------------------------------------------------------------------
+ * Data Definitions
+ */
+
+/** @var campaignfile The campaign filename. */
+static char *campaignfile = NULL;
+
+/** @var campaign The campaign whose scenarios are checked. */
+static Campaign *campaign;
+
+/*----------------------------------------------------------------------
+ * Level 3 Private Function Definitions
+ */
+
+/**
+ * Create a grid of travel costs by repeated sweeps of the map.
+ * This is the original algorithm that smart movement used.
+ * @param battle is the battlefield.
+ * @param unit is the unit concerned.
+ * @param dx is the destination x coordinate.
+ * @param dy is the destination y coordinate.
+ * @return an array of costs for each square.
+ */
+static int *sweeppathcosts (Battle *battle, Unit *unit, int dx, int dy)
+{
+    /* local variables */
+    int *costs, /* travel cost grid */
+	width, /* width of the map */
+	height, /* height of the map */
+	sx, /* start x coordinate of sweep */
+	sy, /* start y coordinate of sweep */
+	ex, /* end x coordinate of sweep */
+	ey, /* end y coordinate of sweep */
+	x, /* current x coordinate of sweep */
+	y, /* current y coordinate of sweep */
+	dir, /* current direction of sweep */
+	xo, /* x offset to examine */
+	yo, /* y offset to examine */
+	pos, /* 1-dimensional position with offset */
+	moves, /* movement cost into a square */
+	best, /* best cost met so far */
+	modified; /* 1 if costs modified this sweep */
+    Map *map; /* map of the battlefield */
+    Terrain *terrain; /* terrain type of a map square */
+
+    /* initialise */
+    map = battle->map;
+    width = map->width;
+    height = map->height;
+    if (! (costs = calloc (width * height, sizeof (int))))
+	return NULL;
+
+    /* shortcut for path to adjacent square */
+    if (abs (unit->x - dx) <= 1 && abs (unit->y - dy) <= 1) {
+	terrain = battle->terrain
+	    [(int) map->terrain[dx + width * dy]];
+	if (! (moves = terrain->moves[unit->utype]))
+	    costs[dx + width * dy] = 0;
+	else if (map->units[dx + width * dy] != CWG_NO_UNIT)
+	    costs[dx + width * dy] = 0;
+	else
+	    costs[dx + width * dy] = moves;
+	return costs;
+    }
+
+    /* outer loop - sweep map until all costs finalised */
+    costs[dx + width * dy] = 1;
+    sx = sy = 0;
+    ex = width - 1;
+    ey = height - 1;
+    dir = 1;
+    do {
+
+	/* inner loop - perform a single sweep */
+	modified = 0;
+	for (x = sx; x != ex + dir; x += dir)
+	    for (y = sy; y != ey + dir; y += dir) {
+
+		/* don't check the destination or blocked squares */
+		if (x == dx && y == dy)
+		    continue;
+		terrain = battle->terrain
+		    [(int) map->terrain[x + width * y]];
+		if (! (moves = terrain->moves[unit->utype]))
+		    continue;
+
+		/* inner inner loop - look around */
+		best = 0;
+		for (xo = -1; xo <= 1; ++xo)
+		    for (yo = -1; yo <= 1; ++yo) {
+			pos = (x + xo) + width * (y + yo);
+			if (xo == 0 && yo == 0)
+			    continue;
+			if (x + xo < 0 || x + xo >= width ||
+			    y + yo < 0 || y + yo >= height)
+			    continue;
+			if (map->units[x + width * y] != CWG_NO_UNIT)
+			    continue;
+			if ((costs[pos] > 0 ||
+			     (x + xo == dx && y + yo == dy)) &&
+			    (costs[pos] < best ||
+			     best == 0))
+			    best = costs[pos];
+		    }
+
+		/* modify square if better cost found */
+		if (costs[x + width * y] != best + moves && best != 0) {
+		    costs[x + width * y] = best + moves;
+		    modified = 1;
+		}
+	    }
+
+	/* reverse direction for next sweep */
+	sx ^= ex;
+	ex ^= sx;
+	sx ^= ex;
+	sy ^= ey;
+	ey ^= sy;
+	sy ^= ey;
+	dir = -dir;
+    } while (modified);
+
+    /* all done */
+    return costs;
+}
+
+/*----------------------------------------------------------------------
+ * Level 2 Private Function Definitions
+ */
+
+/**
+ * Read through the argument list for recognised parameters.
+ * @param argc is the argument count from the command line.
+ * @param argv is an array of arguments.
+ */
+static void initialiseargs (int argc, char **argv)
+{
+    /* local variables */
+    int c; /* argument count */
+
+    /* scan through arguments */
+    for (c = 1; c < argc; ++c)
+	if (! campaignfile)
+	    campaignfile = argv[c];
+	else
+	    fatalerror (FATAL_COMMAND_LINE);
+    if (! campaignfile)
+	fatalerror (FATAL_COMMAND_LINE);
+}
+
+/**
+ * Compare the two cost grids for a unit and destination.
+ * @param battle is the battle to examine.
+ * @param unit is the unit to move.
+ * @param dx is the x coordinate of the destination.
+ * @param dy is the y coordinate of the destination.
+ * @return the number of squares whose costs differ.
+ */
+static int checkdestination (Battle *battle, Unit *unit, int dx, int dy)
+{
+    /* local variables */
+    int *costs, /* costs used by smart movement */
+	*check, /* costs from the original sweep */
+	errors, /* number of squares whose costs differ */
+	l; /* location counter */
+
+    /* get both grids */
+    if (! (costs = battle->methods->pathcosts (battle, unit, dx, dy)) ||
+	! (check = sweeppathcosts (battle, unit, dx, dy)))
+	fatalerror (FATAL_MEMORY);
+
+    /* compare them square by square */
+    errors = 0;
+    for (l = 0; l < battle->map->width * battle->map->height; ++l)
+	if (costs[l] != check[l]) {
+	    if (! errors)
+		printf ("  unit type %d from %d,%d to %d,%d:"
+			" %d,%d costs %d, not %d\n",
+			unit->utype, unit->x, unit->y, dx, dy,
+			l % battle->map->width, l / battle->map->width,
+			costs[l], check[l]);
+	    ++errors;
+	}
+
+    /* clean up and return */
+    free (costs);
+    free (check);
+    return errors;
+}
+
+/*----------------------------------------------------------------------
+ * Level 1 Private Function Definitions
+ */
+
+/**
+ * Initialise the program.
+ * @param argc is the argument count from the command line.
+ * @param argv is the array of arguments from the command line.
+ */
+static void initialiseprogram (int argc, char **argv)
+{
+    /* check command line */
+    initialiseargs (argc, argv);
+
+    /* load the campaign */
+    if (! (campaign = new_Campaign ()))
+	fatalerror (FATAL_MEMORY);
+    strcpy (campaign->filename, campaignfile);
+    if (! strchr (campaign->filename, '.'))
+	strcat (campaign->filename, ".cam");
+    if (! (campaign->load (campaign, 0)))
+	fatalerror (FATAL_INVALIDDATA);
+}
+
+/**
+ * Check the cost grids over each scenario.
+ * Each destination is checked from the far corner of the map, which
+ * needs a full search, and from a square next to it, which does not.
+ * @return the number of grids that differ.
+ */
+static long checkscenarios (void)
+{
+    /* local variables */
+    Battle *battle; /* the scenario's battle */
+    Unit *unit; /* a unit of each type, not placed on the map */
+    long grids, /* number of grids checked */
+	failures, /* number of grids that differ */
+	total; /* number of grids that differ over all scenarios */
+    int s, /* scenario counter */
+	u, /* unit type counter */
+	x, /* x coordinate of the destination */
+	y; /* y coordinate of the destination */
+
+    /* loop through the scenarios */
+    if (! (unit = new_Unit ()))
+	fatalerror (FATAL_MEMORY);
+    total = 0;
+    for (s = 0; s < BARREN_SCENARIOS; ++s) {
+	if (! campaign->scenarios[s] || ! campaign->scenarios[s]->battle)
+	    continue;
+	battle = campaign->scenarios[s]->battle;
+	grids = failures = 0;
+
+	/* check every unit type and destination */
+	for (u = 0; u < CWG_UTYPES; ++u) {
+	    if (! battle->utypes[u])
+		continue;
+	    unit->utype = u;
+	    for (y = 0; y < battle->map->height; ++y)
+		for (x = 0; x < battle->map->width; ++x) {
+		    unit->x = x < battle->map->width / 2
+			? battle->map->width - 1
+			: 0;
+		    unit->y = y < battle->map->height / 2
+			? battle->map->height - 1
+			: 0;
+		    failures += checkdestination (battle, unit, x, y) != 0;
+		    unit->x = x ? x - 1 : x + 1;
+		    unit->y = y;
+		    failures += checkdestination (battle, unit, x, y) != 0;
+		    grids += 2;
+		}
+	}
+
+	/* report on the scenario */
+	printf ("Scenario %d: %ld grids, %ld differ\n",
+		s + 1, grids, failures);
+	total += failures;
+    }
+
+    /* report on the whole campaign */
+    printf ("Total: %ld grids differ\n", total);
+    unit->methods->destroy (unit);
+    return total;
+}
+
+/*----------------------------------------------------------------------
+ * Public Level Function Definitions
+ */
+
+/**
+ * Main Program.
+ * @param argc is the number of command line arguments.
+ * @param argv is an array of command line arguments.
+ * @return 0 if the grids all match, 1 if not.
+ */
+int main (int argc, char **argv)
+{
+    /* local variables */
+    long failures; /* number of grids that differ */
+
+    /* check the campaign */
+    initialiseprogram (argc, argv);
+    failures = checkscenarios ();
+    campaign->destroy (campaign);
+    return failures != 0;
+}
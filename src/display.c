@@ -136,9 +136,21 @@ static Bitmap *buildarrows[3];
 /** @var back is the screen background. */
 static Bitmap *back;
 
-/** @var mapimg The map image bitmap. */
+/** @var mapimg The image of the map squares in view. */
 static Bitmap *mapimg = NULL;
 
+/** @var mapcampaign The campaign whose bitmaps draw the map. */
+static Campaign *mapcampaign = NULL;
+
+/** @var mapbattle The battle whose map is drawn. */
+static Battle *mapbattle = NULL;
+
+/** @var mapx The x coordinate of the square at the left of mapimg. */
+static int mapx = -1;
+
+/** @var mapy The y coordinate of the square at the top of mapimg. */
+static int mapy = -1;
+
 /** @var font is the font in standard colours. */
 static Font *font;
 
@@ -163,7 +175,8 @@ static char *playerdescs[] = {
     "Computer (Easy)",
     "Computer (Fair)",
     "Computer (Hard)",
-    "PBM"
+    "PBM",
+    "Computer (Search)"
 };
 
 /** @var scrtitle The title of the current screen. */
@@ -761,9 +774,19 @@ static void updatemap (Campaign *campaign, Battle *battle, int x, int y)
 	u, /* unit id */
 	ut, /* unit type id */
 	s, /* unit side */
-	connects; /* connections */
+	connects, /* connections */
+	px, /* x position of the square in the map image */
+	py; /* y position of the square in the map image */
     Map *map; /* convenience pointer to battle map */
 
+    /* only the squares in view are drawn */
+    if (x < mapx || x > mapx + 8 || y < mapy || y > mapy + 8)
+	return;
+
+    /* work out where the square goes in the map image */
+    px = 16 * (x - mapx);
+    py = 16 * (y - mapy);
+
     /* ascertain the terrain */
     map = battle->map;
     t = map->terrain[x + map->width * y];
@@ -787,7 +810,7 @@ static void updatemap (Campaign *campaign, Battle *battle, int x, int y)
     /* get the terrain tile and put it on the map */
     bit_put (mapimg,
 	     campaign->terrainbitmaps[t * 16 + connects],
-	     16 * x, 16 * y, DRAW_PSET);
+	     px, py, DRAW_PSET);
 
     /* check for a unit */
     s = -1;
@@ -800,40 +823,57 @@ static void updatemap (Campaign *campaign, Battle *battle, int x, int y)
 	/* put it on the map */
 	bit_put (mapimg,
 		 campaign->unitbitmaps[4 * ut + 1 + 2 * s],
-		 16 * x, 16 * y, DRAW_AND);
+		 px, py, DRAW_AND);
 	bit_put (mapimg,
 		 campaign->unitbitmaps[4 * ut + 2 * s],
-		 16 * x, 16 * y, DRAW_OR);
+		 px, py, DRAW_OR);
     }
 
     /* check for a victory position */
     if (map->points[x + map->width * y]) {
-	bit_put (mapimg, points[3], 16 * x, 16 * y, DRAW_AND);
-	bit_put (mapimg, points[1 + s], 16 * x, 16 * y,
-		 DRAW_OR);
+	bit_put (mapimg, points[3], px, py, DRAW_AND);
+	bit_put (mapimg, points[1 + s], px, py, DRAW_OR);
     }
 }
 
 /**
- * Prepare a battle map.
+ * Prepare a battle map. Only the squares in view are drawn, as an
+ * image of the whole of a large map would not fit in memory.
  * @param campaign The campaign containing the bitmaps.
  * @param battle   The battle to display.
  */
 static void preparemap (Campaign *campaign, Battle *battle)
 {
-    int x, /* x location counter */
-	y; /* y location counter */
-    
     /* initialise the map image */
-    if (mapimg)
-	bit_destroy (mapimg);
-    mapimg = bit_create (16 * battle->map->width,
-			 16 * battle->map->height);
-
-    /* scan across the whole map generating the terrain */
-    for (x = 0; x < battle->map->width; ++x)
-	for (y = 0; y < battle->map->height; ++y)
-	    updatemap (campaign, battle, x, y);
+    if (! mapimg)
+	mapimg = bit_create (144, 144);
+    mapcampaign = campaign;
+    mapbattle = battle;
+
+    /* nothing is in view until the map is shown */
+    mapx = mapy = -1;
+}
+
+/**
+ * Draw the map image for a view, if it does not already hold it.
+ * @param x The x coordinate shown at the top left.
+ * @param y The y coordinate shown at the top left.
+ */
+static void viewmap (int x, int y)
+{
+    int xs, /* x location counter */
+	ys; /* y location counter */
+
+    /* return if the view is already drawn */
+    if (x == mapx && y == mapy)
+	return;
+
+    /* draw each square of the new view */
+    mapx = x;
+    mapy = y;
+    for (xs = x; xs <= x + 8 && xs < mapbattle->map->width; ++xs)
+	for (ys = y; ys <= y + 8 && ys < mapbattle->map->height; ++ys)
+	    updatemap (mapcampaign, mapbattle, xs, ys);
 }
 
 /**
@@ -843,8 +883,8 @@ static void preparemap (Campaign *campaign, Battle *battle)
  */
 static void showmap (int x, int y)
 {
-    bit_putpart (scrbuf, mapimg, 8, 8, 16 * x, 16 * y, 144, 144,
-		 DRAW_PSET);
+    viewmap (x, y);
+    bit_putpart (scrbuf, mapimg, 8, 8, 0, 0, 144, 144, DRAW_PSET);
     queueupdate (8, 8, 144, 144);
 }
 
@@ -871,8 +911,9 @@ static void showmapcursor (int xcursor, int ycursor, int xview,
     y = 8 + 16 * (ycursor - yview);
 
     /* update the off-screen buffer */
-    bit_putpart (scrbuf, mapimg, x, y, 16 * xcursor, 16 * ycursor,
-		 16, 16, DRAW_PSET);
+    viewmap (xview, yview);
+    bit_putpart (scrbuf, mapimg, x, y, 16 * (xcursor - xview),
+		 16 * (ycursor - yview), 16, 16, DRAW_PSET);
     bit_put (scrbuf, cursormask, x, y, DRAW_AND);
     bit_put (scrbuf, cursor, x, y, DRAW_OR);
     queueupdate (x, y, 16, 16);
@@ -901,11 +942,35 @@ static void hidemapcursor (int xcursor, int ycursor, int xview,
     y = 8 + 16 * (ycursor - yview);
 
     /* update the off-screen buffer */
-    bit_putpart (scrbuf, mapimg, x, y, 16 * xcursor, 16 * ycursor,
-		 16, 16, DRAW_PSET);
+    viewmap (xview, yview);
+    bit_putpart (scrbuf, mapimg, x, y, 16 * (xcursor - xview),
+		 16 * (ycursor - yview), 16, 16, DRAW_PSET);
     queueupdate (x, y, 16, 16);
 }
 
+/**
+ * Mark the squares in view that the selected unit can reach.
+ * @param squares The reachable flag for each map square.
+ * @param width   The width of the map.
+ * @param xview   The x coordinate of the map view.
+ * @param yview   The y coordinate of the map view.
+ */
+static void showmapreach (unsigned char *squares, int width, int xview,
+			  int yview)
+{
+    int x, /* x coordinate of the square */
+	y; /* y coordinate of the square */
+
+    /* put a small dot in the middle of each reachable square */
+    bit_ink (scrbuf, 3);
+    for (x = xview; x <= xview + 8; ++x)
+	for (y = yview; y <= yview + 8; ++y)
+	    if (squares[x + width * y])
+		bit_box (scrbuf, 15 + 16 * (x - xview),
+			 15 + 16 * (y - yview), 2, 2);
+    queueupdate (8, 8, 144, 144);
+}
+
 /**
  * Show information on empty terrain.
  * @param terrainid The id of the terrain to show.
@@ -1672,6 +1737,7 @@ Display *new_Display (int colourset, int quiet)
     display->showmap = showmap;
     display->showmapcursor = showmapcursor;
     display->hidemapcursor = hidemapcursor;
+    display->showmapreach = showmapreach;
     display->showterraininfo = showterraininfo;
     display->showunitinfo = showunitinfo;
     display->showenemyinfo = showenemyinfo;
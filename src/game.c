@@ -47,7 +47,7 @@ static Config *config = NULL;
 static void destroyobjects (Game *game)
 {
     if (game->battle)
-	game->battle->destroy (game->battle);
+	game->battle->methods->destroy (game->battle);
     if (game->report)
 	game->report->destroy (game->report);
     if (game->campaign)
@@ -107,42 +107,49 @@ static void clear (Game *game)
 static int save (Game *game)
 {
     FILE *output; /* the output file */
+    Stream *stream; /* buffered stream on the output file */
     int success = 1, /* return value */
 	noreport = 0; /* constant zero for no report */
 
     /* open the output file */
     if (! (output = fopen (game->filename, "wb")))
 	return 0;
+    if (! (stream = new_FileStream (output))) {
+	fclose (output);
+	return 0;
+    }
 
     /* write the game header */
-    success = success && fwrite ("BAR100G", 8, 1, output);
+    success = success && stream->methods->write (stream, "BAR101G", 8);
     
     /* write the basic information */
     success = success &&
-	cwg->writestring (game->campaignfile, output) &&
-	cwg->writeint (&game->playertypes[0], output) &&
-	cwg->writeint (&game->playertypes[1], output) &&
-	cwg->writeint (&game->briefed[0], output) &&
-	cwg->writeint (&game->briefed[1], output) &&
-	cwg->writeint (&game->debriefed[0], output) &&
-	cwg->writeint (&game->debriefed[1], output) &&
-	cwg->writeint (&game->state, output) &&
-	cwg->writeint (&game->scenid, output) &&
-	cwg->writeint (&game->turnno, output);
+	cwg->writestring (game->campaignfile, stream) &&
+	cwg->writeint (&game->playertypes[0], stream) &&
+	cwg->writeint (&game->playertypes[1], stream) &&
+	cwg->writeint (&game->briefed[0], stream) &&
+	cwg->writeint (&game->briefed[1], stream) &&
+	cwg->writeint (&game->debriefed[0], stream) &&
+	cwg->writeint (&game->debriefed[1], stream) &&
+	cwg->writeint (&game->state, stream) &&
+	cwg->writeint (&game->scenid, stream) &&
+	cwg->writeint (&game->turnno, stream);
 
     /* save the battle */
     success = success &&
-	game->battle->write (game->battle, output);
+	game->battle->methods->write (game->battle, stream) &&
+	game->battle->methods->writerandom (game->battle, stream);
 
     /* save the report */
     if (game->report)
 	success = success &&
-	    game->report->write (game->report, output);
+	    game->report->write (game->report, stream);
     else
 	success = success &&
-	    fwrite (&noreport, 2, 1, output);
+	    stream->methods->write (stream, &noreport, 2);
 
     /* close the output file and return */
+    stream->methods->destroy (stream);
     fclose (output);
     return success;
 }
@@ -156,47 +163,56 @@ static int save (Game *game)
 static int load (Game *game, int summary)
 {
     FILE *input; /* the input file */
-    int success = 1; /* return value */
+    Stream *stream; /* buffered stream on the input file */
+    int success = 1, /* return value */
+	format; /* format of the turn report */
     char header[8]; /* header read from file */
 
     /* open the input file */
     if (! (input = fopen (game->filename, "rb")))
 	return 0;
+    if (! (stream = new_FileStream (input))) {
+	fclose (input);
+	return 0;
+    }
 
     /* read the game header */
     success = success &&
-	fread (header, 8, 1, input) &&
-	! strncmp (header, "BAR100G", 8);
+	stream->methods->read (stream, header, 8) &&
+	(! strncmp (header, "BAR101G", 8) ||
+	 ! strncmp (header, "BAR100G", 8));
+    format = strncmp (header, "BAR100G", 8) ? REPORT_WIDE : REPORT_PACKED;
 
     /* read the game settings */
     success = success &&
-	cwg->readstring (game->campaignfile, input);
+	cwg->readstring (game->campaignfile, stream);
     success = success &&
-	cwg->readint (&game->playertypes[0], input);
+	cwg->readint (&game->playertypes[0], stream);
     success = success &&
-	cwg->readint (&game->playertypes[1], input);
+	cwg->readint (&game->playertypes[1], stream);
 
     /* stop here if only the summary is needed */
     if (summary) {
+	stream->methods->destroy (stream);
 	fclose (input);
 	return success;
     }
 
     /* load the game state and progress information */
     success = success &&
-	cwg->readint (&game->briefed[0], input);
+	cwg->readint (&game->briefed[0], stream);
     success = success &&
-	cwg->readint (&game->briefed[1], input);
+	cwg->readint (&game->briefed[1], stream);
     success = success &&
-	cwg->readint (&game->debriefed[0], input);
+	cwg->readint (&game->debriefed[0], stream);
     success = success &&
-	cwg->readint (&game->debriefed[1], input);
+	cwg->readint (&game->debriefed[1], stream);
     success = success &&
-	cwg->readint (&game->state, input);
+	cwg->readint (&game->state, stream);
     success = success &&
-	cwg->readint (&game->scenid, input);
+	cwg->readint (&game->scenid, stream);
     success = success &&
-	cwg->readint (&game->turnno, input);
+	cwg->readint (&game->turnno, stream);
 
     /* load in the campaign and current battle state */
     if (success) {
@@ -207,11 +223,16 @@ static int load (Game *game, int summary)
 	strcpy (game->campaign->filename, game->campaignfile);
 	success = success && game->campaign->load (game->campaign, 0);
 	if (game->battle)
-	    game->battle->destroy (game->battle);
+	    game->battle->methods->destroy (game->battle);
 	game->battle = new_Battle (game->campaign->unittypes,
 				   game->campaign->terrain);
 	success = success &&
-	    game->battle->read (game->battle, input);
+	    game->battle->methods->read (game->battle, stream);
+	if (! strncmp (header, "BAR100G", 8))
+	    game->battle->methods->seed (game->battle, rand ());
+	else
+	    success = success &&
+		game->battle->methods->readrandom (game->battle, stream);
     }
 
     /* load in the initial battle state and turn report */
@@ -221,10 +242,11 @@ static int load (Game *game, int summary)
 	else
 	    game->report = new_Report ();
 	success = success &&
-	    game->report->read (game->report, input);
+	    game->report->read (game->report, stream, format);
     }
 
     /* close the input file and return */
+    stream->methods->destroy (stream);
     fclose (input);
     return success;
 }
@@ -242,17 +264,18 @@ static int turn (Game *game)
     Unit *unit; /* unit for resource gathering */
 
     /* next player and, if appropriate, next turn number */
-    game->battle->turn (game->battle);
+    game->battle->methods->turn (game->battle);
     if (game->battle->side == game->battle->start)
 	++game->turnno;
 
     /* check for victory of both scenario and campaign */
-    victor = game->battle->victory (game->battle);
+    victor = game->battle->methods->victory (game->battle);
     if (victor == -1);
     else if (! game->debriefed[game->battle->side] &&
 	game->playertypes[game->battle->side] != PLAYER_COMPUTER &&
 	game->playertypes[game->battle->side] != PLAYER_FAIR &&
-	game->playertypes[game->battle->side] != PLAYER_HARD)
+	game->playertypes[game->battle->side] != PLAYER_HARD &&
+	game->playertypes[game->battle->side] != PLAYER_SEARCH)
 	return game->state =
 	    (game->playertypes[game->battle->side] == PLAYER_HUMAN) ?
 	    STATE_REPORT :
@@ -263,7 +286,7 @@ static int turn (Game *game)
 	return game->state = STATE_ENDGAME;
 
     /* resource gathering */
-    for (u = 0; u < CWG_UNITS; ++u)
+    for (u = 0; u < game->battle->unitcap; ++u)
 	if ((unit = game->battle->units[u]) &&
 	    unit->side == game->battle->side &&
 	    unit->utype == game->campaign->gatherer)
@@ -273,11 +296,13 @@ static int turn (Game *game)
 		game->campaign->resource)
 		game->battle->resources[unit->side] += 2;
 	}
+    game->battle->methods->rehash (game->battle);
 
     /* select the appropriate game state to start on */
     if (game->playertypes[game->battle->side] == PLAYER_COMPUTER ||
 	game->playertypes[game->battle->side] == PLAYER_FAIR ||
-	game->playertypes[game->battle->side] == PLAYER_HARD)
+	game->playertypes[game->battle->side] == PLAYER_HARD ||
+	game->playertypes[game->battle->side] == PLAYER_SEARCH)
 	return game->state = STATE_COMPUTER;
     else if (game->playertypes[game->battle->side] == PLAYER_PBM)
 	return game->state = STATE_PBM;
@@ -303,7 +328,7 @@ static int setscenario (Game *game)
     /* check for no victory - either we haven't started a battle, 
        or the battle is still ongoing. */
     if (! game->battle ||
-	(victor = game->battle->victory (game->battle)) == -1);
+	(victor = game->battle->methods->victory (game->battle)) == -1);
 
     /* check for a final victory - no more scenarios */
     else if (scenario->next[victor] == 0)
@@ -317,9 +342,11 @@ static int setscenario (Game *game)
 
     /* set up the battle */
     if (game->battle)
-	game->battle->destroy (game->battle);
-    game->battle = scenario->battle->clone (scenario->battle);
+	game->battle->methods->destroy (game->battle);
+    game->battle = scenario->battle->methods->clone (scenario->battle);
     game->battle->start = game->battle->side = rand () % 2;
+    game->battle->methods->seed (game->battle, rand ());
+    game->battle->methods->rehash (game->battle);
     game->turnno = 0;
 
     /* set up the report data */
@@ -339,6 +366,7 @@ static int setscenario (Game *game)
     case PLAYER_COMPUTER:
     case PLAYER_FAIR:
     case PLAYER_HARD:
+    case PLAYER_SEARCH:
 	game->state = STATE_COMPUTER;
 	break;
     case PLAYER_PBM:
@@ -365,17 +393,19 @@ static int centre (Game *game, int side)
 	y, /* total of y coordinates of friendly units */
 	n; /* number of friendly units counted */
     Battle *battle; /* pointer to battle object */
+    CwgRoster *roster; /* the units' fields */
 
     /* initialise convenience variables */
     battle = game->battle;
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
 
     /* sum up the total of units, and their aggregate position */
-    for (x = y = n = u = 0; u < CWG_UNITS; ++u)
-	if (battle->units[u] &&
-	    battle->units[u]->hits &&
-	    battle->units[u]->side == side) {
-	    x += battle->units[u]->x;
-	    y += battle->units[u]->y;
+    for (x = y = n = u = 0; u < battle->unitcap; ++u)
+	if (((roster->alive[u / 32] >> (u % 32)) & 1) &&
+	    roster->side[u] == side) {
+	    x += roster->x[u];
+	    y += roster->y[u];
 	    ++n;
 	}
 
@@ -36,8 +36,11 @@
  * Constants.
  */
 
-/** @const BUFSIZE is the maximum input buffer size */
-#define BUFSIZE 1024
+/** @const BUFSIZE is the maximum input buffer size, for the largest map */
+#define BUFSIZE (CWG_SQUARES + 64)
+
+/** @const OLDSQUARES is the most map squares older games can read */
+#define OLDSQUARES 256
 
 /*----------------------------------------------------------------------
  * Data Definitions.
@@ -97,10 +100,11 @@ static char mapchars[12] = {
 static char *headers[] = {
     "BAR100C", /* obsolete */
     "BAR101C", /* obsolete */
-    "BAR102C" /* corrected target square bug */
+    "BAR102C", /* corrected target square bug */
+    "BAR103C" /* maps over 256 squares */
 };
 
-/** @var version Version for header output. */
+/** @var version Version for header output, raised for large maps. */
 static int version = 2;
 
 /*----------------------------------------------------------------------
@@ -854,11 +858,13 @@ static void processscenariomapline (void)
     /* get width and height, setting and verifying map dimensions */
     width = getnumberfromline ();
     height = getnumberfromline ();
-    if (! map->size (map, width, height)) {
+    if (! map->methods->size (map, width, height)) {
 	printf ("Invalid map size %dx%d set on line %d.\n",
 		width, height, line);
 	fatalerror (FATAL_INVALIDDATA);
     }
+    if (width * height > OLDSQUARES)
+	version = 3;
 
     /* get the map string */
     if (! (mapstr = strtok (NULL, "\r\n"))) {
@@ -924,18 +930,15 @@ static void processunitline (void)
     /* grab the side name */
     player = playernamelookup ();
 
-    /* find free unit slot */
-    for (u = 0; u < CWG_UNITS; ++u)
-	if (! scenario->battle->units[u])
-	    break;
-    if (u == CWG_UNITS) {
-	printf ("Too may units (%d) in line %d.\n", u, line);
+    /* identify the unit type and create the unit in a free slot */
+    ut = unittypelookup ();
+    if (! (unit = new_Unit ()))
+	fatalerror (FATAL_MEMORY);
+    u = scenario->battle->methods->addunit (scenario->battle, unit);
+    if (u == CWG_NO_UNIT) {
+	printf ("Too many units (%d) in line %d.\n", CWG_MAXUNITS, line);
 	fatalerror (FATAL_INVALIDDATA);
     }
-
-    /* identify the unit type and create the unit */
-    ut = unittypelookup ();
-    unit = scenario->battle->units[u] = new_Unit ();
     strcpy (unit->name, campaign->unittypes[ut]->name);
     unit->side = player;
     unit->utype = ut;
@@ -1087,8 +1090,8 @@ static void openinputfile (void)
 static int processinputline (void)
 {
     /* local variables */
-    char buf[BUFSIZE], /* input buffer */
-	*pos, /* position of character we're searching for */
+    static char buf[BUFSIZE]; /* input buffer, too big for the stack */
+    char *pos, /* position of character we're searching for */
 	*token; /* initial command token */
     static ReadState state = STATE_NONE; /* reading state */
 
@@ -1201,6 +1204,7 @@ static void savecampaign (void)
 {
     /* local variables */
     FILE *output; /* output file */
+    Stream *stream; /* buffered stream on the output file */
     char *outputfilename; /* name of output file */
 
     /* ascertain the filename */
@@ -1215,10 +1219,13 @@ static void savecampaign (void)
 	fatalerror (FATAL_NODATA);
 
     /* write the rest of the campaign data */
-    if (! (campaign->write (campaign, output)))
+    if (! (stream = new_FileStream (output)))
+	fatalerror (FATAL_MEMORY);
+    if (! (campaign->write (campaign, stream)))
 	fatalerror (FATAL_NODATA);
 
     /* close the output file and clean up */
+    stream->methods->destroy (stream);
     fclose (output);
     free (outputfilename);
 }
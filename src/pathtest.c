@@ -0,0 +1,267 @@
+/*======================================================================
+ * Barren Planet
+ * A turn-based strategy game.
+ *
+ * Copyright (C) Damian Gareth Walker, 2020.
+ * Created: 17-Oct-2026.
+ *
+ * Pathfinding Benchmark Program.
+ * Times the path searches over every scenario in a campaign. With
+ * -s<side>, each scenario's map and units are repeated to fill a
+ * square map of that side, to time the searches on larger maps.
+ */
+
+/*----------------------------------------------------------------------
+ * Headers
+ */
+
+/* ANSI C headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* project-specific headers */
+#include "barren.h"
+#include "cwg.h"
+#include "fatal.h"
+#include "campaign.h"
+#include "scenario.h"
+
+/*----------------------------------------------------------------------
+ * Data Definitions
+ */
+
+/** @var passes The number of times to repeat the searches. */
+static int passes = 10;
+
+/** @var side The side of the tiled map, or 0 to use the scenario's. */
+static int side = 0;
+
+/** @var campaignfile The campaign filename. */
+static char *campaignfile = NULL;
+
+/** @var campaign The campaign whose scenarios are searched. */
+static Campaign *campaign;
+
+/*----------------------------------------------------------------------
+ * Level 2 Private Function Definitions
+ */
+
+/**
+ * Copy a battle's map and units, repeated to fill a larger map.
+ * Units are left out once the battle can hold no more.
+ * @param battle is the battle to copy.
+ * @return the larger battle.
+ */
+static Battle *tilebattle (Battle *battle)
+{
+    /* local variables */
+    Battle *tiled; /* the larger battle */
+    Map *map, /* the map of the original battle */
+	*newmap; /* the map of the larger battle */
+    Unit *unit; /* a unit copied to the larger battle */
+    int x, /* x coordinate on the larger map */
+	y, /* y coordinate on the larger map */
+	l, /* location on the original map */
+	u; /* unit ID in the larger battle */
+
+    /* create the battle and its map */
+    map = battle->map;
+    if (! (tiled = new_Battle (battle->utypes, battle->terrain)) ||
+	! (tiled->map = newmap = new_Map ()) ||
+	! newmap->methods->size (newmap, side, side))
+	fatalerror (FATAL_MEMORY);
+    tiled->side = battle->side;
+    tiled->start = battle->start;
+    tiled->resources[0] = battle->resources[0];
+    tiled->resources[1] = battle->resources[1];
+    for (u = 0; u < CWG_UTYPES; ++u)
+	tiled->builds[u] = battle->builds[u];
+
+    /* repeat the terrain, points and units across the map */
+    for (y = 0; y < side; ++y)
+	for (x = 0; x < side; ++x) {
+	    l = x % map->width + map->width * (y % map->height);
+	    newmap->terrain[x + side * y] = map->terrain[l];
+	    newmap->points[x + side * y] = map->points[l];
+	    if (map->units[l] == CWG_NO_UNIT)
+		continue;
+	    if (! (unit = battle->units[map->units[l]]->methods->clone
+		   (battle->units[map->units[l]])))
+		fatalerror (FATAL_MEMORY);
+	    unit->x = x;
+	    unit->y = y;
+	    if ((u = tiled->methods->addunit (tiled, unit)) == CWG_NO_UNIT)
+		unit->methods->destroy (unit);
+	    else
+		newmap->units[x + side * y] = u;
+	}
+
+    /* bring the hash and counts up to date */
+    tiled->methods->rehash (tiled);
+    return tiled;
+}
+
+/**
+ * Read through the argument list for recognised parameters.
+ * @param argc is the argument count from the command line.
+ * @param argv is an array of arguments.
+ */
+static void initialiseargs (int argc, char **argv)
+{
+    /* local variables */
+    int c; /* argument count */
+
+    /* scan through arguments */
+    for (c = 1; c < argc; ++c)
+	if (! strncmp (argv[c], "-p", 2))
+	    passes = atoi (&argv[c][2]);
+	else if (! strncmp (argv[c], "-s", 2))
+	    side = atoi (&argv[c][2]);
+	else if (! campaignfile)
+	    campaignfile = argv[c];
+	else
+	    fatalerror (FATAL_COMMAND_LINE);
+    if (! campaignfile)
+	fatalerror (FATAL_COMMAND_LINE);
+    if (side && (side < 9 || side > CWG_MAPSIDE))
+	fatalerror (FATAL_COMMAND_LINE);
+}
+
+/**
+ * Search every path open to every unit in a battle.
+ * Each unit's reachable squares are found, and the unit is moved to
+ * each in turn and moved back again.
+ * @param battle is the battle to search.
+ * @param squares is a buffer big enough for the map.
+ * @return a checksum of the moves made.
+ */
+static long searchbattle (Battle *battle, unsigned char *squares)
+{
+    /* local variables */
+    CwgAction action; /* the move to make */
+    Unit *unit; /* unit being moved */
+    long checksum; /* checksum of the moves made */
+    int size, /* number of squares on the map */
+	u, /* unit counter */
+	l; /* location counter */
+
+    /* initialise */
+    size = battle->map->width * battle->map->height;
+    checksum = 0;
+    action.type = CWG_ACT_MOVE;
+
+    /* move each unit to each square it can reach */
+    for (u = 0; u < battle->unitcap; ++u) {
+	if (! (unit = battle->units[u]))
+	    continue;
+	checksum += battle->methods->reachable (battle, unit, squares);
+	action.unit = u;
+	for (l = 0; l < size; ++l) {
+	    if (! squares[l])
+		continue;
+	    action.x = l % battle->map->width;
+	    action.y = l / battle->map->width;
+	    if (! battle->methods->apply (battle, &action))
+		continue;
+	    checksum += unit->moves;
+	    battle->methods->undo (battle);
+	}
+    }
+
+    /* return the checksum */
+    return checksum;
+}
+
+/*----------------------------------------------------------------------
+ * Level 1 Private Function Definitions
+ */
+
+/**
+ * Initialise the program.
+ * @param argc is the argument count from the command line.
+ * @param argv is the array of arguments from the command line.
+ */
+static void initialiseprogram (int argc, char **argv)
+{
+    /* check command line */
+    initialiseargs (argc, argv);
+
+    /* load the campaign */
+    if (! (campaign = new_Campaign ()))
+	fatalerror (FATAL_MEMORY);
+    strcpy (campaign->filename, campaignfile);
+    if (! strchr (campaign->filename, '.'))
+	strcat (campaign->filename, ".cam");
+    if (! (campaign->load (campaign, 0)))
+	fatalerror (FATAL_INVALIDDATA);
+}
+
+/**
+ * Time the searches over each scenario.
+ */
+static void searchscenarios (void)
+{
+    /* local variables */
+    Battle *battle; /* copy of the scenario's battle */
+    unsigned char *squares; /* reachable squares */
+    clock_t start, /* clock at the start of a scenario */
+	elapsed, /* clock ticks for one scenario */
+	total; /* clock ticks over all scenarios */
+    long checksum; /* checksum of the moves made */
+    int s, /* scenario counter */
+	p; /* pass counter */
+
+    /* loop through the scenarios */
+    total = 0;
+    for (s = 0; s < BARREN_SCENARIOS; ++s) {
+	if (! campaign->scenarios[s] || ! campaign->scenarios[s]->battle)
+	    continue;
+
+	/* search the scenario's battle repeatedly */
+	battle = side
+	    ? tilebattle (campaign->scenarios[s]->battle)
+	    : campaign->scenarios[s]->battle->methods->clone
+	    (campaign->scenarios[s]->battle);
+	if (! battle)
+	    fatalerror (FATAL_MEMORY);
+	if (! (squares = malloc
+	       (battle->map->width * battle->map->height)))
+	    fatalerror (FATAL_MEMORY);
+	checksum = 0;
+	start = clock ();
+	for (p = 0; p < passes; ++p)
+	    checksum += searchbattle (battle, squares);
+	elapsed = clock () - start;
+	total += elapsed;
+
+	/* report on the scenario */
+	printf ("Scenario %d: %ld ticks, checksum %ld\n",
+		s + 1, (long) elapsed, checksum);
+	free (squares);
+	battle->methods->destroy (battle);
+    }
+
+    /* report on the whole campaign */
+    printf ("Total: %ld ticks at %ld per second\n",
+	    (long) total, (long) CLOCKS_PER_SEC);
+}
+
+/*----------------------------------------------------------------------
+ * Public Level Function Definitions
+ */
+
+/**
+ * Main Program.
+ * @param argc is the number of command line arguments.
+ * @param argv is an array of command line arguments.
+ * @return 0 if successful, >0 on error.
+ */
+int main (int argc, char **argv)
+{
+    initialiseprogram (argc, argv);
+    searchscenarios ();
+    campaign->destroy (campaign);
+    return 0;
+}
@@ -41,6 +41,15 @@ static int scenid = 1;
 /** @var maxturns Maximum number of turns to play. */
 static int maxturns = 99;
 
+/** @var randomseed Seed for random numbers, or 0 to use the time. */
+static unsigned int randomseed = 0;
+
+/** @var playertypes The computer player type for each side. */
+static int playertypes[2] = {PLAYER_COMPUTER, PLAYER_COMPUTER};
+
+/** @var budget Milliseconds a tree search player thinks per turn. */
+static long budget = 2000;
+
 /** @var campaignfile The campaign filename. */
 static char *campaignfile = NULL;
 
@@ -83,6 +92,14 @@ static void initialiseargs (int argc, char **argv)
 	    scenid = atoi (&argv[c][2]);
 	else if (! strncmp (argv[c], "-t", 2))
 	    maxturns = atoi (&argv[c][2]);
+	else if (! strncmp (argv[c], "-r", 2))
+	    randomseed = (unsigned int) atol (&argv[c][2]);
+	else if (! strncmp (argv[c], "-p", 2))
+	    playertypes[0] = atoi (&argv[c][2]);
+	else if (! strncmp (argv[c], "-q", 2))
+	    playertypes[1] = atoi (&argv[c][2]);
+	else if (! strncmp (argv[c], "-m", 2))
+	    budget = atol (&argv[c][2]);
 	else if (! campaignfile)
 	    campaignfile = argv[c];
 	else
@@ -100,6 +117,8 @@ static int playturn (Game *game)
     printf ("turn %d %s\r", game->turnno,
 	    game->campaign->corpnames[game->battle->side]);
     ai = get_AI (game, prompthook, loghook);
+    ai->setbudget (0, budget);
+    ai->setbudget (1, budget);
     ai->turn ();
     if (game->report && game->report->count)
 	pass = 0;
@@ -108,7 +127,7 @@ static int playturn (Game *game)
     game->turn (game);
     game->report->destroy (game->report);
     game->report = NULL;
-    return game->battle->victory (game->battle);
+    return game->battle->methods->victory (game->battle);
 }
 
 /*----------------------------------------------------------------------
@@ -140,12 +159,17 @@ static void initialiseprogram (int argc, char **argv)
     if (! (config = new_Config ()))
 	fatalerror (FATAL_MEMORY);
     strcpy (config->campaignfile, game->campaign->filename);
-    config->playertypes[0] = PLAYER_COMPUTER;
-    config->playertypes[1] = PLAYER_COMPUTER;
+    config->playertypes[0] = playertypes[0];
+    config->playertypes[1] = playertypes[1];
     *config->gamefile = '\0';
+    game->playertypes[0] = playertypes[0];
+    game->playertypes[1] = playertypes[1];
 
     /* initialise the random number generator */
-    srand (time (NULL));
+    if (randomseed)
+	srand (randomseed);
+    else
+	srand ((unsigned int) time (NULL));
 }
 
 /**
@@ -154,6 +178,10 @@ static void initialiseprogram (int argc, char **argv)
 static void playgame (void)
 {
     Scenario *scenario; /* pointer to the scenario */ 
+    clock_t start; /* clock at the start of play */
+    AI *ai; /* pointer to the AI */
+    long nodes, /* nodes searched by tree search players */
+	milliseconds; /* time spent searching them */
     int victory, /* victory for the game being played */
 	victories[2], /* count of victories for each player */
 	g; /* game counter */
@@ -162,27 +190,32 @@ static void playgame (void)
     scenario = game->campaign->scenarios[scenid - 1];
     victories[0] = victories[1] = 0;
     game->report = NULL;
+    start = clock ();
 
     /* loop through the games */
     for (g = 0; g < gamecount; ++g) {
 
 	/* initialise the game */
 	printf ("Fighting battle %d/%d\n", g + 1, gamecount);
-	game->battle = scenario->battle->clone (scenario->battle);
+	game->battle = scenario->battle->methods->clone (scenario->battle);
 	game->battle->start = game->battle->side = rand () % 2;
+	game->battle->methods->seed (game->battle, rand ());
+	game->battle->methods->rehash (game->battle);
 	game->turnno = 0;
 
 	/* play the turns */
 	pass = 0;
 	do {
 	    playturn (game);
-	    victory = game->battle->victory (game->battle);
+	    victory = game->battle->methods->victory (game->battle);
 	} while (victory == -1 && game->turnno < maxturns && pass < 2);
 
 	/* clean up the game */
+	printf ("Final position %08lx%08lx\n",
+		game->battle->hash[0], game->battle->hash[1]);
 	if (victory != -1)
 	    ++victories[victory];
-	game->battle->destroy (game->battle);
+	game->battle->methods->destroy (game->battle);
 	game->battle = NULL;
     }
 
@@ -190,6 +223,15 @@ static void playgame (void)
     printf ("%s: %d wins\n", game->campaign->corpnames[0], victories[0]);
     printf ("%s: %d wins\n", game->campaign->corpnames[1], victories[1]);
     printf ("%d stalemates\n", gamecount - victories[0] - victories[1]);
+    printf ("%ld ticks at %ld per second\n",
+	    (long) (clock () - start), (long) CLOCKS_PER_SEC);
+
+    /* print the speed of any tree search */
+    ai = get_AI (game, prompthook, loghook);
+    ai->searchstats (&nodes, &milliseconds);
+    if (milliseconds)
+	printf ("%ld nodes searched in %ld ms, %ld per second\n",
+		nodes, milliseconds, nodes * 1000 / milliseconds);
 }
 
 /**
@@ -29,7 +29,7 @@ static void destroy (Report *report)
 {
     if (report) {
 	if (report->battle)
-	    report->battle->destroy (report->battle);
+	    report->battle->methods->destroy (report->battle);
 	if (report->count)
 	    free (report->entries);
 	free (report);
@@ -53,9 +53,9 @@ static Report *clone (Report *report)
     /* copy the attributes to the new report */
     newreport->count = report->count;
     newreport->battle = report->battle ?
-	report->battle->clone (report->battle) :
+	report->battle->methods->clone (report->battle) :
 	NULL;
-    size = report->count * sizeof (long int);
+    size = report->count * sizeof (ReportEntry);
     newreport->entries = malloc (size);
     memcpy (newreport->entries, report->entries, size);
 
@@ -64,29 +64,31 @@ static Report *clone (Report *report)
 }
 
 /**
- * Write a report to an open file.
+ * Write a report to a stream.
  * @param  report The report to write.
- * @param  output The output file handle.
+ * @param  output The output stream.
  * @return        1 if successful, 0 on failure.
  */
-static int write (Report *report, FILE *output)
+static int write (Report *report, Stream *output)
 {
     int c, /* entry counter */
 	zero = 0; /* constant zero for writing */
 
     /* if the report is empty, write a 0 action count and be done */
     if (! report->battle || ! report->count) {
-	fwrite(&zero, 2, 1, output);
+	output->methods->write (output, &zero, 2);
 	return 1;
     }
 
     /* write action count, battle state and actions */
-    if (! fwrite (&report->count, 2, 1, output))
+    if (! output->methods->write (output, &report->count, 2))
 	return 0;
-    if (! report->battle->write (report->battle, output))
+    if (! report->battle->methods->write (report->battle, output))
 	return 0;
     for (c = 0; c < report->count; ++c)
-	if (! fwrite (&report->entries[c], 4, 1, output))
+	if (! output->methods->write (output, &report->entries[c].code, 2) ||
+	    ! output->methods->write (output, &report->entries[c].origin, 2) ||
+	    ! output->methods->write (output, &report->entries[c].target, 2))
 	    return 0;
 
     /* all done */
@@ -94,20 +96,22 @@ static int write (Report *report, FILE *output)
 }
 
 /**
- * Read a report from an open file.
+ * Read a report from a stream.
  * @param  report The report to read.
- * @param  input  The input file handle.
+ * @param  input  The input stream.
+ * @param  format The ReportFormat of the entries in the file.
  * @return        1 if successful, 0 on failure.
  */
-static int read (Report *report, FILE *input)
+static int read (Report *report, Stream *input, int format)
 {
     int c; /* entry counter */
+    unsigned long packed; /* an entry in the packed format */
 
     /* clear any current report data */
     report->clear (report);
 
     /* read the report count word */
-    if (! fread (&report->count, 2, 1, input))
+    if (! input->methods->read (input, &report->count, 2))
 	return 0;
 
     /* return now if there are zero entries */
@@ -117,16 +121,27 @@ static int read (Report *report, FILE *input)
     /* read the initial battle state */
     if (! (report->battle = new_Battle (NULL, NULL)))
 	fatalerror (FATAL_MEMORY);
-    if (! report->battle->read (report->battle, input))
+    if (! report->battle->methods->read (report->battle, input))
 	return 0;
 
     /* read the report entries */
     if (! (report->entries = malloc (report->count *
-				     sizeof (long int))))
+				     sizeof (ReportEntry))))
 	fatalerror (FATAL_MEMORY);
     for (c = 0; c < report->count; ++c)
-	if (! fread (&report->entries[c], 4, 1, input))
-	    return 0;
+	if (format == REPORT_WIDE) {
+	    if (! input->methods->read (input, &report->entries[c].code, 2) ||
+		! input->methods->read (input, &report->entries[c].origin, 2) ||
+		! input->methods->read (input, &report->entries[c].target, 2))
+		return 0;
+	} else {
+	    packed = 0;
+	    if (! input->methods->read (input, &packed, 4))
+		return 0;
+	    report->entries[c].code = packed & 0x1ff;
+	    report->entries[c].origin = (packed >> 9) & 0xff;
+	    report->entries[c].target = (packed >> 17) & 0xff;
+	}
 
     /* return success */
     return 1;
@@ -143,7 +158,7 @@ static void clear (Report *report)
 	report->entries = NULL;
     }
     if (report->battle) {
-	report->battle->destroy (report->battle);
+	report->battle->methods->destroy (report->battle);
 	report->battle = NULL;
     }
     report->count = 0;
@@ -165,20 +180,20 @@ static int add (Report *report, int action, int utype, int ttype,
     /* make room for new entry */
     if (report->count)
 	report->entries = realloc (report->entries,
-				   4 * (report->count + 1));
+				   sizeof (ReportEntry) * (report->count + 1));
     else
-	report->entries = malloc (4);
+	report->entries = malloc (sizeof (ReportEntry));
     if (! report->entries)
 	fatalerror (FATAL_MEMORY);
     ++report->count;
 
     /* store entry */
-    report->entries[report->count - 1] =
+    report->entries[report->count - 1].code =
 	action +
 	(utype << 3) +
-	(ttype << 6) +
-	(((long int) origin) << 9) +
-	(((long int) target) << 17);
+	(ttype << 6);
+    report->entries[report->count - 1].origin = origin;
+    report->entries[report->count - 1].target = target;
 
     /* return success code */
     return 1;
@@ -194,7 +209,7 @@ static int action (Report *report, int index)
 {
     if (index >= report->count)
 	return ACTION_NONE;
-    return report->entries[index] & 0x7;
+    return report->entries[index].code & 0x7;
 }
 
 /**
@@ -205,7 +220,7 @@ static int action (Report *report, int index)
  */
 static int utype (Report *report, int index)
 {
-    return (report->entries[index] >> 3) & 0x7;
+    return (report->entries[index].code >> 3) & 0x7;
 }
 
 /**
@@ -216,7 +231,7 @@ static int utype (Report *report, int index)
  */
 static int ttype (Report *report, int index)
 {
-    return (report->entries[index] >> 6) & 0x7;
+    return (report->entries[index].code >> 6) & 0x7;
 }
 
 /**
@@ -227,7 +242,7 @@ static int ttype (Report *report, int index)
  */
 static int origin (Report *report, int index)
 {
-    return (report->entries[index] >> 9) & 0xff;
+    return report->entries[index].origin;
 }
 
 /**
@@ -238,7 +253,7 @@ static int origin (Report *report, int index)
  */
 static int target (Report *report, int index)
 {
-    return (report->entries[index] >> 17) & 0xff;
+    return report->entries[index].target;
 }
 
 /*----------------------------------------------------------------------
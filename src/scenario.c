@@ -33,32 +33,32 @@ static Cwg *cwg; /* the CWG object */
  */
 
 /**
- * Write a long string to an already open file.
+ * Write a long string to a stream.
  * @param value is the string to write.
- * @param output is the file to write to.
+ * @param output is the stream to write to.
  * @return 1 if successful, 0 on failure.
  */
-int writestring (char *value, FILE *output)
+int writestring (char *value, Stream *output)
 {
     char byte; /* byte of length string */
     byte = (char) (strlen (value) % 0x100);
-    if (! fwrite (&byte, 1, 1, output))
+    if (! output->methods->write (output, &byte, 1))
 	return 0;
     byte = (char) (strlen (value) / 0x100);
-    if (! fwrite (&byte, 1, 1, output))
+    if (! output->methods->write (output, &byte, 1))
 	return 0;
     if (! strlen (value))
 	return 1;
-    return fwrite (value, strlen (value), 1, output);
+    return output->methods->write (output, value, strlen (value));
 }
 
 /**
- * Read a long string from an open file.
+ * Read a long string from a stream.
  * @param value is the string buffer to store the string.
- * @param input is the file to read from.
+ * @param input is the stream to read from.
  * @return 1 on success, 0 on failure.
  */
-int readstring (char *value, FILE *input)
+int readstring (char *value, Stream *input)
 {
     /* local variables */
     int len, /* string length */
@@ -66,16 +66,16 @@ int readstring (char *value, FILE *input)
     char byte; /* byte from string length */
 
     /* read the length */
-    if (! fread (&byte, 1, 1, input))
+    if (! input->methods->read (input, &byte, 1))
 	return 0;
     len = byte;
-    if (! fread (&byte, 1, 1, input))
+    if (! input->methods->read (input, &byte, 1))
 	return 0;
     len += 0x100 * byte;
 
     /* read the string and return it */
     if (len)
-	r &= fread (value, len, 1, input);
+	r &= input->methods->read (input, value, len);
     value[len] = '\0';
     return 1;
 }
@@ -93,18 +93,18 @@ static void destroy (Scenario *scenario)
     /* free up memory */
     if (scenario) {
 	if (scenario->battle)
-	    scenario->battle->destroy (scenario->battle);
+	    scenario->battle->methods->destroy (scenario->battle);
 	free (scenario);
     }
 }
 
 /**
- * Write scenario details to an already open file.
+ * Write scenario details to a stream.
  * @param scenario is the scenario to save.
- * @param output is the output file.
+ * @param output is the output stream.
  * @return 1 for success, 0 for failure.
  */
-static int write (Scenario *scenario, FILE *output)
+static int write (Scenario *scenario, Stream *output)
 {
     /* local variables */
     int t, /* text counter */
@@ -114,7 +114,7 @@ static int write (Scenario *scenario, FILE *output)
     /* write the battle */
     if (! scenario->battle)
 	return 0;
-    if (! scenario->battle->write (scenario->battle, output))
+    if (! scenario->battle->methods->write (scenario->battle, output))
 	return 0;
 
     /* write the scenario text */
@@ -137,12 +137,12 @@ static int write (Scenario *scenario, FILE *output)
 }
 
 /**
- * Read scenario details from an already open file.
+ * Read scenario details from a stream.
  * @param scenario is the scenario to load.
- * @param input is the input file.
+ * @param input is the input stream.
  * @return 1 for success, 0 for failure.
  */
-static int read (Scenario *scenario, FILE *input)
+static int read (Scenario *scenario, Stream *input)
 {
     /* local variables */
     int t, /* text counter */
@@ -155,7 +155,7 @@ static int read (Scenario *scenario, FILE *input)
 				       scenario->campaign->terrain);
     if (! scenario->battle)
 	return 0;
-    r &= scenario->battle->read (scenario->battle, input);
+    r &= scenario->battle->methods->read (scenario->battle, input);
 
     /* read the scenario text */
     for (t = 0; t < 6; ++t)
@@ -133,8 +133,10 @@ static int setupgame (void)
 
     /* set up the parameters from the command line */
     scenario = game->campaign->scenarios[game->scenid];
-    game->battle = scenario->battle->clone (scenario->battle);
+    game->battle = scenario->battle->methods->clone (scenario->battle);
     game->battle->start = game->battle->side = rand () % 2;
+    game->battle->methods->seed (game->battle, rand ());
+    game->battle->methods->rehash (game->battle);
     game->turnno = 0;
 
     /* success! */
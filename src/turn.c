@@ -46,7 +46,7 @@ static Config *config = NULL;
 static void destroyobjects (Turn *turn)
 {
     if (turn->battle)
-	turn->battle->destroy (turn->battle);
+	turn->battle->methods->destroy (turn->battle);
     if (turn->report)
 	turn->report->destroy (turn->report);
 }
@@ -104,38 +104,45 @@ static void clear (Turn *turn)
 static int save (Turn *turn)
 {
     FILE *output; /* the output file */
+    Stream *stream; /* buffered stream on the output file */
     int success = 1, /* return value */
 	noreport = 0; /* constant for no report */
 
     /* open the output file */
     if (! (output = fopen (turn->filename, "wb")))
 	return 0;
+    if (! (stream = new_FileStream (output))) {
+	fclose (output);
+	return 0;
+    }
 
     /* write the turn header */
-    success = success && fwrite ("BAR100G", 8, 1, output);
+    success = success && stream->methods->write (stream, "BAR101G", 8);
 
     /* write the basic information and battle state */
     success = success &&
-	cwg->writestring (turn->campaignfile, output) &&
-	cwg->writeint (&turn->playertypes[0], output) &&
-	cwg->writeint (&turn->playertypes[1], output) &&
-	cwg->writeint (&turn->briefed[0], output) &&
-	cwg->writeint (&turn->briefed[1], output) &&
-	cwg->writeint (&turn->debriefed[0], output) &&
-	cwg->writeint (&turn->debriefed[1], output) &&
-	cwg->writeint (&turn->scenid, output) &&
-	cwg->writeint (&turn->player, output) &&
-	cwg->writeint (&turn->start, output) &&
-	cwg->writeint (&turn->turnno, output) &&
-	turn->battle->write (turn->battle, output);
+	cwg->writestring (turn->campaignfile, stream) &&
+	cwg->writeint (&turn->playertypes[0], stream) &&
+	cwg->writeint (&turn->playertypes[1], stream) &&
+	cwg->writeint (&turn->briefed[0], stream) &&
+	cwg->writeint (&turn->briefed[1], stream) &&
+	cwg->writeint (&turn->debriefed[0], stream) &&
+	cwg->writeint (&turn->debriefed[1], stream) &&
+	cwg->writeint (&turn->scenid, stream) &&
+	cwg->writeint (&turn->player, stream) &&
+	cwg->writeint (&turn->start, stream) &&
+	cwg->writeint (&turn->turnno, stream) &&
+	turn->battle->methods->write (turn->battle, stream) &&
+	turn->battle->methods->writerandom (turn->battle, stream);
     if (turn->report)
 	success = success &&
-	    turn->report->write (turn->report, output);
+	    turn->report->write (turn->report, stream);
     else
 	success = success &&
-	    fwrite (&noreport, 2, 1, output);
+	    stream->methods->write (stream, &noreport, 2);
 
     /* close the output file and return */
+    stream->methods->destroy (stream);
     fclose (output);
     return success;
 }
@@ -149,46 +156,55 @@ static int save (Turn *turn)
 static int load (Turn *turn, int summary)
 {
     FILE *input; /* the input file */
-    int success = 1; /* return value */
+    Stream *stream; /* buffered stream on the input file */
+    int success = 1, /* return value */
+	format; /* format of the turn report */
     char header[8]; /* header read from file */
 
     /* open the input file */
     if (! (input = fopen (turn->filename, "rb")))
 	return 0;
+    if (! (stream = new_FileStream (input))) {
+	fclose (input);
+	return 0;
+    }
 
     /* read the turn header */
     success = success &&
-	fread (header, 8, 1, input) &&
-	! strncmp (header, "BAR100G", 8);
+	stream->methods->read (stream, header, 8) &&
+	(! strncmp (header, "BAR101G", 8) ||
+	 ! strncmp (header, "BAR100G", 8));
+    format = strncmp (header, "BAR100G", 8) ? REPORT_WIDE : REPORT_PACKED;
 
     /* read the turn settings */
     success = success &&
-	cwg->readstring (turn->campaignfile, input);
+	cwg->readstring (turn->campaignfile, stream);
     success = success &&
-	cwg->readint (&turn->playertypes[0], input);
+	cwg->readint (&turn->playertypes[0], stream);
     success = success &&
-	cwg->readint (&turn->playertypes[1], input);
+	cwg->readint (&turn->playertypes[1], stream);
 
     /* load the turn state and progress information */
     success = success &&
-	cwg->readint (&turn->briefed[0], input);
+	cwg->readint (&turn->briefed[0], stream);
     success = success &&
-	cwg->readint (&turn->briefed[1], input);
+	cwg->readint (&turn->briefed[1], stream);
     success = success &&
-	cwg->readint (&turn->debriefed[0], input);
+	cwg->readint (&turn->debriefed[0], stream);
     success = success &&
-	cwg->readint (&turn->debriefed[1], input);
+	cwg->readint (&turn->debriefed[1], stream);
     success = success &&
-	cwg->readint (&turn->scenid, input);
+	cwg->readint (&turn->scenid, stream);
     success = success &&
-	cwg->readint (&turn->player, input);
+	cwg->readint (&turn->player, stream);
     success = success &&
-	cwg->readint (&turn->start, input);
+	cwg->readint (&turn->start, stream);
     success = success &&
-	cwg->readint (&turn->turnno, input);
+	cwg->readint (&turn->turnno, stream);
 
     /* stop here if only the summary is needed */
     if (summary) {
+	stream->methods->destroy (stream);
 	fclose (input);
 	return success;
     }
@@ -196,10 +212,15 @@ static int load (Turn *turn, int summary)
     /* load in the campaign and current battle state */
     if (success) {
 	if (turn->battle)
-	    turn->battle->destroy (turn->battle);
+	    turn->battle->methods->destroy (turn->battle);
 	turn->battle = new_Battle (NULL, NULL);
 	success = success &&
-	    turn->battle->read (turn->battle, input);
+	    turn->battle->methods->read (turn->battle, stream);
+	if (! strncmp (header, "BAR100G", 8))
+	    turn->battle->methods->seed (turn->battle, rand ());
+	else
+	    success = success &&
+		turn->battle->methods->readrandom (turn->battle, stream);
     }
 
     /* load in the initial battle state and turn report */
@@ -209,7 +230,7 @@ static int load (Turn *turn, int summary)
 	else
 	    turn->report = new_Report ();
 	success = success &&
-	    turn->report->read (turn->report, input);
+	    turn->report->read (turn->report, stream, format);
 	if (! turn->report->count) {
 	    turn->report->destroy (turn->report);
 	    turn->report = NULL;
@@ -217,6 +238,7 @@ static int load (Turn *turn, int summary)
     }
     
     /* close the input file and return */
+    stream->methods->destroy (stream);
     fclose (input);
     return success;
 }
@@ -252,7 +274,7 @@ static int gametoturn (Turn *turn, Game *game)
     turn->player = game->battle->side;
     turn->start = game->battle->start;
     turn->turnno = game->turnno;
-    turn->battle = game->battle->clone (game->battle);
+    turn->battle = game->battle->methods->clone (game->battle);
     if (turn->report) {
 	turn->report->destroy (turn->report);
 	turn->report = NULL;
@@ -278,7 +300,7 @@ static int turntogame (Turn *turn, Game *game)
     /* this player seen the debrief screen? */
     if (! game->battle)
 	debrief = 0;
-    else if (game->battle->victory (game->battle) == -1)
+    else if (game->battle->methods->victory (game->battle) == -1)
 	debrief = 0;
     else
 	debrief = 1;
@@ -310,7 +332,7 @@ static int turntogame (Turn *turn, Game *game)
     game->debriefed[1] = turn->debriefed[1];
     game->scenid = turn->scenid;
     game->turnno = turn->turnno;
-    game->battle = turn->battle->clone (turn->battle);
+    game->battle = turn->battle->methods->clone (turn->battle);
     if (game->report) {
 	game->report->destroy (game->report);
 	game->report = NULL;
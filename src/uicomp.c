@@ -119,7 +119,7 @@ static void init (UIScreen *uiscreen)
     game->debriefed[game->battle->side] = 1;
 
     /* set the movement algorithm to smart */
-    game->battle->setmovement (CWG_MOVE_SMART);
+    game->battle->methods->setmovement (game->battle, CWG_MOVE_SMART);
 
     /* get the map location to view */
     loc = uiscreen->maplocation (game->battle);
@@ -148,6 +148,8 @@ static UIState show (UIScreen *uiscreen)
 
     /* end the turn */
     ai = get_AI (game, phaseinprogress, phasedone);
+    ai->setbudget (0, 1000L * config->searchtime);
+    ai->setbudget (1, 1000L * config->searchtime);
     ai->turn ();
     ai->destroy ();
     game->turn (game);
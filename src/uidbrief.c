@@ -115,7 +115,7 @@ static void init (UIScreen *uiscreen)
     game = uiscreen->data->game;
     game->state = STATE_DEBRIEFING;
     scenario = game->campaign->scenarios[game->scenid];
-    victor = game->battle->victory (game->battle);
+    victor = game->battle->methods->victory (game->battle);
     result = (victor != game->battle->side);
     debriefing = scenario->text[SCENARIO_VICTORY_1
 				+ game->battle->side
@@ -110,7 +110,7 @@ static void init (UIScreen *uiscreen)
     /* get the pointer to the appropriate briefing text */
     game = uiscreen->data->game;
     game->state = STATE_ENDGAME;
-    uiscreen->data->victor = game->battle->victory (game->battle);
+    uiscreen->data->victor = game->battle->methods->victory (game->battle);
 
     /* get the map location to view */
     loc = uiscreen->maplocation (game->battle);
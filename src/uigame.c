@@ -130,7 +130,8 @@ static char *playerdescs[] = {
     "Computer (Easy)",
     "Computer (Fair)",
     "Computer (Hard)",
-    "PBM"
+    "PBM",
+    "Computer (Search)"
 };
 
 /*----------------------------------------------------------------------
@@ -264,10 +265,10 @@ static void adjustplayer (UIScreen *uiscreen, int direction)
     sp = campaignrefs[uiscreen->data->campaignindex].singleplayer;
     if (sp) {
 	lowplayer = (sp == player + 1) ? PLAYER_HUMAN : PLAYER_COMPUTER;
-	highplayer = (sp == player + 1) ? PLAYER_HUMAN : PLAYER_HARD;
+	highplayer = (sp == player + 1) ? PLAYER_HUMAN : PLAYER_SEARCH;
     } else {
 	lowplayer = PLAYER_HUMAN;
-	highplayer = PLAYER_PBM;
+	highplayer = PLAYER_SEARCH;
     }
 
     /* cycles through the player types */
@@ -280,6 +281,10 @@ static void adjustplayer (UIScreen *uiscreen, int direction)
     else
 	playertypes[player] += direction;
 
+    /* PBM comes between the computer players but is not for one player */
+    if (sp && playertypes[player] == PLAYER_PBM)
+	playertypes[player] += direction;
+
     /* ensure that at least one player is human */
     if (playertypes[player] != PLAYER_HUMAN &&
 	playertypes[1 - player] != PLAYER_HUMAN) {
@@ -401,7 +401,10 @@ static void showresources (Battle *battle)
  */
 static void navigatemap (UIScreen *uiscreen)
 {
+    Battle *battle; /* current battle */
     Map *map; /* current map */
+    Unit *unit; /* selected unit */
+    unsigned char *reach; /* squares the selected unit can reach */
     int left, /* left control pressed */
 	right, /* right control pressed */
 	up, /* up control pressed */
@@ -413,10 +416,26 @@ static void navigatemap (UIScreen *uiscreen)
 	ycursor; /* current y cursor */
 
     /* initialise */
-    map = uiscreen->data->game->battle->map;
+    battle = uiscreen->data->game->battle;
+    map = battle->map;
     xview = uiscreen->data->xview;
     yview = uiscreen->data->yview;
 
+    /* mark where the selected unit can move */
+    reach = NULL;
+    if (uiscreen->data->unit != CWG_NO_UNIT &&
+	(unit = battle->units[uiscreen->data->unit])->hits &&
+	unit->side == battle->side &&
+	unit->moves &&
+	(reach = malloc (map->width * map->height))) {
+	battle->methods->reachable (battle, unit, reach);
+	display->showmapreach (reach, map->width, xview, yview);
+	display->showmapcursor (uiscreen->data->xcursor,
+				uiscreen->data->ycursor,
+				xview, yview);
+	display->update ();
+    }
+
     /* main navigation loop */
     do {
 
@@ -466,6 +485,8 @@ static void navigatemap (UIScreen *uiscreen)
 		display->hidemapcursor (uiscreen->data->xcursor,
 					uiscreen->data->ycursor,
 					xview, yview);
+	    if (reach)
+		display->showmapreach (reach, map->width, xview, yview);
 
 	    /* save the new cursor position */
 	    uiscreen->data->xcursor = xcursor;
@@ -478,6 +499,16 @@ static void navigatemap (UIScreen *uiscreen)
 	}
 	
     } while (! fire);
+
+    /* clear the marks from the map */
+    if (reach) {
+	free (reach);
+	display->showmap (xview, yview);
+	display->showmapcursor (uiscreen->data->xcursor,
+				uiscreen->data->ycursor,
+				xview, yview);
+	display->update ();
+    }
 }
 
 /**
@@ -590,15 +621,15 @@ static void moveunit (UIScreen *uiscreen)
     game = uiscreen->data->game;
     if (! game->report) {
 	game->report = new_Report ();
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
     } else if (! game->report->battle)
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
 
     /* move the unit */
     battle = uiscreen->data->game->battle;
     unit = battle->units[uiscreen->data->unit];
-    if (! battle->move (battle, unit, uiscreen->data->xcursor,
-			uiscreen->data->ycursor, movehook)) {
+    if (! battle->methods->move (battle, unit, uiscreen->data->xcursor,
+				 uiscreen->data->ycursor, movehook)) {
 	display->prompt ("Cannot move unit to that location");
 	return;
     }
@@ -646,13 +677,13 @@ static void attackunit (UIScreen *uiscreen)
     game = uiscreen->data->game;
     if (! game->report) {
 	game->report = new_Report ();
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
     } else if (! game->report->battle)
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
 
     /* attack the enemy */
-    if (! battle->attack (battle, battle->units[uiscreen->data->unit],
-			  battle->units[uid], attackhook)) {
+    if (! battle->methods->attack (battle, battle->units[uiscreen->data->unit],
+				   battle->units[uid], attackhook)) {
 	display->prompt ("Cannot attack that target");
 	return;
     }
@@ -714,14 +745,15 @@ static void buildunit (UIScreen *uiscreen)
 	/* ensure we have a report to record the action */
 	if (! game->report) {
 	    game->report = new_Report ();
-	    game->report->battle = game->battle->clone (game->battle);
+	    game->report->battle = game->battle->methods->clone (game->battle);
 	} else if (! game->report->battle)
-	    game->report->battle = game->battle->clone (game->battle);
+	    game->report->battle = game->battle->methods->clone (game->battle);
 
 	/* now build the unit */
 	battle = game->battle;
-	if (battle->create (battle, battle->units[uiscreen->data->unit],
-				 btype, x, y, buildhook) == CWG_NO_UNIT) {
+	if (battle->methods->create
+	    (battle, battle->units[uiscreen->data->unit],
+	     btype, x, y, buildhook) == CWG_NO_UNIT) {
 	    display->prompt ("Cannot build that unit");
 	    return;
 	}
@@ -763,13 +795,14 @@ static void repairunit (UIScreen *uiscreen)
     game = uiscreen->data->game;
     if (! game->report) {
 	game->report = new_Report ();
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
     } else if (! game->report->battle)
-	game->report->battle = game->battle->clone (game->battle);
+	game->report->battle = game->battle->methods->clone (game->battle);
 
     /* repair the target unit */
-    if (! battle->restore (battle, battle->units[uiscreen->data->unit],
-			   battle->units[uid], repairhook)) {
+    if (! battle->methods->restore
+	(battle, battle->units[uiscreen->data->unit],
+	 battle->units[uid], repairhook)) {
 	display->prompt ("Cannot repair that unit");
 	return;
     }
@@ -816,23 +849,28 @@ static void init (UIScreen *uiscreen)
     game->state = STATE_HUMAN;
 
     /* set the difficulty levels */
-    game->battle->setlevel (game->battle->side, 0);
+    game->battle->methods->setlevel (game->battle, game->battle->side, 0);
     switch (game->playertypes[1 - game->battle->side]) {
     case PLAYER_HUMAN:
     case PLAYER_PBM:
-	game->battle->setlevel (1 - game->battle->side, 0);
+	game->battle->methods->setlevel (game->battle,
+					 1 - game->battle->side, 0);
 	break;
     case PLAYER_COMPUTER:
     case PLAYER_FAIR:
     case PLAYER_HARD:
-	game->battle->setlevel
-	    (1 - game->battle->side,
+	game->battle->methods->setlevel
+	    (game->battle, 1 - game->battle->side,
 	     game->playertypes[1 - game->battle->side] - 1);
 	break;
+    case PLAYER_SEARCH:
+	game->battle->methods->setlevel
+	    (game->battle, 1 - game->battle->side, PLAYER_HARD - 1);
+	break;
     }
 
     /* set the movement algorithm to quick */
-    game->battle->setmovement (CWG_MOVE_QUICK);
+    game->battle->methods->setmovement (game->battle, CWG_MOVE_QUICK);
 
     /* get the map location to view */
     loc = uiscreen->maplocation (game->battle);
@@ -871,7 +909,7 @@ static UIState show (UIScreen *uiscreen)
     state = uiscreen->startscreen (game);
     if (state != STATE_HUMAN)
 	return state;
-    else if (game->battle->victory (game->battle) != -1)
+    else if (game->battle->methods->victory (game->battle) != -1)
 	return STATE_DEBRIEFING;
 
     /* initialise the display */
@@ -905,19 +943,19 @@ static UIState show (UIScreen *uiscreen)
 
 	case 2: /* move */
 	    moveunit (uiscreen);
-	    if (game->battle->victory (game->battle) != -1)
+	    if (game->battle->methods->victory (game->battle) != -1)
 		return STATE_DEBRIEFING;
 	    break;
 
 	case 3: /* attack */
 	    attackunit (uiscreen);
-	    if (game->battle->victory (game->battle) != -1)
+	    if (game->battle->methods->victory (game->battle) != -1)
 		return STATE_DEBRIEFING;
 	    break;
 
 	case 4: /* build */
 	    buildunit (uiscreen);
-	    if (game->battle->victory (game->battle) != -1)
+	    if (game->battle->methods->victory (game->battle) != -1)
 		return STATE_DEBRIEFING;
 	    break;
 
@@ -218,12 +218,10 @@ static void attackunit (UIScreen *uiscreen)
 
     /* remove any destroyed unit from the map */
     if (result == CWG_ATT_DEFR_KILLED) {
-	defender->destroy (defender);
-	data->battle->units[map->units[target]] = NULL;
+	data->battle->methods->removeunit (data->battle, map->units[target]);
 	map->units[target] = CWG_NO_UNIT;
     } else if (result == CWG_ATT_ATTR_KILLED) {
-	attacker->destroy (attacker);
-	data->battle->units[map->units[origin]] = NULL;
+	data->battle->methods->removeunit (data->battle, map->units[origin]);
 	map->units[origin] = CWG_NO_UNIT;
     }
     
@@ -274,12 +272,13 @@ static void buildunit (UIScreen *uiscreen)
     utypeid = report->ttype (report, data->frame);
 
     /* simulate the build */
-    for (u = 0; u < CWG_UNITS; ++u)
-	if (! data->battle->units[u])
-	    break;
-    if (u == CWG_UNITS)
+    if (! (built = new_Unit ()))
+	return;
+    if ((u = data->battle->methods->addunit (data->battle, built))
+	== CWG_NO_UNIT) {
+	built->methods->destroy (built);
 	return;
-    built = data->battle->units[u] = new_Unit ();
+    }
     strcpy (built->name, campaign->unittypes[utypeid]->name);
     built->side = builder->side;
     built->utype = utypeid;
@@ -536,7 +535,7 @@ static void destroy (UIScreen *uiscreen)
     if (uiscreen) {
 	if (uiscreen->data) {
 	    if ((battle = uiscreen->data->battle))
-		battle->destroy (battle);
+		battle->methods->destroy (battle);
 	    free (uiscreen->data);
 	}
 	free (uiscreen);
@@ -563,7 +562,7 @@ static void init (UIScreen *uiscreen)
     game = uiscreen->data->game;
     game->state = STATE_REPORT;
     uiscreen->data->battle = battle =
-	report->battle->clone (report->battle);
+	report->battle->methods->clone (report->battle);
 
     /* get the map location to view */
     loc = uiscreen->maplocation (battle);
@@ -625,9 +624,9 @@ static UIState show (UIScreen *uiscreen)
 	    break;
 
 	case 1: /* replay report */
-	    uiscreen->data->battle->destroy (uiscreen->data->battle);
+	    uiscreen->data->battle->methods->destroy (uiscreen->data->battle);
 	    uiscreen->data->battle =
-		report->battle->clone
+		report->battle->methods->clone
 		(report->battle);
 	    display->preparemap (game->campaign,
 				 uiscreen->data->battle);
@@ -99,14 +99,16 @@ static int maplocation (Battle *battle)
 	x, /* total of x coordinates of friendly units */
 	y, /* total of y coordinates of friendly units */
 	n; /* number of friendly units counted */
+    CwgRoster *roster; /* the units' fields */
     
     /* sum up the total of units, and their aggregate position */
-    for (x = y = n = u = 0; u < CWG_UNITS; ++u)
-	if (battle->units[u] &&
-	    battle->units[u]->hits &&
-	    battle->units[u]->side == battle->side) {
-	    x += battle->units[u]->x;
-	    y += battle->units[u]->y;
+    if (! (roster = battle->methods->getroster (battle)))
+	fatalerror (FATAL_MEMORY);
+    for (x = y = n = u = 0; u < battle->unitcap; ++u)
+	if (((roster->alive[u / 32] >> (u % 32)) & 1) &&
+	    roster->side[u] == battle->side) {
+	    x += roster->x[u];
+	    y += roster->y[u];
 	    ++n;
 	}
     